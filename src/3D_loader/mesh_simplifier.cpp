@@ -0,0 +1,465 @@
+#include "mesh_simplifier.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include "doctest/doctest.h"
+
+namespace {
+
+// Symmetric 4x4 matrix, upper triangle
+struct Quadric
+{
+    std::array<double, 10> m{};
+
+    static Quadric from_plane(const glm::dvec3& normal, double d, double weight = 1.0)
+    {
+        const double a = normal.x, b = normal.y, c = normal.z;
+        Quadric      q;
+        q.m = {a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c, c * d, d * d};
+        for (double& value : q.m)
+            value *= weight;
+        return q;
+    }
+
+    Quadric& operator+=(const Quadric& other)
+    {
+        for (std::size_t i = 0; i < m.size(); ++i)
+            m[i] += other.m[i];
+        return *this;
+    }
+
+    double evaluate(const glm::dvec3& v) const
+    {
+        return m[0] * v.x * v.x + 2 * m[1] * v.x * v.y + 2 * m[2] * v.x * v.z + 2 * m[3] * v.x
+               + m[4] * v.y * v.y + 2 * m[5] * v.y * v.z + 2 * m[6] * v.y
+               + m[7] * v.z * v.z + 2 * m[8] * v.z
+               + m[9];
+    }
+
+    // Position minimizing the error, false if the system is singular
+    bool optimal(glm::dvec3& result) const
+    {
+        // Cramer's rule on the symmetric 3x3 part
+        const glm::dvec3 c0(m[0], m[1], m[2]), c1(m[1], m[4], m[5]), c2(m[2], m[5], m[7]);
+        const glm::dvec3 rhs = -glm::dvec3(m[3], m[6], m[8]);
+        double           det = glm::dot(c0, glm::cross(c1, c2));
+        if (std::abs(det) < 1e-12)
+            return false;
+        result = glm::dvec3(glm::dot(rhs, glm::cross(c1, c2)), glm::dot(c0, glm::cross(rhs, c2)), glm::dot(c0, glm::cross(c1, rhs))) / det;
+        return true;
+    }
+};
+
+struct Triangle
+{
+    std::array<int, 3> v;
+    bool               removed = false;
+};
+
+struct Candidate
+{
+    double    cost;
+    int       a, b;
+    unsigned  version_a, version_b;
+    glm::vec3 target;
+
+    bool operator>(const Candidate& other) const { return cost > other.cost; }
+};
+
+std::uint64_t edge_key(int a, int b)
+{
+    if (a > b)
+        std::swap(a, b);
+    return (static_cast<std::uint64_t>(a) << 32) | static_cast<std::uint32_t>(b);
+}
+
+struct PositionHash
+{
+    std::size_t operator()(const glm::vec3& p) const
+    {
+        std::uint32_t bits[3];
+        std::memcpy(bits, &p, sizeof(bits));
+        return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+    }
+};
+
+class Simplifier
+{
+public:
+    explicit Simplifier(const std::vector<float>& data)
+        : m_data(data)
+    {
+        constexpr std::size_t stride = MeshSimplifier::vertex_size;
+        const std::size_t     corner_count = data.size() / stride;
+
+        // Weld corners sharing a position
+        std::unordered_map<glm::vec3, int, PositionHash> indices;
+        m_corner_vertex.resize(corner_count);
+        for (std::size_t corner = 0; corner < corner_count; ++corner)
+        {
+            glm::vec3 position(data[corner * stride], data[corner * stride + 1], data[corner * stride + 2]);
+            auto [it, inserted] = indices.try_emplace(position, static_cast<int>(m_positions.size()));
+            if (inserted)
+                m_positions.push_back(position);
+            m_corner_vertex[corner] = it->second;
+        }
+
+        m_quadrics.resize(m_positions.size());
+        m_vertex_triangles.resize(m_positions.size());
+        m_versions.assign(m_positions.size(), 0);
+        m_removed.assign(m_positions.size(), false);
+
+        for (std::size_t t = 0; t < corner_count / 3; ++t)
+        {
+            Triangle triangle{{m_corner_vertex[3 * t], m_corner_vertex[3 * t + 1], m_corner_vertex[3 * t + 2]}};
+            if (triangle.v[0] == triangle.v[1] || triangle.v[1] == triangle.v[2] || triangle.v[2] == triangle.v[0])
+                triangle.removed = true;
+            m_triangles.push_back(triangle);
+            if (triangle.removed)
+                continue;
+
+            ++m_triangle_count;
+            for (int v : triangle.v)
+                m_vertex_triangles[v].push_back(static_cast<int>(t));
+
+            glm::dvec3 normal = face_normal(triangle);
+            if (glm::dot(normal, normal) == 0.0)
+                continue;
+            normal         = glm::normalize(normal);
+            Quadric plane  = Quadric::from_plane(normal, -glm::dot(normal, glm::dvec3(m_positions[triangle.v[0]])));
+            for (int v : triangle.v)
+                m_quadrics[v] += plane;
+        }
+
+        add_border_constraints();
+
+        std::unordered_set<std::uint64_t> edges;
+        for (const Triangle& triangle : m_triangles)
+        {
+            if (triangle.removed)
+                continue;
+            for (int i = 0; i < 3; ++i)
+            {
+                int a = triangle.v[i], b = triangle.v[(i + 1) % 3];
+                if (edges.insert(edge_key(a, b)).second)
+                    push_candidate(a, b);
+            }
+        }
+    }
+
+    MeshSimplifier::Result run(std::size_t target_triangles)
+    {
+        double max_cost = 0.0;
+        while (m_triangle_count > target_triangles && !m_heap.empty())
+        {
+            Candidate candidate = m_heap.top();
+            m_heap.pop();
+            if (m_removed[candidate.a] || m_removed[candidate.b] || m_versions[candidate.a] != candidate.version_a || m_versions[candidate.b] != candidate.version_b)
+                continue; // Stale
+
+            if (!collapse(candidate.a, candidate.b, candidate.target))
+                continue;
+            max_cost = std::max(max_cost, candidate.cost);
+        }
+
+        MeshSimplifier::Result result;
+        result.error = static_cast<float>(std::sqrt(max_cost));
+        constexpr std::size_t stride = MeshSimplifier::vertex_size;
+        result.combined_data.reserve(m_triangle_count * 3 * stride);
+        for (std::size_t t = 0; t < m_triangles.size(); ++t)
+        {
+            if (m_triangles[t].removed)
+                continue;
+            for (int c = 0; c < 3; ++c)
+            {
+                // The corner keeps its attributes, the position comes from the collapsed vertex
+                std::size_t      corner   = 3 * t + c;
+                const glm::vec3& position = m_positions[m_triangles[t].v[c]];
+                result.combined_data.insert(result.combined_data.end(), {position.x, position.y, position.z});
+                result.combined_data.insert(result.combined_data.end(), m_data.begin() + corner * stride + 3, m_data.begin() + (corner + 1) * stride);
+            }
+        }
+        return result;
+    }
+
+private:
+    const std::vector<float>&  m_data;
+    std::vector<glm::vec3>     m_positions;
+    std::vector<int>           m_corner_vertex;
+    std::vector<Quadric>       m_quadrics;
+    std::vector<Triangle>      m_triangles;
+    std::vector<std::vector<int>> m_vertex_triangles;
+    std::vector<unsigned>      m_versions;
+    std::vector<bool>          m_removed;
+    std::size_t                m_triangle_count = 0;
+
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<>> m_heap;
+
+    glm::dvec3 face_normal(const Triangle& triangle) const
+    {
+        glm::dvec3 p0(m_positions[triangle.v[0]]), p1(m_positions[triangle.v[1]]), p2(m_positions[triangle.v[2]]);
+        return glm::cross(p1 - p0, p2 - p0);
+    }
+
+    // Open edges get a plane perpendicular to their face, so borders stay put
+    void add_border_constraints()
+    {
+        std::unordered_map<std::uint64_t, int> edge_faces;
+        for (const Triangle& triangle : m_triangles)
+        {
+            if (triangle.removed)
+                continue;
+            for (int i = 0; i < 3; ++i)
+                ++edge_faces[edge_key(triangle.v[i], triangle.v[(i + 1) % 3])];
+        }
+
+        constexpr double border_weight = 10.0;
+        for (const Triangle& triangle : m_triangles)
+        {
+            if (triangle.removed)
+                continue;
+            glm::dvec3 normal = face_normal(triangle);
+            if (glm::dot(normal, normal) == 0.0)
+                continue;
+            normal = glm::normalize(normal);
+
+            for (int i = 0; i < 3; ++i)
+            {
+                int a = triangle.v[i], b = triangle.v[(i + 1) % 3];
+                if (edge_faces[edge_key(a, b)] != 1)
+                    continue;
+                glm::dvec3 edge          = glm::dvec3(m_positions[b]) - glm::dvec3(m_positions[a]);
+                glm::dvec3 border_normal = glm::cross(edge, normal);
+                if (glm::dot(border_normal, border_normal) == 0.0)
+                    continue;
+                border_normal  = glm::normalize(border_normal);
+                Quadric border = Quadric::from_plane(border_normal, -glm::dot(border_normal, glm::dvec3(m_positions[a])), border_weight);
+                m_quadrics[a] += border;
+                m_quadrics[b] += border;
+            }
+        }
+    }
+
+    void push_candidate(int a, int b)
+    {
+        Quadric q = m_quadrics[a];
+        q += m_quadrics[b];
+
+        glm::dvec3 target;
+        double     cost;
+        if (q.optimal(target))
+        {
+            cost = q.evaluate(target);
+        }
+        else
+        {
+            // Singular: best of the endpoints and the middle
+            glm::dvec3 options[3] = {glm::dvec3(m_positions[a]), glm::dvec3(m_positions[b]), (glm::dvec3(m_positions[a]) + glm::dvec3(m_positions[b])) * 0.5};
+            target                = options[0];
+            cost                  = q.evaluate(options[0]);
+            for (const glm::dvec3& option : options)
+            {
+                double option_cost = q.evaluate(option);
+                if (option_cost < cost)
+                {
+                    cost   = option_cost;
+                    target = option;
+                }
+            }
+        }
+        m_heap.push({std::max(cost, 0.0), a, b, m_versions[a], m_versions[b], glm::vec3(target)});
+    }
+
+    // Would moving the vertex to target flip one of its faces (other than
+    // the ones removed by the collapse)?
+    bool flips(int vertex, int other, const glm::vec3& target) const
+    {
+        for (int t : m_vertex_triangles[vertex])
+        {
+            const Triangle& triangle = m_triangles[t];
+            if (triangle.removed || std::find(triangle.v.begin(), triangle.v.end(), other) != triangle.v.end())
+                continue;
+
+            glm::dvec3 before = face_normal(triangle);
+            Triangle   moved  = triangle;
+            glm::dvec3 p[3];
+            for (int c = 0; c < 3; ++c)
+                p[c] = moved.v[c] == vertex ? glm::dvec3(target) : glm::dvec3(m_positions[moved.v[c]]);
+            glm::dvec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+
+            double length = glm::length(before) * glm::length(after);
+            if (length == 0.0 || glm::dot(before, after) < 0.2 * length)
+                return true;
+        }
+        return false;
+    }
+
+    bool collapse(int a, int b, const glm::vec3& target)
+    {
+        if (flips(a, b, target) || flips(b, a, target))
+            return false;
+
+        m_positions[a] = target;
+        m_quadrics[a] += m_quadrics[b];
+        m_removed[b] = true;
+        ++m_versions[a];
+        ++m_versions[b];
+
+        for (int t : m_vertex_triangles[b])
+        {
+            Triangle& triangle = m_triangles[t];
+            if (triangle.removed)
+                continue;
+            if (std::find(triangle.v.begin(), triangle.v.end(), a) != triangle.v.end())
+            {
+                triangle.removed = true;
+                --m_triangle_count;
+                continue;
+            }
+            std::replace(triangle.v.begin(), triangle.v.end(), b, a);
+            m_vertex_triangles[a].push_back(t);
+        }
+        m_vertex_triangles[b].clear();
+
+        auto& triangles = m_vertex_triangles[a];
+        triangles.erase(std::remove_if(triangles.begin(), triangles.end(), [&](int t) { return m_triangles[t].removed; }), triangles.end());
+
+        // The edges of a changed cost, the old candidates are stale (version)
+        std::unordered_set<int> neighbours;
+        for (int t : triangles)
+        {
+            for (int v : m_triangles[t].v)
+            {
+                if (v != a)
+                    neighbours.insert(v);
+            }
+        }
+        for (int v : neighbours)
+            push_candidate(a, v);
+        return true;
+    }
+};
+
+} // namespace
+
+MeshSimplifier::Result MeshSimplifier::simplify(const std::vector<float>& combined_data, std::size_t target_triangles)
+{
+    if (triangle_count(combined_data) <= target_triangles)
+        return {combined_data, 0.f};
+
+    Simplifier simplifier(combined_data);
+    return simplifier.run(target_triangles);
+}
+
+namespace {
+
+void add_vertex(std::vector<float>& data, const glm::vec3& position, const glm::vec3& normal, const glm::vec2& uv)
+{
+    data.insert(data.end(), {position.x, position.y, position.z, normal.x, normal.y, normal.z, uv.x, uv.y});
+}
+
+// Flat grid in the z = 0 plane, two triangles per cell
+std::vector<float> make_grid(int cells)
+{
+    std::vector<float> data;
+    auto               point = [&](int x, int y) { return glm::vec3(static_cast<float>(x), static_cast<float>(y), 0.f); };
+    for (int y = 0; y < cells; ++y)
+    {
+        for (int x = 0; x < cells; ++x)
+        {
+            const glm::vec3 normal(0.f, 0.f, 1.f);
+            for (glm::ivec2 corner : {glm::ivec2(0, 0), glm::ivec2(1, 0), glm::ivec2(1, 1), glm::ivec2(0, 0), glm::ivec2(1, 1), glm::ivec2(0, 1)})
+                add_vertex(data, point(x + corner.x, y + corner.y), normal, glm::vec2(corner));
+        }
+    }
+    return data;
+}
+
+// Unit UV sphere
+std::vector<float> make_sphere(int slices, int stacks)
+{
+    std::vector<float> data;
+    auto               point = [&](int slice, int stack) {
+        float theta = glm::two_pi<float>() * static_cast<float>(slice % slices) / static_cast<float>(slices);
+        float phi   = glm::pi<float>() * static_cast<float>(stack) / static_cast<float>(stacks);
+        return glm::vec3(std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta));
+    };
+    for (int stack = 0; stack < stacks; ++stack)
+    {
+        for (int slice = 0; slice < slices; ++slice)
+        {
+            glm::vec3 p00 = point(slice, stack), p10 = point(slice + 1, stack);
+            glm::vec3 p01 = point(slice, stack + 1), p11 = point(slice + 1, stack + 1);
+            if (stack != 0)
+            {
+                add_vertex(data, p00, p00, {});
+                add_vertex(data, p10, p10, {});
+                add_vertex(data, p11, p11, {});
+            }
+            if (stack != stacks - 1)
+            {
+                add_vertex(data, p00, p00, {});
+                add_vertex(data, p11, p11, {});
+                add_vertex(data, p01, p01, {});
+            }
+        }
+    }
+    return data;
+}
+
+} // namespace
+
+TEST_CASE("Simplifying a flat grid keeps it flat and exact")
+{
+    std::vector<float> grid = make_grid(20);
+    REQUIRE(MeshSimplifier::triangle_count(grid) == 800);
+
+    MeshSimplifier::Result result = MeshSimplifier::simplify(grid, 80);
+    CHECK(MeshSimplifier::triangle_count(result.combined_data) <= 80);
+    CHECK(MeshSimplifier::triangle_count(result.combined_data) > 0);
+    CHECK(result.error == doctest::Approx(0.f).epsilon(1e-3));
+
+    // Every vertex stays in the plane and inside the original square
+    for (std::size_t i = 0; i < result.combined_data.size(); i += MeshSimplifier::vertex_size)
+    {
+        CHECK(result.combined_data[i + 2] == doctest::Approx(0.f));
+        CHECK(result.combined_data[i] >= -1e-3f);
+        CHECK(result.combined_data[i] <= 20.f + 1e-3f);
+    }
+}
+
+TEST_CASE("Simplifying a sphere bounds the geometric error")
+{
+    std::vector<float> sphere = make_sphere(32, 16);
+    std::size_t        count  = MeshSimplifier::triangle_count(sphere);
+
+    MeshSimplifier::Result half    = MeshSimplifier::simplify(sphere, count / 2);
+    MeshSimplifier::Result quarter = MeshSimplifier::simplify(sphere, count / 4);
+    CHECK(MeshSimplifier::triangle_count(half.combined_data) <= count / 2);
+    CHECK(MeshSimplifier::triangle_count(quarter.combined_data) <= count / 4);
+
+    // Coarser levels cost more
+    CHECK(half.error > 0.f);
+    CHECK(quarter.error >= half.error);
+
+    for (std::size_t i = 0; i < quarter.combined_data.size(); i += MeshSimplifier::vertex_size)
+    {
+        glm::vec3 position(quarter.combined_data[i], quarter.combined_data[i + 1], quarter.combined_data[i + 2]);
+        CHECK(std::abs(glm::length(position) - 1.f) < 0.1f);
+    }
+}
+
+TEST_CASE("Nothing to simplify below the target")
+{
+    std::vector<float>     grid   = make_grid(2);
+    MeshSimplifier::Result result = MeshSimplifier::simplify(grid, 100);
+    CHECK(result.combined_data == grid);
+    CHECK(result.error == 0.f);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Quadric error metric edge collapse (Garland & Heckbert) over the
+// interleaved triangle lists of ModelLoader (position, normal, uv: 8 floats
+// per vertex, 3 vertices per triangle). Corners are welded by position, so
+// normals and uvs follow their corner while positions move.
+class MeshSimplifier
+{
+public:
+    static constexpr std::size_t vertex_size = 8;
+
+    struct Result
+    {
+        std::vector<float> combined_data;
+        float              error = 0.f; // Square root of the largest collapse cost, in model units
+    };
+
+    // Collapse edges until at most target_triangles remain (or nothing can
+    // be collapsed without flipping a face)
+    static Result simplify(const std::vector<float>& combined_data, std::size_t target_triangles);
+
+    static std::size_t triangle_count(const std::vector<float>& combined_data) { return combined_data.size() / (3 * vertex_size); }
+};
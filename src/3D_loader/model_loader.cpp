@@ -1,7 +1,13 @@
 #define TINYOBJLOADER_IMPLEMENTATION
 
 #include "model_loader.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include "doctest/doctest.h"
+#include "mesh_simplifier.hpp"
+#include "profiling/trace.hpp"
 
 ModelLoader::Model ModelLoader::load_model(const std::string& file_path)
 {
@@ -28,7 +34,8 @@ ModelLoader::Model ModelLoader::load_model(const std::string& file_path)
     const auto& attrib = reader.GetAttrib();
     const auto& shapes = reader.GetShapes();
 
-    model = process_model(attrib, shapes);
+    model      = process_model(attrib, shapes);
+    model.lods = load_lod_chain(file_path, model.combined_data);
 
     return model;
 }
@@ -92,5 +99,167 @@ ModelLoader::Model ModelLoader::process_model(const tinyobj::attrib_t& attrib, c
         }
     }
 
+    model.bounding_box    = compute_bounding_box(model.combined_data, 8);
+    model.bounding_sphere = compute_bounding_sphere(model.combined_data, 8, model.bounding_box);
+
     return model;
 }
+
+std::string ModelLoader::lod_path_for(const std::string& file_path)
+{
+    return std::filesystem::path(file_path).replace_extension(".lod").string();
+}
+
+std::vector<ModelLoader::LodLevel> ModelLoader::load_lod_chain(const std::string& file_path, const std::vector<float>& combined_data)
+{
+    std::vector<LodLevel> lods;
+    if (MeshSimplifier::triangle_count(combined_data) < 2 * min_lod_triangles)
+        return lods;
+
+    // Use the cache unless the model was edited since
+    std::string     lod_path = lod_path_for(file_path);
+    std::error_code error;
+    if (std::filesystem::exists(lod_path, error) && std::filesystem::last_write_time(lod_path, error) >= std::filesystem::last_write_time(file_path, error) && read_lod_cache(lod_path, lods))
+    {
+        return lods;
+    }
+
+    lods = generate_lod_chain(combined_data);
+    if (!write_lod_cache(lod_path, lods))
+    {
+        std::cerr << "Could not write the LOD cache " << lod_path << std::endl;
+    }
+    return lods;
+}
+
+std::vector<ModelLoader::LodLevel> ModelLoader::generate_lod_chain(const std::vector<float>& combined_data)
+{
+    TraceScope                trace("ModelLoader::generate_lod_chain");
+    std::vector<LodLevel>     lods;
+    const std::vector<float>* source = &combined_data;
+    float                     error  = 0.f;
+
+    // Halve the triangle count at each level, starting from the previous one
+    while (lods.size() < max_lod_levels)
+    {
+        std::size_t triangles = MeshSimplifier::triangle_count(*source);
+        if (triangles / 2 < min_lod_triangles)
+            break;
+
+        MeshSimplifier::Result result = MeshSimplifier::simplify(*source, triangles / 2);
+        // Stop when the simplifier gets stuck on flips
+        if (MeshSimplifier::triangle_count(result.combined_data) > triangles * 3 / 4)
+            break;
+
+        error += result.error;
+        lods.push_back({std::move(result.combined_data), error});
+        source = &lods.back().combined_data;
+    }
+    return lods;
+}
+
+namespace {
+
+constexpr char          lod_magic[4]      = {'L', 'O', 'D', 'C'};
+constexpr std::uint32_t lod_cache_version = 1;
+
+} // namespace
+
+bool ModelLoader::read_lod_cache(const std::string& lod_path, std::vector<LodLevel>& lods)
+{
+    std::ifstream   file(lod_path, std::ios::binary);
+    std::error_code error;
+    std::uintmax_t  file_size   = std::filesystem::file_size(lod_path, error);
+    char            magic[4];
+    std::uint32_t   version     = 0;
+    std::uint32_t   level_count = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    file.read(reinterpret_cast<char*>(&level_count), sizeof(level_count));
+    if (!file || error || !std::equal(magic, magic + 4, lod_magic) || version != lod_cache_version || level_count > max_lod_levels)
+        return false;
+
+    // Any bad count or short read is a cache miss, the levels are generated again
+    lods.resize(level_count);
+    for (LodLevel& level : lods)
+    {
+        std::uint32_t float_count = 0;
+        file.read(reinterpret_cast<char*>(&level.error), sizeof(level.error));
+        file.read(reinterpret_cast<char*>(&float_count), sizeof(float_count));
+        if (!file || float_count % (3 * MeshSimplifier::vertex_size) != 0 || float_count > file_size / sizeof(float))
+        {
+            lods.clear();
+            return false;
+        }
+        level.combined_data.resize(float_count);
+        if (!file.read(reinterpret_cast<char*>(level.combined_data.data()), float_count * sizeof(float)))
+        {
+            lods.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ModelLoader::write_lod_cache(const std::string& lod_path, const std::vector<LodLevel>& lods)
+{
+    std::ofstream file(lod_path, std::ios::binary);
+    auto          level_count = static_cast<std::uint32_t>(lods.size());
+    file.write(lod_magic, sizeof(lod_magic));
+    file.write(reinterpret_cast<const char*>(&lod_cache_version), sizeof(lod_cache_version));
+    file.write(reinterpret_cast<const char*>(&level_count), sizeof(level_count));
+    for (const LodLevel& level : lods)
+    {
+        auto float_count = static_cast<std::uint32_t>(level.combined_data.size());
+        file.write(reinterpret_cast<const char*>(&level.error), sizeof(level.error));
+        file.write(reinterpret_cast<const char*>(&float_count), sizeof(float_count));
+        file.write(reinterpret_cast<const char*>(level.combined_data.data()), float_count * sizeof(float));
+    }
+    return static_cast<bool>(file);
+}
+
+TEST_CASE("A corrupt LOD cache is a cache miss")
+{
+    const std::filesystem::path obj_path = std::filesystem::temp_directory_path() / "model_loader_test.obj";
+    const std::string           lod_path = ModelLoader::lod_path_for(obj_path.string());
+
+    // 20x20 quads, enough triangles for a LOD chain
+    {
+        std::ofstream obj(obj_path);
+        for (int y = 0; y <= 20; ++y)
+            for (int x = 0; x <= 20; ++x)
+                obj << "v " << x << " " << y << " 0\n";
+        for (int y = 0; y < 20; ++y)
+        {
+            for (int x = 0; x < 20; ++x)
+            {
+                int corner = y * 21 + x + 1;
+                obj << "f " << corner << " " << corner + 1 << " " << corner + 22 << "\n";
+                obj << "f " << corner << " " << corner + 22 << " " << corner + 21 << "\n";
+            }
+        }
+    }
+    std::filesystem::remove(lod_path);
+    ModelLoader::Model generated = ModelLoader::load_model(obj_path.string());
+    REQUIRE_FALSE(generated.lods.empty());
+    REQUIRE(std::filesystem::exists(lod_path));
+
+    // A float count the file cannot hold is refused before the resize
+    {
+        std::fstream  file(lod_path, std::ios::binary | std::ios::in | std::ios::out);
+        std::uint32_t float_count = 0xFFFFFFF0u - 0xFFFFFFF0u % (3 * MeshSimplifier::vertex_size);
+        file.seekp(4 + 4 + 4 + sizeof(float)); // Magic, version, levels, error
+        file.write(reinterpret_cast<const char*>(&float_count), sizeof(float_count));
+    }
+    ModelLoader::Model reloaded = ModelLoader::load_model(obj_path.string());
+    REQUIRE(reloaded.lods.size() == generated.lods.size());
+    CHECK(reloaded.lods[0].combined_data == generated.lods[0].combined_data);
+
+    // So is a short one, the cache was written again above
+    std::filesystem::resize_file(lod_path, std::filesystem::file_size(lod_path) - 4);
+    reloaded = ModelLoader::load_model(obj_path.string());
+    CHECK(reloaded.lods.size() == generated.lods.size());
+
+    std::filesystem::remove(lod_path);
+    std::filesystem::remove(obj_path);
+}
@@ -1,17 +1,40 @@
 #pragma once
 
+#include <cstddef>
 #include <string>
 #include <vector>
+#include "maths/bounds.hpp"
 #include "tiny_obj_loader.h"
 
 class ModelLoader {
 public:
-    struct Model {
+    // Simplified copy of the mesh, same layout as combined_data
+    struct LodLevel {
         std::vector<float> combined_data;
+        float              error; // Accumulated simplification error, in model units
+    };
+
+    struct Model {
+        std::vector<float>    combined_data;
+        BoundingBox           bounding_box;    // Model space
+        BoundingSphere        bounding_sphere; // Model space
+        std::vector<LodLevel> lods;            // Coarser and coarser, may be empty
     };
 
+    static constexpr std::size_t min_lod_triangles = 256; // Smaller meshes get no LOD
+    static constexpr std::size_t max_lod_levels    = 4;
+
     static Model load_model(const std::string& file_path);
 
+    // LOD chain cache next to the model ("x/foo.obj" -> "x/foo.lod")
+    static std::string lod_path_for(const std::string& file_path);
+
 private:
     static Model process_model(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes);
+
+    // Read the cached chain if it is up to date, otherwise simplify and cache
+    static std::vector<LodLevel> load_lod_chain(const std::string& file_path, const std::vector<float>& combined_data);
+    static std::vector<LodLevel> generate_lod_chain(const std::vector<float>& combined_data);
+    static bool                  read_lod_cache(const std::string& lod_path, std::vector<LodLevel>& lods);
+    static bool                  write_lod_cache(const std::string& lod_path, const std::vector<LodLevel>& lods);
 };
@@ -0,0 +1,163 @@
+#include "scene_loader.hpp"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace {
+
+glm::vec2 read_vec2(const json& node, const char* key, const glm::vec2& fallback)
+{
+    if (!node.contains(key))
+    {
+        return fallback;
+    }
+    const auto& value = node.at(key);
+    return {value.at(0).get<float>(), value.at(1).get<float>()};
+}
+
+glm::vec3 read_vec3(const json& node, const char* key, const glm::vec3& fallback)
+{
+    if (!node.contains(key))
+    {
+        return fallback;
+    }
+    const auto& value = node.at(key);
+    return {value.at(0).get<float>(), value.at(1).get<float>(), value.at(2).get<float>()};
+}
+
+SceneLoader::Material read_material(const json& node)
+{
+    SceneLoader::Material material;
+    material.diffuse   = read_vec3(node, "diffuse", material.diffuse);
+    material.specular  = read_vec3(node, "specular", material.specular);
+    material.shininess = node.value("shininess", material.shininess);
+    return material;
+}
+
+} // namespace
+
+SceneLoader::Scene SceneLoader::load_scene(const std::string& file_path)
+{
+    std::ifstream file(file_path);
+    if (!file)
+    {
+        std::cerr << "Cannot open scene file: " << file_path << std::endl;
+        exit(1);
+    }
+
+    Scene scene;
+    scene.packed_textures_directory =
+        std::filesystem::path(file_path).replace_extension(".textures").string();
+    try
+    {
+        json root = json::parse(file);
+
+        if (root.contains("camera"))
+        {
+            const auto& camera        = root.at("camera");
+            scene.camera.center       = read_vec3(camera, "center", scene.camera.center);
+            scene.camera.distance     = camera.value("distance", scene.camera.distance);
+            scene.camera.move_speed   = camera.value("move_speed", scene.camera.move_speed);
+            scene.camera.rotate_speed = camera.value("rotate_speed", scene.camera.rotate_speed);
+        }
+
+        std::map<std::string, Material> materials;
+        const json                      material_nodes = root.value("materials", json::object());
+        for (const auto& [name, material] : material_nodes.items())
+        {
+            materials[name] = read_material(material);
+        }
+
+        for (const auto& node : root.value("objects", json::array()))
+        {
+            Object object;
+            object.name       = node.value("name", "");
+            object.model_path = node.at("model").get<std::string>();
+            if (node.contains("color"))
+            {
+                object.color = read_vec3(node, "color", glm::vec3(1.0f));
+            }
+            else
+            {
+                object.texture_path = node.at("texture").get<std::string>();
+            }
+            object.position  = read_vec3(node, "position", object.position);
+            object.rotation  = read_vec3(node, "rotation", object.rotation);
+            object.scale     = read_vec3(node, "scale", object.scale);
+            object.is_static = node.value("static", false);
+
+            // Either the name of a shared material or an inline definition
+            if (node.contains("material"))
+            {
+                const auto& material = node.at("material");
+                if (material.is_string())
+                {
+                    object.material = materials.at(material.get<std::string>());
+                }
+                else
+                {
+                    object.material = read_material(material);
+                }
+            }
+
+            // "instances": copies of the object, each with its own
+            // transformation and color, named name#index
+            if (!node.contains("instances"))
+            {
+                scene.objects.push_back(object);
+                continue;
+            }
+            const auto& instances = node.at("instances");
+            for (std::size_t i = 0; i < instances.size(); ++i)
+            {
+                const auto& instance = instances[i];
+                Object      copy     = object;
+                copy.name            = object.name + "#" + std::to_string(i);
+                copy.position        = read_vec3(instance, "position", object.position);
+                copy.rotation        = read_vec3(instance, "rotation", object.rotation);
+                copy.scale           = read_vec3(instance, "scale", object.scale);
+                if (object.color)
+                {
+                    copy.color = read_vec3(instance, "color", *object.color);
+                }
+                scene.objects.push_back(copy);
+            }
+        }
+
+        for (const auto& node : root.value("lights", json::array()))
+        {
+            Light light;
+            light.intensity = read_vec3(node, "intensity", glm::vec3(1.0f));
+            if (node.contains("direction"))
+            {
+                light.position = glm::vec4(read_vec3(node, "direction", glm::vec3(0.0f, 1.0f, 0.0f)), 0.0f);
+            }
+            else
+            {
+                light.position = glm::vec4(read_vec3(node, "position", glm::vec3(0.0f)), 1.0f);
+            }
+            scene.lights.push_back(light);
+        }
+
+        for (const auto& node : root.value("fireworks", json::array()))
+        {
+            FireworkEmitter emitter;
+            emitter.spawn_chance  = node.value("spawn_chance", emitter.spawn_chance);
+            emitter.x_range       = read_vec2(node, "x_range", emitter.x_range);
+            emitter.z_range       = read_vec2(node, "z_range", emitter.z_range);
+            emitter.launch_height = node.value("launch_height", emitter.launch_height);
+            scene.emitters.push_back(emitter);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Invalid scene file " << file_path << ": " << e.what() << std::endl;
+        exit(1);
+    }
+
+    return scene;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <optional>
+#include <string>
+#include <vector>
+#include "scene_objects/firework.hpp"
+
+// Plain description of a scene, as read from a JSON scene file
+// (see assets/scenes/station.json)
+class SceneLoader {
+public:
+    struct Material {
+        glm::vec3 diffuse{1.0f, 1.0f, 1.0f};
+        glm::vec3 specular{0.5f, 0.5f, 0.5f};
+        float     shininess = 64.0f;
+    };
+
+    // An object node with an "instances" array gives one Object per entry
+    struct Object {
+        std::string              name;
+        std::string              model_path;
+        std::string              texture_path;
+        std::optional<glm::vec3> color; // Used instead of a texture when set
+        glm::vec3                position{0.0f};
+        glm::vec3                rotation{0.0f};
+        glm::vec3                scale{1.0f};
+        Material                 material;
+        bool                     is_static = false; // Merged into the static batch
+    };
+
+    struct Light {
+        glm::vec4 position;  // World space, w = 0 for a directional light
+        glm::vec3 intensity;
+    };
+
+    struct Camera {
+        glm::vec3 center{-50.0f, 60.0f, -10.0f};
+        float     distance     = 100.0f;
+        float     move_speed   = 10.0f;
+        float     rotate_speed = 2.0f;
+    };
+
+    struct Scene {
+        Camera                       camera;
+        std::vector<Object>          objects;
+        std::vector<Light>           lights;
+        std::vector<FireworkEmitter> emitters;
+        // Texture arrays of the static objects, baked by --bake-textures
+        // ("scenes/station.json" -> "scenes/station.textures")
+        std::string packed_textures_directory;
+    };
+
+    static Scene load_scene(const std::string& file_path);
+};
@@ -14,11 +14,22 @@ private:
   glm::vec3 m_up;
   float m_move_speed;
   float m_rotate_speed;
+  glm::vec3 m_reset_center;
+  float m_reset_distance;
 
 public:
+  // Everything that moves, recorded by SessionLog
+  struct State {
+    glm::vec3 center;
+    float distance;
+    float angle_x;
+    float angle_y;
+  };
+
   TrackballCamera()
       : m_distance(100.0f), m_angle_x(0.0f), m_angle_y(0.0f), m_center(0.0f),
-        m_up(0.0f, 1.0f, 0.0f), m_move_speed(0.5f), m_rotate_speed(0.005f) {}
+        m_up(0.0f, 1.0f, 0.0f), m_move_speed(0.5f), m_rotate_speed(0.005f),
+        m_reset_center(-50.0f, 60.0f, -10.0f), m_reset_distance(100.0f) {}
 
   void move_front(float delta) {
     m_distance -= delta;
@@ -60,8 +71,14 @@ public:
   void reset_camera() {
     m_angle_x = 0.0f;
     m_angle_y = 0.0f;
-    m_distance = 100.0f;
-    m_center = glm::vec3(-50.0f, 60.0f, -10.0f);
+    m_distance = m_reset_distance;
+    m_center = m_reset_center;
+  }
+
+  // State restored by reset_camera()
+  void set_reset_state(const glm::vec3 &center, float distance) {
+    m_reset_center = center;
+    m_reset_distance = distance;
   }
 
   glm::mat4 get_view_matrix() const {
@@ -89,6 +106,16 @@ public:
               << std::endl;
   }
 
+  State get_state() const {
+    return {m_center, m_distance, m_angle_x, m_angle_y};
+  }
+  void set_state(const State &state) {
+    m_center = state.center;
+    m_distance = state.distance;
+    m_angle_x = state.angle_x;
+    m_angle_y = state.angle_y;
+  }
+
   void set_move_speed(float speed) { m_move_speed = speed; }
   void set_rotate_speed(float speed) { m_rotate_speed = speed; }
 };
@@ -1,42 +1,91 @@
+#include "3D_loader/scene_loader.hpp"
 #include "glimac/trackball_camera.hpp"
 #include "glm/ext/matrix_clip_space.hpp"
 #include "glm/fwd.hpp"
 #include "glm/gtc/random.hpp"
 #include "glm/gtc/type_ptr.hpp"
 #include "render/game_object.hpp"
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
+#include <optional>
+#include <random>
 #include <vector>
 #define DOCTEST_CONFIG_IMPLEMENT
 #include "doctest/doctest.h"
 #include "maths/color.hpp"
 #include "maths/random_generator.hpp"
+#include "maths/bvh.hpp"
+#include "memory/frame_arena.hpp"
+#include "render/frame_capture.hpp"
+#include "render/frame_uniforms.hpp"
+#include "render/light_grid.hpp"
+#include "render/light_manager.hpp"
+#include "render/model_cache.hpp"
+#include "render/particle_renderer.hpp"
 #include "render/program.hpp"
+#include "render/render_queue.hpp"
+#include "render/view.hpp"
+#include "profiling/allocation_tracker.hpp"
+#include "profiling/profiler.hpp"
+#include "profiling/profiler_overlay.hpp"
+#include "profiling/trace.hpp"
+#include "replay/session_log.hpp"
+#include "replay/session_replay.hpp"
+#include "render/texture_array.hpp"
+#include "render/texture_compressor.hpp"
 #include "scene_objects/firework.hpp"
-
-struct Light {
-  glm::vec3 position;  // Light position in view space
-  glm::vec3 intensity; // Light intensity
-};
-
-// Variables globales
-std::vector<Firework> fireworks;
-glm::vec3 gravity(0.f, -0.1f, 0.f);
-
-void update_fireworks(Program &program, const glm::mat4 &view_matrix,
-                      const glm::mat4 &proj_matrix) {
-  if (glm::linearRand(0.f, 10.f) < 2.f) {
-    fireworks.push_back(Firework());
+#include "scene_objects/firework_simulation.hpp"
+#include "scene_objects/scene.hpp"
+
+// Bursts rebuilt every frame since fireworks come and go
+Bvh firework_bvh;
+std::vector<BoundingBox> firework_boxes;
+std::vector<int> visible_fireworks;
+
+// Draw the snapshot of the last simulation tick while the worker computes
+// the next one, returned for the session log
+const FireworkSimulation::Snapshot &
+update_fireworks(FireworkSimulation &simulation, Program &program,
+                 LightManager &light_manager,
+                 ParticleRenderer &particle_renderer, RenderQueue &queue,
+                 const View &view, Profiler &profiler) {
+  TraceScope trace("update_fireworks");
+  const FireworkSimulation::Snapshot *snapshot = nullptr;
+  {
+    // Time waited on the worker, the simulation itself overlaps the frame
+    ProfileScope scope(profiler, "simulation");
+    AllocationScope allocations("simulation");
+    snapshot = &simulation.next_frame();
+    for (const FireworkSimulation::Snapshot::Flash &flash :
+         snapshot->flashes) {
+      light_manager.add_flash(flash.position, flash.color);
+    }
   }
 
-  for (auto it = fireworks.begin(); it != fireworks.end();) {
-    it->run(gravity, program, view_matrix, proj_matrix);
-    if (it->done()) {
-      it = fireworks.erase(it);
-    } else {
-      ++it;
+  {
+    ProfileScope scope(profiler, "firework culling");
+    AllocationScope allocations("firework culling");
+    firework_boxes.clear();
+    for (const FireworkSimulation::Snapshot::Burst &burst :
+         snapshot->bursts) {
+      firework_boxes.push_back(burst.bounding_box);
     }
+    firework_bvh.build(firework_boxes);
+    firework_bvh.query_frustum(view.frustum, visible_fireworks);
   }
+
+  ProfileScope scope(profiler, "particle upload");
+  AllocationScope allocations("particle upload");
+  particle_renderer.clear();
+  for (int index : visible_fireworks) {
+    snapshot->draw(snapshot->bursts[index], particle_renderer,
+                   view.camera_position);
+  }
+  particle_renderer.submit(queue, program);
+  return *snapshot;
 }
 
 int time_events(int next_event_time, p6::Context &ctx) {
@@ -53,6 +102,7 @@ int time_events(int next_event_time, p6::Context &ctx) {
 
 void handle_camera_input(p6::Context &ctx, TrackballCamera &camera,
                          float &last_x, float &last_y) {
+  TraceScope trace("handle_camera_input");
 
   ctx.mouse_dragged = [&](p6::MouseDrag drag) {
     float delta_x = drag.position.x - last_x;
@@ -108,151 +158,276 @@ void APIENTRY openglCallbackFunction(GLenum source, GLenum type, GLuint id,
             << ", message = " << message << std::endl;
 }
 
-int main() {
+// Frame times of a windowed replay, the worst frames are the ones to profile
+void print_replay_report(const std::vector<double> &frame_ms,
+                         const std::optional<std::size_t> &divergence) {
+  if (frame_ms.empty())
+    return;
+  double total = 0.0;
+  std::size_t worst = 0;
+  for (std::size_t i = 0; i < frame_ms.size(); ++i) {
+    total += frame_ms[i];
+    if (frame_ms[i] > frame_ms[worst])
+      worst = i;
+  }
+  std::cout << frame_ms.size() << " frames replayed, "
+            << total / static_cast<double>(frame_ms.size())
+            << " ms on average, worst " << frame_ms[worst] << " ms (frame "
+            << worst << ")" << std::endl;
+  if (divergence)
+    std::cerr << "The simulation diverged from the log at frame "
+              << *divergence << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+
+  // Run the unit tests only (used by ctest), remaining arguments go to doctest
+  if (argc >= 2 && std::string(argv[1]) == "--tests") {
+    doctest::Context context(argc - 1, argv + 1);
+    return context.run();
+  }
+
+  // Offline conversion of the textures to KTX, no window needed:
+  // --bake-textures <directory> [scene]. The textures of the static objects
+  // of the scene are also packed into texture arrays
+  if (argc >= 3 && std::string(argv[1]) == "--bake-textures") {
+    int baked = TextureCompressor::bake_directory(argv[2]);
+    std::cout << baked << " textures baked." << std::endl;
+
+    SceneLoader::Scene scene = SceneLoader::load_scene(
+        argc >= 4 ? argv[3] : "assets/scenes/station.json");
+    std::vector<std::string> static_texture_paths;
+    for (const SceneLoader::Object &object : scene.objects) {
+      if (object.is_static && !object.color)
+        static_texture_paths.push_back(object.texture_path);
+    }
+    int packed = TextureArray::bake(static_texture_paths,
+                                    scene.packed_textures_directory);
+    std::cout << packed << " texture arrays baked." << std::endl;
+    return baked > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  // --scene <file>, --trace <frames> (trace of the first frames),
+  // --zero-alloc <report|abort> (needs the TRACK_ALLOCATIONS build option),
+  // --seed <n> (same fireworks on every run), --record <file> (session log
+  // written on exit), --replay <file>, --replay-headless <file> (simulation
+  // only, no window), --render-frames <n> with --render-size <WxH>,
+  // --supersample <s> and --output <directory|-> (offline rendering, "-"
+  // writes raw rgb24 to stdout)
+  std::string scene_path = "assets/scenes/station.json";
+  int trace_frames = 0;
+  std::uint64_t seed = std::random_device{}();
+  std::string record_path;
+  std::string replay_path;
+  bool headless = false;
+  std::size_t render_frames = 0;
+  int render_width = 1920;
+  int render_height = 1080;
+  int supersampling = 1;
+  std::string output_path = "frames";
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string option = argv[i];
+    if (option == "--scene") {
+      scene_path = argv[i + 1];
+    } else if (option == "--trace") {
+      trace_frames = std::atoi(argv[i + 1]);
+    } else if (option == "--seed") {
+      seed = std::strtoull(argv[i + 1], nullptr, 10);
+    } else if (option == "--record") {
+      record_path = argv[i + 1];
+    } else if (option == "--replay" || option == "--replay-headless") {
+      replay_path = argv[i + 1];
+      headless = option == "--replay-headless";
+    } else if (option == "--render-frames") {
+      render_frames = std::strtoull(argv[i + 1], nullptr, 10);
+    } else if (option == "--render-size") {
+      std::sscanf(argv[i + 1], "%dx%d", &render_width, &render_height);
+    } else if (option == "--supersample") {
+      supersampling = std::atoi(argv[i + 1]);
+    } else if (option == "--output") {
+      output_path = argv[i + 1];
+    } else if (option == "--zero-alloc") {
+      AllocationTracker::set_check(std::string(argv[i + 1]) == "abort"
+                                       ? AllocationTracker::Check::Abort
+                                       : AllocationTracker::Check::Report);
+      if (!AllocationTracker::enabled)
+        std::cerr << "--zero-alloc needs a build with TRACK_ALLOCATIONS"
+                  << std::endl;
+    }
+  }
+
+  // stdout carries the frames, the messages go to stderr
+  const bool raw_output = render_frames > 0 && output_path == "-";
+  if (raw_output)
+    std::cout.rdbuf(std::cerr.rdbuf());
+
+  // A replay runs the show of the log, in its scene
+  SessionLog replay;
+  if (!replay_path.empty()) {
+    if (!replay.load(replay_path))
+      return EXIT_FAILURE;
+    seed = replay.get_seed();
+    scene_path = replay.get_scene_path();
+  }
+  SceneLoader::Scene scene_description = SceneLoader::load_scene(scene_path);
+
+  if (headless) {
+    HeadlessReplay result = replay_headless(replay, scene_description.emitters);
+    std::cout << result.frames << " ticks, " << result.average_ms
+              << " ms on average, worst " << result.worst_ms << " ms (frame "
+              << result.worst_frame << ")" << std::endl;
+    if (result.first_divergence) {
+      std::cerr << "The simulation diverged from the log at frame "
+                << *result.first_divergence << std::endl;
+      return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+  }
+
+  // Filled with --record only, events without a frame are dropped
+  SessionLog recording;
+  recording.set_seed(seed);
+  recording.set_scene_path(scene_path);
 
   auto ctx = p6::Context{{1280, 720, "Projet d'honneur - Guilhem Duval"}};
   
-  ctx.maximize_window();
-  ctx.go_fullscreen();
+  // An offline render draws at its own size, no need to take the screen
+  if (render_frames == 0) {
+    ctx.maximize_window();
+    ctx.go_fullscreen();
+  }
   glEnable(GL_DEPTH_TEST);
 
   // Seed the random number generator
   // srand(time(NULL));
 
   TrackballCamera camera;
-  camera.set_move_speed(10.f);
-  camera.set_rotate_speed(2.f);
+  camera.set_move_speed(scene_description.camera.move_speed);
+  camera.set_rotate_speed(scene_description.camera.rotate_speed);
+  camera.set_reset_state(scene_description.camera.center,
+                         scene_description.camera.distance);
   camera.reset_camera();
   Program program{};
-  Light lights[6];
 
   // double next_event_time = 0.0;
 
-  GameObject star_boid_low("assets/models/star_low.obj",
-                           glm::vec3(1.0, 1.0, 1.0));
-  star_boid_low.set_scale(glm::vec3(0.1f, 0.1f, 0.1f));
-  star_boid_low.set_lighting_factors(glm::vec3(0, 0, 0), glm::vec3(0, 0, 0),
-                                     0.0);
-
-  GameObject arrow_y("assets/models/arrow.obj", glm::vec3(0., 1., 0.));
-  arrow_y.set_scale(glm::vec3(5.f, 5.f, 5.f));
-
-  GameObject arrow_z("assets/models/arrow.obj", glm::vec3(0., 0., 1.));
-  arrow_z.set_scale(glm::vec3(5.f, 5.f, 5.f));
-  arrow_z.set_rotation(glm::vec3(90., 0., 0.));
-
-  GameObject arrow_x("assets/models/arrow.obj", glm::vec3(1., 0., 0.));
-  arrow_x.set_scale(glm::vec3(5.f, 5.f, 5.f));
-  arrow_x.set_rotation(glm::vec3(0., 0., -90.));
-
-  GameObject moon("assets/models/moon.obj", "assets/textures/moon.png");
-  moon.set_lighting_factors(glm::vec3(0, 0, 0), glm::vec3(0, 0, 0), 0.0);
-  moon.set_rotation(glm::vec3(0.,10.,0.));
-  moon.set_position(glm::vec3(0.,+80.,0.));
-
-  GameObject night("assets/models/night.obj", "assets/textures/night.png");
-  night.set_lighting_factors(glm::vec3(0, 0, 0), glm::vec3(0, 0, 0), 0.0);
-
-  GameObject ef_dushBoard("assets/models/ef_dushBoard.obj",
-                          "assets/textures/ef_dushBoard.png");
-  GameObject ef_hpipeBoard("assets/models/ef_hpipeBoard.obj",
-                           "assets/textures/ef_hpipeBoard.png");
-  GameObject ef_hpipeBoard2("assets/models/ef_hpipeBoard2.obj",
-                            "assets/textures/ef_hpipeBoard2.png");
-
-  GameObject TR_caveWall("assets/models/"
-                         "TR_caveWall.obj",
-                         "assets/textures/"
-                         "TR_caveWall.png");
-  GameObject TR_chiso("assets/models/TR_chiso.obj", "assets/textures/"
-                                                    "TR_chiso.png");
-  GameObject TR_hari("assets/models/TR_hari.obj", "assets/textures/"
-                                                  "TR_hari.png");
-  GameObject TR_hasira("assets/models/TR_hasira.obj", "assets/textures/"
-                                                      "TR_hasira.png");
-  GameObject TR_houseALL("assets/models/"
-                         "TR_houseALL.obj",
-                         "assets/textures/"
-                         "TR_houseALL.png");
-  GameObject TR_iwa("assets/models/TR_iwa.obj", "assets/textures/TR_iwa.png");
-  GameObject TR_iwa2("assets/models/TR_iwa2.obj", "assets/textures/"
-                                                  "TR_iwa2.png");
-  GameObject TR_jimen("assets/models/TR_jimen.obj", "assets/textures/"
-                                                    "TR_jimen.png");
-  GameObject TR_joint("assets/models/TR_joint.obj", "assets/textures/"
-                                                    "TR_joint.png");
-  GameObject TR_kanbanALL("assets/models/"
-                          "TR_kanbanALL.obj",
-                          "assets/textures/"
-                          "TR_kanbanALL.png");
-  GameObject TR_senro_ura("assets/models/"
-                          "TR_senro_ura.obj",
-                          "assets/textures/"
-                          "TR_senro_ura.png");
-  GameObject TR_senro("assets/models/TR_senro.obj", "assets/textures/"
-                                                    "TR_senro.png");
-
-
-  GameObject TR_teppan("assets/models/TR_teppan.obj", "assets/textures/"
-                                                      "TR_teppan.png");
-  GameObject TR_tesuri("assets/models/TR_tesuri.obj", "assets/textures/"
-                                                      "TR_tesuri.png");
-  GameObject TR_wood("assets/models/TR_wood.obj", "assets/textures/"
-                                                  "TR_wood.png");
-
-  GameObject space_object("assets/models/space.obj", "assets/textures/"
-                                                     "space_texture.jpg");
-
-
-// Métal (brillant, avec un certain niveau de réflexion)
-ef_dushBoard.set_lighting_factors(glm::vec3(0.6f, 0.6f, 0.6f), glm::vec3(0.8f, 0.8f, 0.8f), 32.0f);
-ef_hpipeBoard.set_lighting_factors(glm::vec3(0.6f, 0.6f, 0.6f), glm::vec3(0.8f, 0.8f, 0.8f), 32.0f);
-ef_hpipeBoard2.set_lighting_factors(glm::vec3(0.6f, 0.6f, 0.6f), glm::vec3(0.8f, 0.8f, 0.8f), 32.0f);
-
-// Pierre (matériau rugueux, moins de réflexion)
-TR_caveWall.set_lighting_factors(glm::vec3(0.4f, 0.4f, 0.4f), glm::vec3(0.2f, 0.2f, 0.2f), 8.0f);
-TR_iwa.set_lighting_factors(glm::vec3(0.4f, 0.4f, 0.4f), glm::vec3(0.2f, 0.2f, 0.2f), 8.0f);
-TR_iwa2.set_lighting_factors(glm::vec3(0.4f, 0.4f, 0.4f), glm::vec3(0.2f, 0.2f, 0.2f), 8.0f);
-TR_jimen.set_lighting_factors(glm::vec3(0.4f, 0.4f, 0.4f), glm::vec3(0.2f, 0.2f, 0.2f), 8.0f);
-
-// Bois (réflexion modérée, plus doux que le métal)
-TR_wood.set_lighting_factors(glm::vec3(0.5f, 0.3f, 0.2f), glm::vec3(0.1f, 0.1f, 0.1f), 16.0f);
-TR_houseALL.set_lighting_factors(glm::vec3(0.5f, 0.3f, 0.2f), glm::vec3(0.1f, 0.1f, 0.1f), 16.0f);
-
-// Métal (rails, structures métalliques)
-TR_senro.set_lighting_factors(glm::vec3(0.6f, 0.6f, 0.6f), glm::vec3(0.9f, 0.9f, 0.9f), 32.0f);
-TR_senro_ura.set_lighting_factors(glm::vec3(0.6f, 0.6f, 0.6f), glm::vec3(0.9f, 0.9f, 0.9f), 32.0f);
-TR_teppan.set_lighting_factors(glm::vec3(0.6f, 0.6f, 0.6f), glm::vec3(0.9f, 0.9f, 0.9f), 32.0f);
-
-// Autres objets (structures diverses, ajuster selon leur nature)
-TR_hari.set_lighting_factors(glm::vec3(0.5f, 0.3f, 0.2f), glm::vec3(0.1f, 0.1f, 0.1f), 16.0f); // Bois/metal
-TR_hasira.set_lighting_factors(glm::vec3(0.5f, 0.3f, 0.2f), glm::vec3(0.1f, 0.1f, 0.1f), 16.0f); // Bois
-TR_chiso.set_lighting_factors(glm::vec3(0.4f, 0.4f, 0.4f), glm::vec3(0.2f, 0.2f, 0.2f), 8.0f); // Pierre
-
-// Panneaux (métal peint, brillance moyenne)
-TR_kanbanALL.set_lighting_factors(glm::vec3(0.6f, 0.6f, 0.6f), glm::vec3(0.7f, 0.7f, 0.7f), 16.0f);
-
-// Structures métalliques diverses
-TR_joint.set_lighting_factors(glm::vec3(0.6f, 0.6f, 0.6f), glm::vec3(0.9f, 0.9f, 0.9f), 32.0f);
-TR_tesuri.set_lighting_factors(glm::vec3(0.6f, 0.6f, 0.6f), glm::vec3(0.9f, 0.9f, 0.9f), 32.0f);
-
+  ModelCache model_cache;
+  Scene scene(scene_description, model_cache);
+  ModelCache::Stats model_stats = model_cache.get_stats();
+  std::cout << model_stats.model_count << " models loaded for "
+            << model_stats.misses + model_stats.hits << " objects, "
+            << model_stats.gpu_bytes / 1024 << " KiB of vertex buffers"
+            << std::endl;
+
+  FrameUniforms frame_uniforms;
+  frame_uniforms.attach(program);
+
+  LightManager light_manager;
+  ParticleRenderer particle_renderer;
+  // Steps the fireworks on a worker thread, one frame ahead
+  std::cout << "Fireworks seed " << seed << " (--seed to replay)" << std::endl;
+  FireworkSimulation firework_simulation(scene.get_emitters(), seed);
+
+  // Every draw of a frame goes through the queue, sorted by state. Its
+  // packets are allocated from the frame arena, declared first to outlive
+  // them
+  DoubleFrameArena frame_arena;
+  RenderQueue render_queue;
+  GlStateCache gl_state_cache;
+
+  // Lights in view space, rebuilt every frame without reallocating
+  std::vector<LightData> lights;
+  lights.reserve(scene.get_lights().size() + LightManager::flash_capacity);
+  LightGrid light_grid;
 
   float last_x = 0;
   float last_y = 0;
 
-  float position_light_x;
-  float position_light_y;
-  float position_light_z;
+  // Picking: the ray goes from the near plane to the far plane under the mouse
+  glm::mat4 view_proj_matrix(1.f);
+  auto pick = [&](glm::vec2 ndc) {
+    glm::mat4 inverse = glm::inverse(view_proj_matrix);
+    glm::vec4 near = inverse * glm::vec4(ndc.x, ndc.y, -1.f, 1.f);
+    glm::vec4 far = inverse * glm::vec4(ndc.x, ndc.y, 1.f, 1.f);
+    glm::vec3 origin = glm::vec3(near) / near.w;
+    glm::vec3 direction = glm::normalize(glm::vec3(far) / far.w - origin);
+
+    if (const std::string *name = scene.pick(origin, direction)) {
+      std::cout << "Picked " << *name << std::endl;
+    }
+  };
+  ctx.mouse_pressed = [&](p6::MouseButton button) {
+    if (button.button != p6::Button::Left)
+      return;
+    glm::vec2 ndc(button.position.x / ctx.aspect_ratio(), button.position.y);
+    recording.add_event({SessionLog::EventType::Pick, 0, glm::vec3(ndc, 0.f)});
+    pick(ndc);
+  };
+
+  // F1 shows or hides the frame timings, T starts and ends a trace
+  Profiler profiler;
+  ProfilerOverlay profiler_overlay;
+  auto press_key = [&](int key) {
+    if (key == GLFW_KEY_F1) {
+      profiler_overlay.toggle();
+    } else if (key == GLFW_KEY_T) {
+      if (Tracer::is_enabled()) {
+        Tracer::stop();
+        Tracer::write_json("trace.json");
+      } else {
+        Tracer::start();
+      }
+    }
+  };
+  ctx.key_pressed = [&](p6::Key key) {
+    recording.add_event({SessionLog::EventType::Key, key.physical});
+    press_key(key.physical);
+  };
 
-  lights[0].intensity = glm::vec3(1.1f*3, 1.0f*3, 0.7f*3);
-  lights[1].intensity = glm::vec3(0.0f, 5.0f/2, 3.8f/2);
+  // Frame times of the replay, for the comparison between builds
+  std::size_t replay_frame = 0;
+  std::vector<double> replay_ms;
+  replay_ms.reserve(replay.get_frame_count());
+  std::optional<std::size_t> divergence;
+
+  // Offline rendering: one simulation tick per frame whatever the frame
+  // rate, each frame drawn at the capture size instead of the window's
+  std::optional<FrameCapture> capture;
+  if (render_frames > 0) {
+    capture.emplace(render_width, render_height, supersampling,
+                    raw_output ? FrameCapture::raw_writer(stdout)
+                               : FrameCapture::png_writer(output_path));
+    std::cout << "Rendering " << render_frames << " frames of "
+              << capture->get_width() << "x" << capture->get_height()
+              << ", supersampled " << capture->get_supersampling() << "x"
+              << std::endl;
+  }
 
-  lights[2].intensity = glm::vec3(1.92f*4, 1.77f*4, 1.29f*4);
-  lights[3].intensity = glm::vec3(1.92f*4, 1.77f*4, 1.29f*4);
-  lights[4].intensity = glm::vec3(1.92f*4, 1.77f*4, 1.29f*4);
-  lights[5].intensity = glm::vec3(6 * 1.92f, 6 * 1.77f, 6 * 1.29f);
+  Tracer::set_thread_name("main");
+  if (trace_frames > 0)
+    Tracer::capture_frames(trace_frames);
 
   ctx.update = [&]() {
+    const bool replaying = !replay_path.empty();
+    if (replaying && replay_frame == replay.get_frame_count()) {
+      print_replay_report(replay_ms, divergence);
+      ctx.stop();
+      return;
+    }
+    if (capture && capture->get_frame_count() == render_frames) {
+      ctx.stop();
+      return;
+    }
+    auto frame_start = std::chrono::steady_clock::now();
+
+    const bool traced = Tracer::is_enabled();
+    if (traced)
+      Tracer::begin("frame");
+    profiler.begin_frame();
+    AllocationTracker::begin_frame();
+    frame_arena.begin_frame();
+    render_queue.begin_frame(&frame_arena.current());
+
     glEnable(GL_DEBUG_OUTPUT);
     glDebugMessageCallback(openglCallbackFunction, nullptr);
 
@@ -263,121 +438,125 @@ TR_tesuri.set_lighting_factors(glm::vec3(0.6f, 0.6f, 0.6f), glm::vec3(0.9f, 0.9f
 
     // next_event_time = time_events(next_event_time, ctx);
 
-    // ImGui::Begin("Position of the light");
-    // ImGui::SliderFloat("X", &position_light_x, -200.f, 200.f);
-    // ImGui::SliderFloat("Y", &position_light_y, -200.f, 200.f);
-    // ImGui::SliderFloat("Z", &position_light_z, -200.f, 200.f);
-    // ImGui::End();
-
+    if (capture)
+      capture->begin_frame();
     glClearColor(0.f, 0.f, 0.f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    handle_camera_input(ctx, camera, last_x, last_y);
+    if (replaying) {
+      camera.set_state(replay.get_camera(replay_frame));
+    } else if (!capture) {
+      handle_camera_input(ctx, camera, last_x, last_y);
+      if (!record_path.empty())
+        recording.add_frame(camera.get_state());
+    }
 
     glm::mat4 view_matrix = camera.get_view_matrix();
 
+    const float aspect_ratio =
+        capture ? static_cast<float>(capture->get_width()) /
+                      static_cast<float>(capture->get_height())
+                : ctx.aspect_ratio();
     glm::mat4 proj_matrix =
-        glm::perspective(glm::radians(90.f), ctx.aspect_ratio(), 0.1f, 10000.f);
-
-    lights[0].position = glm::vec3(view_matrix * glm::vec4(-0.5, 1, 1, 0.0));
-    lights[1].position =
-        glm::vec3(view_matrix * glm::vec4(-38., 50., 33., 1.0));
-
-    lights[2].position =
-        glm::vec3(view_matrix * glm::vec4(-31., 35., -58., 1.0));
-
-    lights[3].position = glm::vec3(view_matrix * glm::vec4(-30, 34, -85, 1.0));
-
-    lights[4].position = glm::vec3(view_matrix * glm::vec4(-92, 55, 165, 1.0));
-
-    lights[5].position = glm::vec3(view_matrix * glm::vec4(-79, 32, -152, 1.0));
-
-    star_boid_low.set_position(
-        {position_light_x, position_light_y, position_light_z});
-
-    program.use();
-
-    // Définir les positions des
-    // lumières
-    glUniform3fv(program.u_light_pos_vs_0, 1,
-                 glm::value_ptr(lights[0].position));
-    glUniform3fv(program.u_light_pos_vs_1, 1,
-                 glm::value_ptr(lights[1].position));
-    glUniform3fv(program.u_light_pos_vs_2, 1,
-                 glm::value_ptr(lights[2].position));
-    glUniform3fv(program.u_light_pos_vs_3, 1,
-                 glm::value_ptr(lights[3].position));
-    glUniform3fv(program.u_light_pos_vs_4, 1,
-                 glm::value_ptr(lights[4].position));
-    glUniform3fv(program.u_light_pos_vs_5, 1,
-                 glm::value_ptr(lights[5].position));
-
-    // Définir les intensités des
-    // lumières
-    glUniform3fv(program.u_light_intensity_0, 1,
-                 glm::value_ptr(lights[0].intensity));
-    glUniform3fv(program.u_light_intensity_1, 1,
-                 glm::value_ptr(lights[1].intensity));
-    glUniform3fv(program.u_light_intensity_2, 1,
-                 glm::value_ptr(lights[2].intensity));
-    glUniform3fv(program.u_light_intensity_3, 1,
-                 glm::value_ptr(lights[3].intensity));
-    glUniform3fv(program.u_light_intensity_4, 1,
-                 glm::value_ptr(lights[4].intensity));
-    glUniform3fv(program.u_light_intensity_5, 1,
-                 glm::value_ptr(lights[5].intensity));
-    glEnable(GL_CULL_FACE);
-
-    // star_boid_low.render_game_object(program, view_matrix, proj_matrix);
-
-    // TR_sky.render_game_object(program,
-    // view_matrix, proj_matrix);
-
-    night.render_game_object(program, view_matrix, proj_matrix);
-    moon.render_game_object(program, view_matrix, proj_matrix);
-
-    ef_dushBoard.render_game_object(program, view_matrix, proj_matrix);
-
-    // ef_hpipeBoard3.render_game_object(program,
-    // view_matrix, proj_matrix);
-    ef_hpipeBoard.render_game_object(program, view_matrix, proj_matrix);
-    ef_hpipeBoard2.render_game_object(program, view_matrix, proj_matrix);
-
-    TR_caveWall.render_game_object(program, view_matrix, proj_matrix);
-    TR_chiso.render_game_object(program, view_matrix, proj_matrix);
-    TR_hari.render_game_object(program, view_matrix, proj_matrix);
-    TR_hasira.render_game_object(program, view_matrix, proj_matrix);
-    TR_houseALL.render_game_object(program, view_matrix, proj_matrix);
-    TR_iwa.render_game_object(program, view_matrix, proj_matrix);
-    TR_iwa2.render_game_object(program, view_matrix, proj_matrix);
-    TR_jimen.render_game_object(program, view_matrix, proj_matrix);
-    TR_joint.render_game_object(program, view_matrix, proj_matrix);
-    TR_kanbanALL.render_game_object(program, view_matrix, proj_matrix);
-
-    // TR_spot1.render_game_object(program,
-    // view_matrix, proj_matrix);
-    TR_teppan.render_game_object(program, view_matrix, proj_matrix);
-    TR_tesuri.render_game_object(program, view_matrix, proj_matrix);
-    TR_wood.render_game_object(program, view_matrix, proj_matrix);
-
-    TR_senro_ura.render_game_object(program, view_matrix, proj_matrix);
-    TR_senro.render_game_object(program, view_matrix, proj_matrix);
-
-    // TR_SF_shadow.render_game_object(program, view_matrix, proj_matrix);
-    // shadow.render_game_object(program, view_matrix, proj_matrix);
-
-    glCullFace(GL_FRONT);
-    // space_object.render_game_object(program,
-    // view_matrix, proj_matrix);
-
-    glCullFace(GL_BACK);
-    // arrow_z.render_game_object(program, view_matrix, proj_matrix);
-    // arrow_y.render_game_object(program, view_matrix, proj_matrix);
-    // arrow_x.render_game_object(program, view_matrix, proj_matrix);
+        glm::perspective(glm::radians(90.f), aspect_ratio, 0.1f, 10000.f);
+
+    // Définir les positions et les intensités des lumières
+    profiler.begin_cpu("lights");
+    if (traced)
+      Tracer::begin("light upload");
+    lights.clear();
+    for (const SceneLoader::Light &light : scene.get_lights()) {
+      lights.push_back(
+          {view_matrix * light.position, glm::vec4(light.intensity, 0.f)});
+    }
+    light_manager.update();
+    light_manager.append_lights(view_matrix, lights);
+    light_grid.build(lights, proj_matrix);
+    profiler.end_cpu();
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    profiler.begin_cpu("uniform upload");
+    frame_uniforms.update(view_matrix, proj_matrix, lights, &light_grid,
+                          glm::vec2(viewport[2], viewport[3]));
+    profiler.end_cpu();
+    if (traced)
+      Tracer::end("light upload");
+
+    view_proj_matrix = proj_matrix * view_matrix;
+    View view(view_matrix, proj_matrix);
+    profiler.begin_cpu("scene culling");
+    {
+      AllocationScope allocations("scene culling");
+      scene.submit(render_queue, program, view);
+    }
+    profiler.end_cpu();
+    const FireworkSimulation::Snapshot &snapshot =
+        update_fireworks(firework_simulation, program, light_manager,
+                         particle_renderer, render_queue, view, profiler);
+    if (replaying) {
+      if (!divergence &&
+          !same_spawns(replay.get_events(replay_frame), snapshot.spawns))
+        divergence = replay_frame;
+    } else if (!record_path.empty()) {
+      for (const FireworkSimulation::Snapshot::Spawn &spawn :
+           snapshot.spawns) {
+        recording.add_event({SessionLog::EventType::Spawn,
+                             static_cast<std::int32_t>(spawn.emitter),
+                             spawn.position});
+      }
+    }
 
+    // Culling does not apply to the points of the transparent pass
+    glEnable(GL_CULL_FACE);
+    {
+      AllocationScope allocations("render queue");
+      render_queue.execute(gl_state_cache, &profiler);
+    }
     glDisable(GL_CULL_FACE);
-    update_fireworks(program, view_matrix, proj_matrix);
+
+    // The streamed segments of this frame are fenced after their last use
+    scene.end_frame();
+    particle_renderer.end_frame();
+    frame_uniforms.end_frame();
+    if (capture)
+      capture->end_frame();
+
+    // The overlay shows the counts of the frame before
+    AllocationTracker::end_frame();
+    profiler.end_frame();
+    profiler_overlay.draw(profiler);
+
+    if (traced)
+      Tracer::end("frame");
+    Tracer::end_frame();
+
+    // Events of the frame, recorded after it
+    if (replaying) {
+      replay_ms.push_back(std::chrono::duration<double, std::milli>(
+                              std::chrono::steady_clock::now() - frame_start)
+                              .count());
+      for (const SessionLog::Event &event : replay.get_events(replay_frame)) {
+        if (event.type == SessionLog::EventType::Key)
+          press_key(event.value);
+        else if (event.type == SessionLog::EventType::Pick)
+          pick(glm::vec2(event.position.x, event.position.y));
+      }
+      ++replay_frame;
+    }
   };
 
   ctx.start();
+
+  if (capture) {
+    capture->flush();
+    std::cout << capture->get_written_count() << " frames written to "
+              << (raw_output ? "stdout" : output_path) << std::endl;
+    if (capture->has_failed())
+      return EXIT_FAILURE;
+  }
+
+  if (!record_path.empty() && recording.save(record_path))
+    std::cout << recording.get_frame_count() << " frames recorded to "
+              << record_path << std::endl;
 }
@@ -0,0 +1,67 @@
+#include "bounds.hpp"
+#include <algorithm>
+#include <cmath>
+
+BoundingBox compute_bounding_box(const std::vector<float>& data, std::size_t stride)
+{
+    if (data.size() < 3)
+        return {};
+
+    BoundingBox box{glm::vec3(data[0], data[1], data[2]), glm::vec3(data[0], data[1], data[2])};
+    for (std::size_t i = 0; i + 3 <= data.size(); i += stride)
+    {
+        glm::vec3 point(data[i], data[i + 1], data[i + 2]);
+        box.min = glm::min(box.min, point);
+        box.max = glm::max(box.max, point);
+    }
+    return box;
+}
+
+BoundingSphere compute_bounding_sphere(const std::vector<float>& data, std::size_t stride, const BoundingBox& box)
+{
+    BoundingSphere sphere{box.center(), 0.f};
+    float          radius2 = 0.f;
+    for (std::size_t i = 0; i + 3 <= data.size(); i += stride)
+    {
+        glm::vec3 offset = glm::vec3(data[i], data[i + 1], data[i + 2]) - sphere.center;
+        radius2          = std::max(radius2, glm::dot(offset, offset));
+    }
+    sphere.radius = std::sqrt(radius2);
+    return sphere;
+}
+
+BoundingBox transform(const BoundingBox& box, const glm::mat4& matrix)
+{
+    glm::vec3 center = glm::vec3(matrix * glm::vec4(box.center(), 1.f));
+    glm::vec3 extent = (box.max - box.min) * 0.5f;
+
+    glm::vec3 world_extent(0.f);
+    for (int column = 0; column < 3; ++column)
+        world_extent += glm::abs(glm::vec3(matrix[column])) * extent[column];
+
+    return {center - world_extent, center + world_extent};
+}
+
+BoundingSphere transform(const BoundingSphere& sphere, const glm::mat4& matrix)
+{
+    float scale2 = std::max({glm::dot(glm::vec3(matrix[0]), glm::vec3(matrix[0])),
+                             glm::dot(glm::vec3(matrix[1]), glm::vec3(matrix[1])),
+                             glm::dot(glm::vec3(matrix[2]), glm::vec3(matrix[2]))});
+    return {glm::vec3(matrix * glm::vec4(sphere.center, 1.f)), sphere.radius * std::sqrt(scale2)};
+}
+
+void SphereSet::clear()
+{
+    x.clear();
+    y.clear();
+    z.clear();
+    radius.clear();
+}
+
+void SphereSet::push_back(const BoundingSphere& sphere)
+{
+    x.push_back(sphere.center.x);
+    y.push_back(sphere.center.y);
+    z.push_back(sphere.center.z);
+    radius.push_back(sphere.radius);
+}
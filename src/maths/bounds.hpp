@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+
+struct BoundingBox
+{
+    glm::vec3 min{0.f};
+    glm::vec3 max{0.f};
+
+    glm::vec3 center() const { return (min + max) * 0.5f; }
+};
+
+struct BoundingSphere
+{
+    glm::vec3 center{0.f};
+    float     radius = 0.f;
+};
+
+// Box and sphere of a set of points (xyz every `stride` floats), the sphere
+// is centered on the box and encloses every point
+BoundingBox    compute_bounding_box(const std::vector<float>& data, std::size_t stride);
+BoundingSphere compute_bounding_sphere(const std::vector<float>& data, std::size_t stride, const BoundingBox& box);
+
+// Bounds under an affine transform: the box stays axis aligned (Arvo), the
+// sphere radius grows with the largest axis scale
+BoundingBox    transform(const BoundingBox& box, const glm::mat4& matrix);
+BoundingSphere transform(const BoundingSphere& sphere, const glm::mat4& matrix);
+
+// Spheres stored as separate coordinate arrays, tested several at a time
+struct SphereSet
+{
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    std::vector<float> radius;
+
+    std::size_t size() const { return radius.size(); }
+    void        clear();
+    void        push_back(const BoundingSphere& sphere);
+};
@@ -0,0 +1,469 @@
+#include "bvh.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include "doctest/doctest.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include "random_stream.hpp"
+
+BoundingBox merge(const BoundingBox& a, const BoundingBox& b)
+{
+    return {glm::min(a.min, b.min), glm::max(a.max, b.max)};
+}
+
+float surface_area(const BoundingBox& box)
+{
+    glm::vec3 size = glm::max(box.max - box.min, glm::vec3(0.f));
+    return 2.f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+bool contains(const BoundingBox& box, const glm::vec3& point)
+{
+    return point.x >= box.min.x && point.y >= box.min.y && point.z >= box.min.z && point.x <= box.max.x && point.y <= box.max.y && point.z <= box.max.z;
+}
+
+bool overlaps(const BoundingBox& box, const BoundingSphere& sphere)
+{
+    glm::vec3 offset = glm::clamp(sphere.center, box.min, box.max) - sphere.center;
+    return glm::dot(offset, offset) <= sphere.radius * sphere.radius;
+}
+
+bool ray_box_entry(const glm::vec3& origin, const glm::vec3& inverse_direction, const BoundingBox& box, float max_distance, float& entry)
+{
+    glm::vec3 t0   = (box.min - origin) * inverse_direction;
+    glm::vec3 t1   = (box.max - origin) * inverse_direction;
+    glm::vec3 near = glm::min(t0, t1);
+    glm::vec3 far  = glm::max(t0, t1);
+
+    float t_enter = std::max({near.x, near.y, near.z, 0.f});
+    float t_exit  = std::min({far.x, far.y, far.z, max_distance});
+    entry         = t_enter;
+    return t_enter <= t_exit;
+}
+
+void Bvh::build(const std::vector<BoundingBox>& boxes)
+{
+    m_nodes.clear();
+    m_boxes = boxes;
+    m_indices.resize(boxes.size());
+    std::iota(m_indices.begin(), m_indices.end(), 0);
+    if (boxes.empty())
+        return;
+
+    m_centroids.resize(boxes.size());
+    for (std::size_t i = 0; i < boxes.size(); ++i)
+        m_centroids[i] = boxes[i].center();
+
+    m_nodes.reserve(2 * boxes.size());
+    m_nodes.push_back({{}, 0, static_cast<int>(boxes.size())});
+    subdivide(0, 0);
+}
+
+void Bvh::fit_leaf(Node& node) const
+{
+    node.box = m_boxes[m_indices[node.first]];
+    for (int i = 1; i < node.count; ++i)
+        node.box = merge(node.box, m_boxes[m_indices[node.first + i]]);
+}
+
+void Bvh::subdivide(int node_index, int depth)
+{
+    fit_leaf(m_nodes[node_index]);
+    const int first = m_nodes[node_index].first;
+    const int count = m_nodes[node_index].count;
+    // The query stacks hold at most one entry per level
+    if (count <= max_leaf_size || depth + 1 >= max_depth)
+        return;
+
+    BoundingBox centroid_bounds{m_centroids[m_indices[first]], m_centroids[m_indices[first]]};
+    for (int i = first + 1; i < first + count; ++i)
+        centroid_bounds = merge(centroid_bounds, {m_centroids[m_indices[i]], m_centroids[m_indices[i]]});
+
+    // Binned SAH: evaluate bin_count - 1 split planes on every axis
+    int   best_axis  = -1;
+    int   best_split = 0;
+    float best_cost  = std::numeric_limits<float>::max();
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float extent = centroid_bounds.max[axis] - centroid_bounds.min[axis];
+        if (extent <= 0.f)
+            continue;
+
+        struct Bin
+        {
+            BoundingBox box;
+            int         count = 0;
+        };
+        std::array<Bin, bin_count> bins{};
+        float                      scale = bin_count / extent;
+        for (int i = first; i < first + count; ++i)
+        {
+            int  index = m_indices[i];
+            int  b     = std::min(bin_count - 1, static_cast<int>((m_centroids[index][axis] - centroid_bounds.min[axis]) * scale));
+            Bin& bin   = bins[b];
+            bin.box    = bin.count == 0 ? m_boxes[index] : merge(bin.box, m_boxes[index]);
+            ++bin.count;
+        }
+
+        // Left to right sweep, then right to left while evaluating the cost
+        std::array<float, bin_count - 1> left_area{};
+        std::array<int, bin_count - 1>   left_count{};
+        BoundingBox                      box;
+        int                              total = 0;
+        for (int b = 0; b < bin_count - 1; ++b)
+        {
+            if (bins[b].count > 0)
+                box = total == 0 ? bins[b].box : merge(box, bins[b].box);
+            total += bins[b].count;
+            left_area[b]  = total == 0 ? 0.f : surface_area(box);
+            left_count[b] = total;
+        }
+        total = 0;
+        for (int b = bin_count - 1; b > 0; --b)
+        {
+            if (bins[b].count > 0)
+                box = total == 0 ? bins[b].box : merge(box, bins[b].box);
+            total += bins[b].count;
+            if (total == 0 || left_count[b - 1] == 0)
+                continue;
+            float cost = left_count[b - 1] * left_area[b - 1] + total * surface_area(box);
+            if (cost < best_cost)
+            {
+                best_cost  = cost;
+                best_axis  = axis;
+                best_split = b;
+            }
+        }
+    }
+
+    if (best_axis < 0)
+        return; // Every centroid at the same place, keep a leaf
+
+    // Small nodes stay leaves unless splitting beats testing every object
+    if (count <= 4 * max_leaf_size && best_cost >= count * surface_area(m_nodes[node_index].box))
+        return;
+
+    float scale  = bin_count / (centroid_bounds.max[best_axis] - centroid_bounds.min[best_axis]);
+    auto  middle = std::partition(m_indices.begin() + first, m_indices.begin() + first + count, [&](int index) {
+        int b = std::min(bin_count - 1, static_cast<int>((m_centroids[index][best_axis] - centroid_bounds.min[best_axis]) * scale));
+        return b < best_split;
+    });
+    int left_count = static_cast<int>(middle - (m_indices.begin() + first));
+
+    int left_index = static_cast<int>(m_nodes.size());
+    m_nodes.push_back({{}, first, left_count});
+    m_nodes.push_back({{}, first + left_count, count - left_count});
+    m_nodes[node_index].first = left_index;
+    m_nodes[node_index].count = 0;
+
+    subdivide(left_index, depth + 1);
+    subdivide(left_index + 1, depth + 1);
+}
+
+void Bvh::refit(const std::vector<BoundingBox>& boxes)
+{
+    m_boxes = boxes;
+
+    // Children are always stored after their parent
+    for (auto node = m_nodes.rbegin(); node != m_nodes.rend(); ++node)
+    {
+        if (node->count > 0)
+            fit_leaf(*node);
+        else
+            node->box = merge(m_nodes[node->first].box, m_nodes[node->first + 1].box);
+    }
+}
+
+void Bvh::query_frustum(const Frustum& frustum, std::vector<int>& result) const
+{
+    result.clear();
+    if (m_nodes.empty())
+        return;
+
+    std::array<int, max_depth> stack{};
+    int                        size = 0;
+    stack[size++]                   = 0;
+    while (size > 0)
+    {
+        const Node& node = m_nodes[stack[--size]];
+        if (!frustum.intersects(node.box))
+            continue;
+
+        if (node.count > 0)
+        {
+            for (int i = node.first; i < node.first + node.count; ++i)
+            {
+                if (node.count == 1 || frustum.intersects(m_boxes[m_indices[i]]))
+                    result.push_back(m_indices[i]);
+            }
+        }
+        else
+        {
+            stack[size++] = node.first;
+            stack[size++] = node.first + 1;
+        }
+    }
+}
+
+void Bvh::query_sphere(const BoundingSphere& sphere, std::vector<int>& result) const
+{
+    result.clear();
+    if (m_nodes.empty())
+        return;
+
+    std::array<int, max_depth> stack{};
+    int                        size = 0;
+    stack[size++]                   = 0;
+    while (size > 0)
+    {
+        const Node& node = m_nodes[stack[--size]];
+        if (!overlaps(node.box, sphere))
+            continue;
+
+        if (node.count > 0)
+        {
+            for (int i = node.first; i < node.first + node.count; ++i)
+            {
+                if (node.count == 1 || overlaps(m_boxes[m_indices[i]], sphere))
+                    result.push_back(m_indices[i]);
+            }
+        }
+        else
+        {
+            stack[size++] = node.first;
+            stack[size++] = node.first + 1;
+        }
+    }
+}
+
+bool Bvh::ray_cast(const glm::vec3& origin, const glm::vec3& direction, float max_distance, RayHit& hit) const
+{
+    hit = RayHit{-1, max_distance};
+    if (m_nodes.empty())
+        return false;
+
+    glm::vec3 inverse_direction = 1.f / direction;
+
+    std::array<int, max_depth> stack{};
+    int                        size = 0;
+    stack[size++]                   = 0;
+    while (size > 0)
+    {
+        const Node& node = m_nodes[stack[--size]];
+        float       entry;
+        if (!ray_box_entry(origin, inverse_direction, node.box, hit.distance, entry))
+            continue;
+
+        if (node.count > 0)
+        {
+            for (int i = node.first; i < node.first + node.count; ++i)
+            {
+                const BoundingBox& box = m_boxes[m_indices[i]];
+                if (contains(box, origin))
+                    continue;
+                if (ray_box_entry(origin, inverse_direction, box, hit.distance, entry) && entry < hit.distance)
+                    hit = RayHit{m_indices[i], entry};
+            }
+        }
+        else
+        {
+            // Visit the nearest child first so the hit distance shrinks early
+            float left_entry, right_entry;
+            bool  left  = ray_box_entry(origin, inverse_direction, m_nodes[node.first].box, hit.distance, left_entry);
+            bool  right = ray_box_entry(origin, inverse_direction, m_nodes[node.first + 1].box, hit.distance, right_entry);
+            if (left && right)
+            {
+                bool left_first = left_entry <= right_entry;
+                stack[size++]   = left_first ? node.first + 1 : node.first;
+                stack[size++]   = left_first ? node.first : node.first + 1;
+            }
+            else if (left || right)
+            {
+                stack[size++] = left ? node.first : node.first + 1;
+            }
+        }
+    }
+    return hit.index >= 0;
+}
+
+namespace {
+
+// Uniform in the cube [min, max]^3, one draw per statement
+glm::vec3 random_point(RandomStream& random, float min, float max)
+{
+    glm::vec3 point;
+    point.x = random.uniform(min, max);
+    point.y = random.uniform(min, max);
+    point.z = random.uniform(min, max);
+    return point;
+}
+
+glm::vec3 random_direction(RandomStream& random)
+{
+    glm::vec3 direction;
+    do
+    {
+        direction = random.in_ball(1.f);
+    } while (glm::dot(direction, direction) < 1e-4f);
+    return glm::normalize(direction);
+}
+
+std::vector<BoundingBox> random_boxes(RandomStream& random, int count, float world_size, float max_size)
+{
+    std::vector<BoundingBox> boxes;
+    boxes.reserve(count);
+    for (int i = 0; i < count; ++i)
+    {
+        glm::vec3 center = random_point(random, -world_size, world_size);
+        glm::vec3 extent = random_point(random, 0.1f, max_size);
+        boxes.push_back({center - extent, center + extent});
+    }
+    return boxes;
+}
+
+} // namespace
+
+TEST_CASE("BVH queries match a brute force scan")
+{
+    // Fixed seed, a failure can be replayed
+    RandomStream             random(35);
+    std::vector<BoundingBox> boxes = random_boxes(random, 2000, 500.f, 10.f);
+    Bvh                      bvh;
+    bvh.build(boxes);
+
+    auto check_frustum = [&]() {
+        glm::mat4 view_proj = glm::perspective(glm::radians(70.f), 1.5f, 0.1f, 400.f) * glm::lookAt(glm::vec3(0.f, 20.f, 300.f), glm::vec3(50.f, 0.f, 0.f), glm::vec3(0.f, 1.f, 0.f));
+        Frustum   frustum(view_proj);
+
+        std::vector<int> result;
+        bvh.query_frustum(frustum, result);
+        std::sort(result.begin(), result.end());
+
+        std::vector<int> expected;
+        for (int i = 0; i < static_cast<int>(boxes.size()); ++i)
+        {
+            if (frustum.intersects(boxes[i]))
+                expected.push_back(i);
+        }
+        CHECK(result == expected);
+    };
+    check_frustum();
+
+    SUBCASE("Sphere overlap")
+    {
+        BoundingSphere   sphere{glm::vec3(10.f, -30.f, 40.f), 80.f};
+        std::vector<int> result;
+        bvh.query_sphere(sphere, result);
+        std::sort(result.begin(), result.end());
+
+        std::vector<int> expected;
+        for (int i = 0; i < static_cast<int>(boxes.size()); ++i)
+        {
+            if (overlaps(boxes[i], sphere))
+                expected.push_back(i);
+        }
+        CHECK(result == expected);
+    }
+
+    SUBCASE("Ray cast returns the nearest box")
+    {
+        for (int ray = 0; ray < 100; ++ray)
+        {
+            glm::vec3 origin    = random_point(random, -600.f, 600.f);
+            glm::vec3 direction = random_direction(random);
+
+            Bvh::RayHit expected{-1, 2000.f};
+            for (int i = 0; i < static_cast<int>(boxes.size()); ++i)
+            {
+                const BoundingBox& box = boxes[i];
+                if (contains(box, origin))
+                    continue;
+                float entry;
+                if (ray_box_entry(origin, 1.f / direction, box, expected.distance, entry) && entry < expected.distance)
+                    expected = {i, entry};
+            }
+
+            Bvh::RayHit hit;
+            CHECK(bvh.ray_cast(origin, direction, 2000.f, hit) == (expected.index >= 0));
+            CHECK(hit.index == expected.index);
+            if (expected.index >= 0)
+                CHECK(hit.distance == doctest::Approx(expected.distance));
+        }
+    }
+
+    SUBCASE("Refit after moving every box")
+    {
+        for (BoundingBox& box : boxes)
+        {
+            glm::vec3 offset = random_point(random, -30.f, 30.f);
+            box.min += offset;
+            box.max += offset;
+        }
+        bvh.refit(boxes);
+        check_frustum();
+    }
+}
+
+TEST_CASE("BVH handles degenerate inputs")
+{
+    Bvh              bvh;
+    std::vector<int> result;
+
+    bvh.build({});
+    bvh.query_sphere({glm::vec3(0.f), 10.f}, result);
+    CHECK(result.empty());
+
+    // Identical boxes cannot be split, they end in a single leaf
+    std::vector<BoundingBox> boxes(100, BoundingBox{glm::vec3(-1.f), glm::vec3(1.f)});
+    bvh.build(boxes);
+    bvh.query_sphere({glm::vec3(0.f), 0.5f}, result);
+    CHECK(result.size() == 100);
+}
+
+// Run with --tests --no-skip -tc="BVH benchmark"
+TEST_CASE("BVH benchmark" * doctest::skip())
+{
+    using clock = std::chrono::steady_clock;
+    auto elapsed_ms = [](clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+    };
+
+    RandomStream             random(35);
+    std::vector<BoundingBox> boxes = random_boxes(random, 20000, 2000.f, 10.f);
+    Frustum                  frustum(glm::perspective(glm::radians(90.f), 16.f / 9.f, 0.1f, 500.f) * glm::lookAt(glm::vec3(0.f), glm::vec3(1.f, 0.f, 0.f), glm::vec3(0.f, 1.f, 0.f)));
+    std::vector<int>         result;
+
+    Bvh  bvh;
+    auto start = clock::now();
+    bvh.build(boxes);
+    MESSAGE("build of " << boxes.size() << " boxes: " << elapsed_ms(start) << " ms, " << bvh.get_node_count() << " nodes");
+
+    start = clock::now();
+    bvh.refit(boxes);
+    MESSAGE("refit: " << elapsed_ms(start) << " ms");
+
+    start = clock::now();
+    bvh.query_frustum(frustum, result);
+    MESSAGE("frustum query: " << elapsed_ms(start) << " ms, " << result.size() << " visible");
+
+    start           = clock::now();
+    std::size_t hit = 0;
+    for (BoundingBox& box : boxes)
+        hit += frustum.intersects(box) ? 1 : 0;
+    MESSAGE("brute force frustum: " << elapsed_ms(start) << " ms, " << hit << " visible");
+
+    start = clock::now();
+    Bvh::RayHit ray_hit;
+    int         hits = 0;
+    for (int ray = 0; ray < 10000; ++ray)
+        hits += bvh.ray_cast(glm::vec3(0.f), random_direction(random), 10000.f, ray_hit) ? 1 : 0;
+    MESSAGE("10000 ray casts: " << elapsed_ms(start) << " ms, " << hits << " hits");
+
+    start = clock::now();
+    for (int query = 0; query < 10000; ++query)
+        bvh.query_sphere({random_point(random, -2000.f, 2000.f), 50.f}, result);
+    MESSAGE("10000 sphere queries: " << elapsed_ms(start) << " ms");
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "bounds.hpp"
+#include "frustum.hpp"
+
+// Bounding volume hierarchy over axis aligned boxes, CPU only. The tree is
+// built with the surface area heuristic (binned); objects that move keep the
+// same topology and only refit their boxes. Queries return indices into the
+// box array given to build().
+class Bvh
+{
+public:
+    struct RayHit
+    {
+        int   index    = -1;
+        float distance = 0.f;
+    };
+
+    void build(const std::vector<BoundingBox>& boxes);
+
+    // Update the node boxes after the objects moved, same count as build()
+    void refit(const std::vector<BoundingBox>& boxes);
+
+    // Objects whose box touches the volume
+    void query_frustum(const Frustum& frustum, std::vector<int>& result) const;
+    void query_sphere(const BoundingSphere& sphere, std::vector<int>& result) const;
+
+    // Nearest box entered by the ray within max_distance, boxes containing
+    // the origin are ignored (the ray starts inside them)
+    bool ray_cast(const glm::vec3& origin, const glm::vec3& direction, float max_distance, RayHit& hit) const;
+
+    std::size_t get_node_count() const { return m_nodes.size(); }
+    bool        empty() const { return m_nodes.empty(); }
+
+private:
+    struct Node
+    {
+        BoundingBox box;
+        int         first = 0; // Leaf: first entry of m_indices, inner: left child (right is first + 1)
+        int         count = 0; // Number of objects, 0 for an inner node
+    };
+
+    static constexpr int max_leaf_size = 4;
+    static constexpr int bin_count     = 12;
+    static constexpr int max_depth     = 64;
+
+    std::vector<Node>        m_nodes;
+    std::vector<int>         m_indices;
+    std::vector<BoundingBox> m_boxes;     // Copy of the object boxes, tested at the leaves
+    std::vector<glm::vec3>   m_centroids; // Build scratch
+
+    void subdivide(int node_index, int depth);
+    void fit_leaf(Node& node) const;
+};
+
+// Box helpers shared by the hierarchy and its tests
+BoundingBox merge(const BoundingBox& a, const BoundingBox& b);
+float       surface_area(const BoundingBox& box);
+bool        contains(const BoundingBox& box, const glm::vec3& point);
+bool        overlaps(const BoundingBox& box, const BoundingSphere& sphere);
+// Entry distance of a ray in a box (0 if the origin is inside), false if missed
+bool        ray_box_entry(const glm::vec3& origin, const glm::vec3& inverse_direction, const BoundingBox& box, float max_distance, float& entry);
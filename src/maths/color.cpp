@@ -1,5 +1,4 @@
 #include "color.hpp"
-#include "random_generator.hpp"
 
 Color hsv_to_rgb(float h, float s, float v)
 {
@@ -23,13 +22,10 @@ Color hsv_to_rgb(float h, float s, float v)
     return rgb;
 }
 
-Color generate_vivid_color()
+Color generate_vivid_color(RandomStream& random)
 {
-    float h = static_cast<float>(discrete_uniform_distribution(0, 360)) / 360.0f; // Hue value between 0 and 1
-    float s = 0.7f;                                                               // High saturation for vivid colors
-    float v = 0.9f;                                                               // High value for vivid colors
-
-    glm::vec3 rgb = hsv_to_rgb(h, s, v);
-
-    return (rgb);
-}
\ No newline at end of file
+    float h = static_cast<float>(random.uniform_int(0, 360)) / 360.0f; // Hue value between 0 and 1
+    float s = 0.7f;                                                    // High saturation for vivid colors
+    float v = 0.9f;                                                    // High value for vivid colors
+    return hsv_to_rgb(h, s, v);
+}
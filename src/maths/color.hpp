@@ -1,8 +1,9 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include "random_stream.hpp"
 
 using Color = glm::vec3;
 
 Color hsv_to_rgb(float h, float s, float v);
-Color generate_vivid_color();
\ No newline at end of file
+Color generate_vivid_color(RandomStream& random);
\ No newline at end of file
@@ -0,0 +1,149 @@
+#include "frustum.hpp"
+#include <cstddef>
+#include "doctest/doctest.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include "random_stream.hpp"
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FRUSTUM_USE_SSE
+#endif
+
+Frustum::Frustum(const glm::mat4& view_proj_matrix)
+{
+    // Rows of the matrix (glm is column major)
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; ++i)
+        rows[i] = glm::vec4(view_proj_matrix[0][i], view_proj_matrix[1][i], view_proj_matrix[2][i], view_proj_matrix[3][i]);
+
+    m_planes[0] = rows[3] + rows[0]; // Left
+    m_planes[1] = rows[3] - rows[0]; // Right
+    m_planes[2] = rows[3] + rows[1]; // Bottom
+    m_planes[3] = rows[3] - rows[1]; // Top
+    m_planes[4] = rows[3] + rows[2]; // Near
+    m_planes[5] = rows[3] - rows[2]; // Far
+
+    for (glm::vec4& plane : m_planes)
+        plane /= glm::length(glm::vec3(plane));
+}
+
+bool Frustum::intersects(const BoundingSphere& sphere) const
+{
+    for (const glm::vec4& plane : m_planes)
+    {
+        if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius)
+            return false;
+    }
+    return true;
+}
+
+bool Frustum::intersects(const BoundingBox& box) const
+{
+    for (const glm::vec4& plane : m_planes)
+    {
+        // Corner of the box furthest along the plane normal
+        glm::vec3 corner(plane.x >= 0.f ? box.max.x : box.min.x,
+                         plane.y >= 0.f ? box.max.y : box.min.y,
+                         plane.z >= 0.f ? box.max.z : box.min.z);
+        if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.f)
+            return false;
+    }
+    return true;
+}
+
+void Frustum::cull(const SphereSet& spheres, std::vector<std::uint8_t>& visible) const
+{
+    const std::size_t count = spheres.size();
+    visible.resize(count);
+
+    std::size_t i = 0;
+#ifdef FRUSTUM_USE_SSE
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 x      = _mm_loadu_ps(&spheres.x[i]);
+        __m128 y      = _mm_loadu_ps(&spheres.y[i]);
+        __m128 z      = _mm_loadu_ps(&spheres.z[i]);
+        __m128 radius = _mm_loadu_ps(&spheres.radius[i]);
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+        for (const glm::vec4& plane : m_planes)
+        {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+                                         _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+            inside          = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_sub_ps(_mm_setzero_ps(), radius)));
+        }
+
+        int mask       = _mm_movemask_ps(inside);
+        visible[i]     = static_cast<std::uint8_t>(mask & 1);
+        visible[i + 1] = static_cast<std::uint8_t>((mask >> 1) & 1);
+        visible[i + 2] = static_cast<std::uint8_t>((mask >> 2) & 1);
+        visible[i + 3] = static_cast<std::uint8_t>((mask >> 3) & 1);
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        visible[i] = intersects(BoundingSphere{glm::vec3(spheres.x[i], spheres.y[i], spheres.z[i]), spheres.radius[i]}) ? 1 : 0;
+    }
+}
+
+TEST_CASE("Frustum planes are extracted from an orthographic projection")
+{
+    Frustum frustum(glm::ortho(-10.f, 10.f, -5.f, 5.f, 1.f, 100.f));
+
+    // Inward normals, the camera looks down -z
+    const std::array<glm::vec4, 6> expected = {
+        glm::vec4(1.f, 0.f, 0.f, 10.f),   // Left
+        glm::vec4(-1.f, 0.f, 0.f, 10.f),  // Right
+        glm::vec4(0.f, 1.f, 0.f, 5.f),    // Bottom
+        glm::vec4(0.f, -1.f, 0.f, 5.f),   // Top
+        glm::vec4(0.f, 0.f, -1.f, -1.f),  // Near
+        glm::vec4(0.f, 0.f, 1.f, 100.f)}; // Far
+    for (std::size_t i = 0; i < expected.size(); ++i)
+    {
+        CAPTURE(i);
+        for (int c = 0; c < 4; ++c)
+            CHECK(frustum.get_planes()[i][c] == doctest::Approx(expected[i][c]).epsilon(1e-4));
+    }
+}
+
+TEST_CASE("Frustum culling of a sphere set matches the scalar test")
+{
+    Frustum   frustum(glm::ortho(-10.f, 10.f, -5.f, 5.f, 1.f, 100.f));
+    SphereSet spheres;
+    spheres.push_back({glm::vec3(0.f, 0.f, -50.f), 1.f});    // Inside
+    spheres.push_back({glm::vec3(50.f, 0.f, -50.f), 1.f});   // Right of it
+    spheres.push_back({glm::vec3(10.f, 0.f, -50.f), 2.f});   // Across the right plane
+    spheres.push_back({glm::vec3(0.f, 0.f, 5.f), 1.f});      // Behind the camera
+    spheres.push_back({glm::vec3(0.f, 0.f, 0.f), 1.5f});     // Across the near plane
+    spheres.push_back({glm::vec3(0.f, 7.f, -50.f), 1.f});    // Above it
+    spheres.push_back({glm::vec3(0.f, -5.5f, -50.f), 1.f});  // Across the bottom plane
+    spheres.push_back({glm::vec3(0.f, 0.f, -150.f), 10.f});  // Past the far plane
+    spheres.push_back({glm::vec3(0.f, 0.f, -105.f), 10.f});  // Across the far plane
+    spheres.push_back({glm::vec3(-9.f, 4.f, -2.f), 0.5f});   // Inside, in a corner
+    spheres.push_back({glm::vec3(-12.f, 7.f, -50.f), 1.f});  // Outside, past a corner
+    const std::vector<std::uint8_t> expected = {1, 0, 1, 0, 1, 0, 1, 0, 1, 1, 0};
+
+    // 11 spheres: two SSE batches and a tail of 3
+    std::vector<std::uint8_t> visible;
+    frustum.cull(spheres, visible);
+    CHECK(visible == expected);
+
+    // Many more, around a perspective frustum
+    Frustum perspective(glm::perspective(glm::radians(60.f), 1.5f, 0.5f, 200.f) * glm::lookAt(glm::vec3(0.f, 10.f, 50.f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f)));
+    RandomStream random(34);
+    spheres.clear();
+    for (int i = 0; i < 1003; ++i)
+        spheres.push_back({random.in_ball(250.f), random.uniform(0.1f, 20.f)});
+    perspective.cull(spheres, visible);
+    REQUIRE(visible.size() == spheres.size());
+    int mismatches = 0;
+    int visible_count = 0;
+    for (std::size_t i = 0; i < spheres.size(); ++i)
+    {
+        BoundingSphere sphere{glm::vec3(spheres.x[i], spheres.y[i], spheres.z[i]), spheres.radius[i]};
+        mismatches += visible[i] != (perspective.intersects(sphere) ? 1 : 0);
+        visible_count += visible[i];
+    }
+    CHECK(mismatches == 0);
+    CHECK(visible_count > 0);
+    CHECK(visible_count < static_cast<int>(spheres.size()));
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "bounds.hpp"
+
+// View frustum as six inward facing planes (xyz: unit normal, w: distance),
+// extracted from a view-projection matrix (Gribb & Hartmann)
+class Frustum
+{
+public:
+    Frustum() = default;
+    explicit Frustum(const glm::mat4& view_proj_matrix);
+
+    bool intersects(const BoundingSphere& sphere) const;
+    bool intersects(const BoundingBox& box) const;
+
+    // visible[i] = 1 if sphere i touches the frustum, 0 otherwise. Four
+    // spheres are tested per iteration with SSE2 when available.
+    void cull(const SphereSet& spheres, std::vector<std::uint8_t>& visible) const;
+
+    const std::array<glm::vec4, 6>& get_planes() const { return m_planes; }
+
+private:
+    std::array<glm::vec4, 6> m_planes{};
+};
@@ -0,0 +1,89 @@
+#include "random_stream.hpp"
+#include "doctest/doctest.h"
+
+RandomStream::RandomStream(std::uint64_t seed, std::uint64_t stream)
+    : m_increment((stream << 1u) | 1u)
+{
+    // Initialisation de référence de PCG
+    next();
+    m_state += seed;
+    next();
+}
+
+std::uint32_t RandomStream::next()
+{
+    std::uint64_t old_state = m_state;
+    m_state                 = old_state * 6364136223846793005ULL + m_increment;
+    auto xor_shifted        = static_cast<std::uint32_t>(((old_state >> 18u) ^ old_state) >> 27u);
+    auto rotation           = static_cast<std::uint32_t>(old_state >> 59u);
+    return (xor_shifted >> rotation) | (xor_shifted << ((-rotation) & 31u));
+}
+
+float RandomStream::uniform(float min, float max)
+{
+    // 24 bits, exactly representable in a float
+    float unit = static_cast<float>(next() >> 8) * (1.f / 16777216.f);
+    return min + (max - min) * unit;
+}
+
+int RandomStream::uniform_int(int min, int max)
+{
+    // Rejection to avoid the modulo bias
+    auto          range     = static_cast<std::uint32_t>(max - min) + 1u;
+    std::uint32_t threshold = (0u - range) % range;
+    std::uint32_t value     = next();
+    while (value < threshold)
+    {
+        value = next();
+    }
+    return min + static_cast<int>(value % range);
+}
+
+glm::vec3 RandomStream::in_ball(float radius)
+{
+    glm::vec3 point;
+    do
+    {
+        // Drawn in order, the evaluation order of arguments is unspecified
+        point.x = uniform(-1.f, 1.f);
+        point.y = uniform(-1.f, 1.f);
+        point.z = uniform(-1.f, 1.f);
+    } while (glm::dot(point, point) > 1.f);
+    return point * radius;
+}
+
+RandomStream RandomStream::fork()
+{
+    // One draw per statement, the order of the operands of | is unspecified
+    std::uint64_t seed = next();
+    seed               = (seed << 32u) | next();
+    std::uint64_t stream = next();
+    stream               = (stream << 32u) | next();
+    return RandomStream(seed, stream);
+}
+
+TEST_CASE("Random streams are reproducible and independent")
+{
+    RandomStream a(42, 0);
+    RandomStream b(42, 0);
+    RandomStream other(42, 1);
+    int          same_as_other = 0;
+    for (int i = 0; i < 1000; ++i)
+    {
+        std::uint32_t value = a.next();
+        CHECK(value == b.next());
+        same_as_other += value == other.next();
+    }
+    CHECK(same_as_other < 5);
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        float f = a.uniform(-2.f, 3.f);
+        CHECK(f >= -2.f);
+        CHECK(f < 3.f);
+        int n = a.uniform_int(0, 360);
+        CHECK(n >= 0);
+        CHECK(n <= 360);
+        CHECK(glm::length(a.in_ball(2.f)) <= 2.f);
+    }
+}
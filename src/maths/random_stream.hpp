@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// Seeded random number generator (PCG32, O'Neill 2014) with its own state,
+// unlike rand() and glm::linearRand which share a global one. The same seed
+// and stream give the same sequence on every platform and thread, so each
+// emitter and each firework draws from its own stream.
+class RandomStream
+{
+public:
+    // Streams with the same seed but a different index are independent
+    explicit RandomStream(std::uint64_t seed = 0x853c49e6748fea9bULL, std::uint64_t stream = 0);
+
+    std::uint32_t next();
+
+    // Uniform in [min, max)
+    float uniform(float min, float max);
+    // Uniform in [min, max], both included
+    int uniform_int(int min, int max);
+    // Uniform in the ball of the given radius (like glm::ballRand)
+    glm::vec3 in_ball(float radius);
+
+    // New stream seeded from this one, for an object it spawns
+    RandomStream fork();
+
+private:
+    std::uint64_t m_state     = 0;
+    std::uint64_t m_increment = 1; // Odd, selects the stream
+};
@@ -0,0 +1,124 @@
+#include "frame_arena.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <vector>
+#include "doctest/doctest.h"
+
+namespace {
+
+std::size_t align_up(std::size_t value, std::size_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+} // namespace
+
+FrameArena::FrameArena(std::size_t capacity,
+                       std::pmr::memory_resource *upstream)
+    : m_upstream(upstream) {
+  allocate_block(capacity);
+}
+
+FrameArena::~FrameArena() {
+  free_overflows();
+  if (m_block)
+    m_upstream->deallocate(m_block, m_capacity, alignof(std::max_align_t));
+}
+
+void FrameArena::allocate_block(std::size_t capacity) {
+  if (m_block)
+    m_upstream->deallocate(m_block, m_capacity, alignof(std::max_align_t));
+  m_block = nullptr;
+  m_capacity = 0;
+  if (capacity > 0) {
+    m_block = static_cast<std::byte *>(
+        m_upstream->allocate(capacity, alignof(std::max_align_t)));
+    m_capacity = capacity;
+  }
+}
+
+void *FrameArena::do_allocate(std::size_t bytes, std::size_t alignment) {
+  // The block start is only aligned on max_align_t, align the address
+  auto address = reinterpret_cast<std::uintptr_t>(m_block) + m_used;
+  std::size_t offset =
+      m_used + (align_up(address, alignment) - address);
+  if (offset + bytes <= m_capacity) {
+    m_used = offset + bytes;
+    m_peak = std::max(m_peak, get_used());
+    return m_block + offset;
+  }
+
+  // Plus assez de place, the header precedes the returned address
+  alignment = std::max(alignment, alignof(Overflow));
+  std::size_t header = align_up(sizeof(Overflow), alignment);
+  auto *overflow = static_cast<Overflow *>(
+      m_upstream->allocate(header + bytes, alignment));
+  *overflow = {m_overflows, header + bytes, alignment};
+  m_overflows = overflow;
+  ++m_overflow_count;
+  m_overflow_bytes += header + bytes;
+  m_peak = std::max(m_peak, get_used());
+  return reinterpret_cast<std::byte *>(overflow) + header;
+}
+
+void FrameArena::free_overflows() {
+  while (m_overflows) {
+    Overflow *next = m_overflows->next;
+    m_upstream->deallocate(m_overflows, m_overflows->size,
+                           m_overflows->alignment);
+    m_overflows = next;
+  }
+  m_overflow_count = 0;
+  m_overflow_bytes = 0;
+}
+
+void FrameArena::reset() {
+  bool overflowed = m_overflows != nullptr;
+  free_overflows();
+  // Room for the largest frame so far, the next ones stay in the block
+  if (overflowed)
+    allocate_block(std::bit_ceil(m_peak));
+  m_used = 0;
+}
+
+TEST_CASE("Frame arena hands out aligned memory and grows to the peak") {
+  FrameArena arena(256);
+
+  void *a = arena.allocate(3, 1);
+  void *b = arena.allocate(16, 16);
+  CHECK(reinterpret_cast<std::uintptr_t>(b) % 16 == 0);
+  CHECK(static_cast<std::byte *>(b) >= static_cast<std::byte *>(a) + 3);
+  CHECK(arena.get_overflow_count() == 0);
+
+  // A vector growing past the block overflows to the upstream resource
+  {
+    std::pmr::vector<int> values(&arena);
+    for (int i = 0; i < 100; ++i)
+      values.push_back(i);
+    CHECK(values[99] == 99);
+  }
+  CHECK(arena.get_overflow_count() > 0);
+
+  std::size_t peak = arena.get_peak();
+  arena.reset();
+  CHECK(arena.get_used() == 0);
+  CHECK(arena.get_capacity() >= peak);
+
+  // The same frame again fits in the grown block
+  {
+    std::pmr::vector<int> values(&arena);
+    for (int i = 0; i < 100; ++i)
+      values.push_back(i);
+  }
+  CHECK(arena.get_overflow_count() == 0);
+
+  // The data of a frame survives the next one
+  DoubleFrameArena arenas(64);
+  arenas.begin_frame();
+  auto *value = static_cast<int *>(arenas.current().allocate(sizeof(int)));
+  *value = 42;
+  arenas.begin_frame();
+  CHECK(arenas.previous().get_used() > 0);
+  CHECK(arenas.current().get_used() == 0);
+  CHECK(*value == 42);
+}
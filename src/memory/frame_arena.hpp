@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+// Bump allocator for data living one frame: allocating moves an offset,
+// deallocating does nothing and reset() frees everything at once. It is a
+// std::pmr::memory_resource, so std::pmr containers can allocate from it.
+// What does not fit goes to the upstream resource until the next reset,
+// which grows the block to the largest frame seen: once the frames have
+// reached their steady state the upstream is never called.
+class FrameArena : public std::pmr::memory_resource {
+public:
+  static constexpr std::size_t default_capacity = std::size_t(1) << 20;
+
+  explicit FrameArena(
+      std::size_t capacity = default_capacity,
+      std::pmr::memory_resource *upstream = std::pmr::new_delete_resource());
+  ~FrameArena() override;
+
+  // Empêcher la copie
+  FrameArena(const FrameArena &) = delete;
+  FrameArena &operator=(const FrameArena &) = delete;
+
+  // Everything allocated since the last reset becomes invalid
+  void reset();
+
+  // Bytes allocated since the last reset, padding included
+  std::size_t get_used() const { return m_used + m_overflow_bytes; }
+  std::size_t get_capacity() const { return m_capacity; }
+  std::size_t get_peak() const { return m_peak; }
+  // Allocations that went to the upstream resource since the last reset
+  std::size_t get_overflow_count() const { return m_overflow_count; }
+
+private:
+  // Header of an upstream allocation, the arena frees them at reset
+  struct Overflow {
+    Overflow *next;
+    std::size_t size; // Header included
+    std::size_t alignment;
+  };
+
+  std::pmr::memory_resource *m_upstream;
+  std::byte *m_block = nullptr;
+  std::size_t m_capacity = 0;
+  std::size_t m_used = 0;
+  std::size_t m_peak = 0;
+  Overflow *m_overflows = nullptr;
+  std::size_t m_overflow_count = 0;
+  std::size_t m_overflow_bytes = 0;
+
+  void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+  void do_deallocate(void *, std::size_t, std::size_t) override {}
+  bool do_is_equal(const std::pmr::memory_resource &other) const
+      noexcept override {
+    return this == &other;
+  }
+
+  void allocate_block(std::size_t capacity);
+  void free_overflows();
+};
+
+// Two arenas used in turn: the data of a frame stays valid during the next
+// one, for data read one frame later (GPU uploads, a pipelined producer).
+class DoubleFrameArena {
+public:
+  explicit DoubleFrameArena(
+      std::size_t capacity = FrameArena::default_capacity)
+      : m_arenas{FrameArena(capacity), FrameArena(capacity)} {}
+
+  // Swap the arenas and reset the one of two frames ago. Call at the start
+  // of each frame
+  void begin_frame() {
+    m_current ^= 1;
+    m_arenas[m_current].reset();
+  }
+
+  FrameArena &current() { return m_arenas[m_current]; }
+  FrameArena &previous() { return m_arenas[m_current ^ 1]; }
+
+private:
+  FrameArena m_arenas[2];
+  int m_current = 0;
+};
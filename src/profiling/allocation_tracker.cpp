@@ -0,0 +1,203 @@
+#include "allocation_tracker.hpp"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include "doctest/doctest.h"
+
+namespace {
+
+std::atomic<std::size_t> total_allocations{0};
+std::atomic<std::size_t> total_bytes{0};
+std::atomic<std::size_t> total_frees{0};
+
+// Trivial types only, operator new may run before anything is constructed
+struct ThreadState {
+  AllocationTracker::Counters counters;
+  const char *scope = nullptr;
+  AllocationTracker::Counters scope_start;
+  bool checking = false;     // In a steady state frame
+  bool frame_failed = false; // Already reported this frame
+};
+thread_local ThreadState thread_state;
+
+// Frames are only delimited by the main thread
+AllocationTracker::Counters frame_start;
+AllocationTracker::Counters last_frame;
+std::size_t frame_count = 0;
+AllocationTracker::Check check_mode = AllocationTracker::Check::Off;
+std::size_t warmup_end = 0; // First steady state frame
+std::size_t failed_frames = 0;
+std::array<AllocationTracker::Scope, AllocationTracker::max_scopes> scopes;
+
+AllocationTracker::Counters operator-(const AllocationTracker::Counters &a,
+                                      const AllocationTracker::Counters &b) {
+  return {a.allocations - b.allocations, a.bytes - b.bytes, a.frees - b.frees};
+}
+
+} // namespace
+
+void AllocationTracker::on_allocation(std::size_t size) {
+  total_allocations.fetch_add(1, std::memory_order_relaxed);
+  total_bytes.fetch_add(size, std::memory_order_relaxed);
+  ThreadState &state = thread_state;
+  ++state.counters.allocations;
+  state.counters.bytes += size;
+
+  if (state.checking && !state.frame_failed) {
+    // Reported once per frame, without allocating
+    state.frame_failed = true;
+    std::fprintf(stderr,
+                 "Allocation of %zu bytes in steady state frame %zu\n", size,
+                 frame_count);
+    if (check_mode == Check::Abort)
+      std::abort();
+  }
+}
+
+void AllocationTracker::on_free() {
+  total_frees.fetch_add(1, std::memory_order_relaxed);
+  ++thread_state.counters.frees;
+}
+
+AllocationTracker::Counters AllocationTracker::get_total() {
+  return {total_allocations.load(std::memory_order_relaxed),
+          total_bytes.load(std::memory_order_relaxed),
+          total_frees.load(std::memory_order_relaxed)};
+}
+
+void AllocationTracker::begin_frame() {
+  frame_start = get_total();
+  thread_state.frame_failed = false;
+  thread_state.checking = check_mode != Check::Off && frame_count >= warmup_end;
+}
+
+void AllocationTracker::end_frame() {
+  thread_state.checking = false;
+  last_frame = get_total() - frame_start;
+  if (thread_state.frame_failed)
+    ++failed_frames;
+  ++frame_count;
+
+  for (Scope &scope : scopes) {
+    scope.last_frame = scope.frame;
+    scope.frame = Counters();
+  }
+}
+
+AllocationTracker::Counters AllocationTracker::get_last_frame() {
+  return last_frame;
+}
+
+std::size_t AllocationTracker::get_frame_count() { return frame_count; }
+
+void AllocationTracker::set_check(Check check, std::size_t warmup_frames) {
+  check_mode = check;
+  warmup_end = frame_count + warmup_frames;
+}
+
+std::size_t AllocationTracker::get_failed_frames() { return failed_frames; }
+
+const std::array<AllocationTracker::Scope, AllocationTracker::max_scopes> &
+AllocationTracker::get_scopes() {
+  return scopes;
+}
+
+void AllocationTracker::begin_scope(const char *name) {
+  thread_state.scope = name;
+  thread_state.scope_start = thread_state.counters;
+}
+
+void AllocationTracker::end_scope() {
+  const char *name = thread_state.scope;
+  if (name == nullptr)
+    return;
+  thread_state.scope = nullptr;
+  Counters delta = thread_state.counters - thread_state.scope_start;
+
+  for (Scope &scope : scopes) {
+    if (scope.name == nullptr)
+      scope.name = name;
+    if (scope.name == name) {
+      scope.frame.allocations += delta.allocations;
+      scope.frame.bytes += delta.bytes;
+      scope.frame.frees += delta.frees;
+      return;
+    }
+  }
+}
+
+#ifdef TRACK_ALLOCATIONS
+
+// Aligned forms keep the library versions, they are not counted
+void *operator new(std::size_t size) {
+  AllocationTracker::on_allocation(size);
+  if (void *pointer = std::malloc(size == 0 ? 1 : size))
+    return pointer;
+  throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) { return ::operator new(size); }
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  AllocationTracker::on_allocation(size);
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &tag) noexcept {
+  return ::operator new(size, tag);
+}
+
+void operator delete(void *pointer) noexcept {
+  if (pointer == nullptr)
+    return;
+  AllocationTracker::on_free();
+  std::free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept { ::operator delete(pointer); }
+
+void operator delete(void *pointer, std::size_t) noexcept {
+  ::operator delete(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) noexcept {
+  ::operator delete(pointer);
+}
+
+#endif
+
+TEST_CASE("Allocation tracker counts the allocations of a frame") {
+  if (!AllocationTracker::enabled)
+    return; // Built without TRACK_ALLOCATIONS
+
+  AllocationTracker::begin_frame();
+  {
+    AllocationScope scope("vector");
+    std::vector<int> values(256);
+  }
+  std::vector<int> outside(16);
+  AllocationTracker::end_frame();
+
+  AllocationTracker::Counters frame = AllocationTracker::get_last_frame();
+  CHECK(frame.allocations >= 2);
+  CHECK(frame.bytes >= 272 * sizeof(int));
+  const AllocationTracker::Scope &scope = AllocationTracker::get_scopes()[0];
+  REQUIRE(scope.name != nullptr);
+  CHECK(scope.last_frame.allocations == 1);
+  CHECK(scope.last_frame.bytes == 256 * sizeof(int));
+  CHECK(scope.last_frame.frees == 1);
+
+  // A steady state frame that allocates is flagged
+  AllocationTracker::set_check(AllocationTracker::Check::Report, 0);
+  std::size_t failed = AllocationTracker::get_failed_frames();
+  AllocationTracker::begin_frame();
+  AllocationTracker::end_frame();
+  CHECK(AllocationTracker::get_failed_frames() == failed);
+  AllocationTracker::begin_frame();
+  { std::vector<int> values(4); }
+  AllocationTracker::end_frame();
+  CHECK(AllocationTracker::get_failed_frames() == failed + 1);
+  AllocationTracker::set_check(AllocationTracker::Check::Off);
+}
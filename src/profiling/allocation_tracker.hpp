@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+// Heap allocations counted by the global operator new, replaced when the
+// TRACK_ALLOCATIONS option is on (cmake -DTRACK_ALLOCATIONS=ON). Counts are
+// kept for the whole process, per frame and per named scope. Once the frame
+// loop reaches its steady state, any allocation made by the main thread
+// during a frame can be reported or abort, for the zero allocation target.
+// Without the option every call is a no-op and every count stays at 0.
+class AllocationTracker {
+public:
+#ifdef TRACK_ALLOCATIONS
+  static constexpr bool enabled = true;
+#else
+  static constexpr bool enabled = false;
+#endif
+
+  struct Counters {
+    std::size_t allocations = 0;
+    std::size_t bytes = 0; // Requested, frees are not subtracted
+    std::size_t frees = 0;
+  };
+
+  struct Scope {
+    const char *name = nullptr;
+    Counters frame; // Frame in progress
+    Counters last_frame;
+  };
+
+  // What to do with an allocation in a steady state frame
+  enum class Check { Off, Report, Abort };
+
+  static constexpr std::size_t max_scopes = 32;
+
+  // Every thread, since the start of the process
+  static Counters get_total();
+
+  // Frames are delimited by the main thread
+  static void begin_frame();
+  static void end_frame();
+  static Counters get_last_frame();
+  static std::size_t get_frame_count();
+
+  // Frames after warmup_frames are expected not to allocate
+  static void set_check(Check check, std::size_t warmup_frames = 120);
+  // Steady state frames that allocated
+  static std::size_t get_failed_frames();
+
+  // Allocations of the main thread between begin_scope and end_scope,
+  // scopes do not nest. Names must be string literals
+  static void begin_scope(const char *name);
+  static void end_scope();
+  static const std::array<Scope, max_scopes> &get_scopes();
+
+  // Called by operator new and delete
+  static void on_allocation(std::size_t size);
+  static void on_free();
+};
+
+// Counts the allocations of the enclosing block under name
+class AllocationScope {
+public:
+  explicit AllocationScope(const char *name) {
+    AllocationTracker::begin_scope(name);
+  }
+  ~AllocationScope() { AllocationTracker::end_scope(); }
+
+  // Empêcher la copie
+  AllocationScope(const AllocationScope &) = delete;
+  AllocationScope &operator=(const AllocationScope &) = delete;
+};
@@ -0,0 +1,233 @@
+#include "profiler.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <string_view>
+#include "doctest/doctest.h"
+#include "render/recording_gl_backend.hpp"
+
+Profiler::Profiler() : m_origin(std::chrono::steady_clock::now()) {
+  m_events.reserve(trace_capacity);
+}
+
+Profiler::~Profiler() {
+  for (QuerySlot &slot : m_query_slots) {
+    for (GLuint query : slot.queries)
+      gl().delete_query(query);
+  }
+}
+
+double Profiler::now() const {
+  return std::chrono::duration<double, std::micro>(
+             std::chrono::steady_clock::now() - m_origin)
+      .count();
+}
+
+std::size_t Profiler::track_of(const char *name, Clock clock) {
+  for (std::size_t i = 0; i < m_tracks.size(); ++i) {
+    if (m_tracks[i].clock == clock &&
+        std::string_view(m_tracks[i].name) == name)
+      return i;
+  }
+  m_tracks.push_back({name, clock, {}});
+  return m_tracks.size() - 1;
+}
+
+void Profiler::add_time(std::size_t track, std::int64_t frame,
+                        double duration) {
+  if (frame < 0)
+    return; // Outside begin_frame / end_frame
+  m_tracks[track].history[frame % history_size] +=
+      static_cast<float>(duration / 1000.0);
+}
+
+void Profiler::add_event(const Event &event) {
+  if (m_events.size() < trace_capacity) {
+    m_events.push_back(event);
+  } else {
+    m_events[m_next_event] = event;
+  }
+  m_next_event = (m_next_event + 1) % trace_capacity;
+}
+
+void Profiler::resolve_queries(QuerySlot &slot) {
+  for (const PendingQuery &pending : slot.pending) {
+    if (!gl().get_query_object_ui64(pending.query,
+                                    GL_QUERY_RESULT_AVAILABLE)) {
+      ++m_dropped_queries;
+      continue;
+    }
+    double duration =
+        static_cast<double>(
+            gl().get_query_object_ui64(pending.query, GL_QUERY_RESULT)) /
+        1000.0;
+    add_time(pending.track, pending.frame, duration);
+    add_event(
+        {m_tracks[pending.track].name, Clock::Gpu, pending.start, duration});
+  }
+  slot.pending.clear();
+}
+
+void Profiler::begin_frame() {
+  ++m_frame;
+  for (Track &track : m_tracks)
+    track.history[m_frame % history_size] = 0.f;
+  resolve_queries(m_query_slots[m_frame % gpu_latency]);
+  begin_cpu("frame");
+}
+
+void Profiler::end_frame() {
+  end_cpu();
+  if (!m_cpu_scopes.empty()) {
+    std::cerr << "Profiler: " << m_cpu_scopes.size()
+              << " CPU scopes still open at the end of the frame" << std::endl;
+    m_cpu_scopes.clear();
+  }
+}
+
+void Profiler::begin_cpu(const char *name) {
+  m_cpu_scopes.push_back({track_of(name, Clock::Cpu), now()});
+}
+
+void Profiler::end_cpu() {
+  if (m_cpu_scopes.empty())
+    return;
+  OpenScope scope = m_cpu_scopes.back();
+  m_cpu_scopes.pop_back();
+
+  double duration = now() - scope.start;
+  add_time(scope.track, m_frame, duration);
+  add_event({m_tracks[scope.track].name, Clock::Cpu, scope.start, duration});
+}
+
+void Profiler::begin_gpu(const char *name) {
+  if (m_gpu_scope_open) {
+    std::cerr << "Profiler: GPU scope " << name << " nested in another one"
+              << std::endl;
+    return;
+  }
+  QuerySlot &slot = m_query_slots[m_frame % gpu_latency];
+  if (slot.pending.size() == slot.queries.size())
+    slot.queries.push_back(gl().gen_query());
+
+  GLuint query = slot.queries[slot.pending.size()];
+  slot.pending.push_back({query, track_of(name, Clock::Gpu), m_frame, now()});
+  gl().begin_query(GL_TIME_ELAPSED, query);
+  m_gpu_scope_open = true;
+}
+
+void Profiler::end_gpu() {
+  if (!m_gpu_scope_open)
+    return;
+  gl().end_query(GL_TIME_ELAPSED);
+  m_gpu_scope_open = false;
+}
+
+std::int64_t Profiler::get_last_frame(Clock clock) const {
+  // The CPU times of the frame in progress are not final either
+  return clock == Clock::Cpu ? m_frame - 1 : m_frame - gpu_latency;
+}
+
+void Profiler::get_history(const Track &track,
+                           std::vector<float> &values) const {
+  values.clear();
+  std::int64_t last = get_last_frame(track.clock);
+  std::int64_t first =
+      std::max<std::int64_t>(0, last - static_cast<std::int64_t>(window_size) +
+                                    1);
+  for (std::int64_t frame = first; frame <= last; ++frame)
+    values.push_back(track.history[frame % history_size]);
+}
+
+float Profiler::get_average(const Track &track) const {
+  std::vector<float> values;
+  get_history(track, values);
+  if (values.empty())
+    return 0.f;
+  float sum = 0.f;
+  for (float value : values)
+    sum += value;
+  return sum / static_cast<float>(values.size());
+}
+
+float Profiler::get_maximum(const Track &track) const {
+  std::vector<float> values;
+  get_history(track, values);
+  return values.empty() ? 0.f : *std::max_element(values.begin(), values.end());
+}
+
+bool Profiler::write_chrome_trace(const std::string &path) const {
+  nlohmann::json events = nlohmann::json::array();
+  // Oldest first once the ring has wrapped
+  std::size_t first = m_events.size() < trace_capacity ? 0 : m_next_event;
+  for (std::size_t i = 0; i < m_events.size(); ++i) {
+    const Event &event = m_events[(first + i) % m_events.size()];
+    bool gpu = event.clock == Clock::Gpu;
+    events.push_back({{"name", event.name},
+                      {"cat", gpu ? "gpu" : "cpu"},
+                      {"ph", "X"},
+                      {"ts", event.start},
+                      {"dur", event.duration},
+                      {"pid", 1},
+                      {"tid", gpu ? 2 : 1}});
+  }
+
+  std::ofstream file(path);
+  if (!file) {
+    std::cerr << "Could not write the trace " << path << std::endl;
+    return false;
+  }
+  file << nlohmann::json{{"traceEvents", events}, {"displayTimeUnit", "ms"}};
+  std::cout << "Trace of " << m_events.size() << " events written to "
+            << path << std::endl;
+  return true;
+}
+
+TEST_CASE("Profiler reads GPU timers late without waiting") {
+  RecordingGlBackend backend;
+  backend.query_result = 2'000'000; // 2 ms
+  ScopedGlBackend scoped_backend(backend);
+
+  Profiler profiler;
+  for (int frame = 0; frame < 10; ++frame) {
+    profiler.begin_frame();
+    {
+      ProfileScope simulation(profiler, "simulation");
+      GpuProfileScope pass(profiler, "opaque pass");
+    }
+    profiler.end_frame();
+  }
+  CHECK(backend.errors.empty());
+  CHECK(profiler.get_dropped_queries() == 0);
+  // One query per slot, reused
+  CHECK(backend.count("gen_query") == Profiler::gpu_latency);
+
+  const auto &tracks = profiler.get_tracks();
+  REQUIRE(tracks.size() == 3);
+  CHECK(std::string_view(tracks[1].name) == "simulation");
+  const Profiler::Track &gpu = tracks[2];
+  CHECK(gpu.clock == Profiler::Clock::Gpu);
+  std::vector<float> history;
+  profiler.get_history(gpu, history);
+  // Frames 0 to 6 are resolved by the start of frame 9
+  CHECK(history.size() == 7);
+  CHECK(profiler.get_average(gpu) == doctest::Approx(2.0));
+  CHECK(profiler.get_average(tracks[0]) >= profiler.get_average(tracks[1]));
+
+  // A result still pending is dropped, not waited for
+  backend.queries_available = false;
+  profiler.begin_frame();
+  profiler.end_frame();
+  CHECK(backend.errors.empty());
+  CHECK(profiler.get_dropped_queries() == 1);
+
+  const std::filesystem::path path =
+      std::filesystem::temp_directory_path() / "profiler_test.json";
+  REQUIRE(profiler.write_chrome_trace(path.string()));
+  nlohmann::json trace = nlohmann::json::parse(std::ifstream(path));
+  // 11 frames, 10 CPU simulation scopes and 7 GPU passes
+  CHECK(trace.at("traceEvents").size() == 11 + 10 + 7);
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "render/gl_backend.hpp"
+
+// Frame profiler: CPU scopes timed with steady_clock and GPU scopes timed
+// with GL_TIME_ELAPSED queries. A query is read gpu_latency frames after it
+// was issued, only if its result is available, so the CPU never waits on the
+// GPU. Every scope name gets a Track holding its time per frame, and the
+// last events can be written as a Chrome trace (chrome://tracing, Perfetto).
+class Profiler {
+public:
+  enum class Clock : std::uint8_t { Cpu, Gpu };
+
+  static constexpr std::size_t window_size = 120; // Frames averaged and plotted
+  static constexpr int gpu_latency = 3;           // Frames in flight
+  static constexpr std::size_t trace_capacity = 65536; // Events kept
+  // The window plus the frames whose GPU times are still in flight
+  static constexpr std::size_t history_size = window_size + gpu_latency + 1;
+
+  struct Track {
+    const char *name;
+    Clock clock;
+    // Milliseconds per frame, frame n at n % history_size
+    std::array<float, history_size> history{};
+  };
+
+  Profiler();
+  ~Profiler();
+
+  // Empêcher la copie
+  Profiler(const Profiler &) = delete;
+  Profiler &operator=(const Profiler &) = delete;
+
+  // The whole frame is the "frame" CPU track
+  void begin_frame();
+  void end_frame();
+
+  // Scopes nest, names must outlive the profiler (string literals)
+  void begin_cpu(const char *name);
+  void end_cpu();
+  // GL_TIME_ELAPSED queries cannot nest, one GPU scope at a time
+  void begin_gpu(const char *name);
+  void end_gpu();
+
+  const std::vector<Track> &get_tracks() const { return m_tracks; }
+  // Last frame whose times are final on this clock, -1 if none
+  std::int64_t get_last_frame(Clock clock) const;
+  // Times of the track over the window, oldest first
+  void get_history(const Track &track, std::vector<float> &values) const;
+  float get_average(const Track &track) const;
+  float get_maximum(const Track &track) const;
+  // GPU results not available in time, their frame misses the scope
+  std::size_t get_dropped_queries() const { return m_dropped_queries; }
+
+  // Chrome trace of the kept events. GPU events only have a duration, they
+  // start at the time their scope was issued on the CPU
+  bool write_chrome_trace(const std::string &path) const;
+
+private:
+  struct Event {
+    const char *name;
+    Clock clock;
+    double start; // Microseconds since the profiler creation
+    double duration;
+  };
+
+  struct OpenScope {
+    std::size_t track;
+    double start;
+  };
+
+  struct PendingQuery {
+    GLuint query;
+    std::size_t track;
+    std::int64_t frame;
+    double start;
+  };
+
+  // Queries of one frame in flight
+  struct QuerySlot {
+    std::vector<GLuint> queries; // Reused every gpu_latency frames
+    std::vector<PendingQuery> pending;
+  };
+
+  std::vector<Track> m_tracks;
+  std::int64_t m_frame = -1;
+  std::chrono::steady_clock::time_point m_origin;
+
+  std::vector<OpenScope> m_cpu_scopes;
+  bool m_gpu_scope_open = false;
+  std::array<QuerySlot, gpu_latency> m_query_slots;
+  std::size_t m_dropped_queries = 0;
+
+  std::vector<Event> m_events; // Ring of trace_capacity events
+  std::size_t m_next_event = 0;
+
+  double now() const;
+  std::size_t track_of(const char *name, Clock clock);
+  void add_time(std::size_t track, std::int64_t frame, double duration);
+  void add_event(const Event &event);
+  // Read the queries issued gpu_latency frames ago
+  void resolve_queries(QuerySlot &slot);
+};
+
+// Times the enclosing block on the CPU
+class ProfileScope {
+public:
+  ProfileScope(Profiler &profiler, const char *name) : m_profiler(profiler) {
+    m_profiler.begin_cpu(name);
+  }
+  ~ProfileScope() { m_profiler.end_cpu(); }
+
+  // Empêcher la copie
+  ProfileScope(const ProfileScope &) = delete;
+  ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+  Profiler &m_profiler;
+};
+
+// Times the GL commands issued in the enclosing block
+class GpuProfileScope {
+public:
+  GpuProfileScope(Profiler &profiler, const char *name)
+      : m_profiler(profiler) {
+    m_profiler.begin_gpu(name);
+  }
+  ~GpuProfileScope() { m_profiler.end_gpu(); }
+
+  // Empêcher la copie
+  GpuProfileScope(const GpuProfileScope &) = delete;
+  GpuProfileScope &operator=(const GpuProfileScope &) = delete;
+
+private:
+  Profiler &m_profiler;
+};
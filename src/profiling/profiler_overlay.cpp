@@ -0,0 +1,80 @@
+#include "profiler_overlay.hpp"
+#include <imgui.h>
+#include "allocation_tracker.hpp"
+
+void ProfilerOverlay::draw(const Profiler &profiler) {
+  if (!m_visible)
+    return;
+
+  ImGui::SetNextWindowPos(ImVec2(10.f, 10.f), ImGuiCond_FirstUseEver);
+  if (!ImGui::Begin("Profiler", &m_visible,
+                    ImGuiWindowFlags_AlwaysAutoResize |
+                        ImGuiWindowFlags_NoFocusOnAppearing)) {
+    ImGui::End();
+    return;
+  }
+
+  const std::vector<Profiler::Track> &tracks = profiler.get_tracks();
+  if (!tracks.empty()) {
+    // The first track is the whole frame
+    const Profiler::Track &frame = tracks.front();
+    float average = profiler.get_average(frame);
+    ImGui::Text("Frame %.2f ms (%.0f fps), worst %.2f ms", average,
+                average > 0.f ? 1000.f / average : 0.f,
+                profiler.get_maximum(frame));
+    profiler.get_history(frame, m_values);
+    ImGui::PlotLines("##frame", m_values.data(),
+                     static_cast<int>(m_values.size()), 0, nullptr, 0.f,
+                     33.3f, ImVec2(320.f, 60.f));
+    ImGui::Separator();
+  }
+
+  if (ImGui::BeginTable("tracks", 4)) {
+    ImGui::TableSetupColumn("Scope");
+    ImGui::TableSetupColumn("Clock");
+    ImGui::TableSetupColumn("Average (ms)");
+    ImGui::TableSetupColumn("Worst (ms)");
+    ImGui::TableHeadersRow();
+    for (std::size_t i = 1; i < tracks.size(); ++i) {
+      const Profiler::Track &track = tracks[i];
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::Text("%s", track.name);
+      ImGui::TableNextColumn();
+      ImGui::Text("%s", track.clock == Profiler::Clock::Gpu ? "GPU" : "CPU");
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", profiler.get_average(track));
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", profiler.get_maximum(track));
+    }
+    ImGui::EndTable();
+  }
+
+  if (profiler.get_dropped_queries() > 0)
+    ImGui::Text("%zu GPU timings dropped", profiler.get_dropped_queries());
+
+  // Heap allocations of the last frame, built with TRACK_ALLOCATIONS
+  if (AllocationTracker::enabled) {
+    ImGui::Separator();
+    AllocationTracker::Counters frame = AllocationTracker::get_last_frame();
+    ImGui::Text("Heap: %zu allocations, %zu bytes, %zu frees",
+                frame.allocations, frame.bytes, frame.frees);
+    for (const AllocationTracker::Scope &scope :
+         AllocationTracker::get_scopes()) {
+      if (scope.name == nullptr)
+        break;
+      ImGui::Text("  %s: %zu allocations, %zu bytes", scope.name,
+                  scope.last_frame.allocations, scope.last_frame.bytes);
+    }
+    if (AllocationTracker::get_failed_frames() > 0)
+      ImGui::Text("%zu steady state frames allocated",
+                  AllocationTracker::get_failed_frames());
+  }
+
+  if (ImGui::Button("Write trace"))
+    profiler.write_chrome_trace(m_trace_path);
+  ImGui::SameLine();
+  ImGui::Text("%s", m_trace_path.c_str());
+
+  ImGui::End();
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+#include "profiler.hpp"
+
+// ImGui window of the profiler: average and worst time of every track over
+// the window, the frame time history and a button writing a Chrome trace.
+// Drawn from ctx.update, p6 renders ImGui after it.
+class ProfilerOverlay {
+public:
+  explicit ProfilerOverlay(std::string trace_path = "trace.json")
+      : m_trace_path(std::move(trace_path)) {}
+
+  void toggle() { m_visible = !m_visible; }
+  void draw(const Profiler &profiler);
+
+private:
+  std::string m_trace_path;
+  bool m_visible = true;
+  std::vector<float> m_values; // History of the plotted track
+};
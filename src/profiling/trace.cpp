@@ -0,0 +1,228 @@
+#include "trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <thread>
+#include <vector>
+#include "doctest/doctest.h"
+
+namespace {
+
+struct Event {
+  const char *name;
+  std::int64_t timestamp; // Nanoseconds of the steady clock
+  char phase;             // 'B'egin or 'E'nd
+};
+
+// Written by its thread only, read by write_json
+struct ThreadRing {
+  std::size_t id = 0;
+  std::string name;
+  std::vector<Event> events = std::vector<Event>(Tracer::ring_capacity);
+  std::atomic<std::uint64_t> head{0}; // Events written since its creation
+  std::uint64_t capture_start = 0;    // head when the capture started
+  std::atomic<bool> writing{false};   // An event is being recorded, see stop()
+};
+
+// Rings of every thread that recorded, kept after the thread exits
+std::mutex rings_mutex;
+std::vector<std::unique_ptr<ThreadRing>> rings;
+
+std::int64_t capture_origin = 0;
+int frames_left = 0;
+std::string capture_path;
+
+std::int64_t now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+ThreadRing &local_ring() {
+  thread_local ThreadRing *ring = nullptr;
+  if (ring == nullptr) {
+    std::lock_guard lock(rings_mutex);
+    rings.push_back(std::make_unique<ThreadRing>());
+    ring = rings.back().get();
+    ring->id = rings.size();
+  }
+  return *ring;
+}
+
+} // namespace
+
+void Tracer::record(const char *name, char phase) {
+  ThreadRing &ring = local_ring();
+  // Sequentially consistent with stop(): either it sees the flag and waits,
+  // or this sees the capture stopped and records nothing
+  ring.writing.store(true);
+  if (s_enabled.load()) {
+    std::uint64_t head = ring.head.load(std::memory_order_relaxed);
+    ring.events[head % ring_capacity] = {name, now(), phase};
+    ring.head.store(head + 1, std::memory_order_release);
+  }
+  ring.writing.store(false, std::memory_order_release);
+}
+
+void Tracer::begin(const char *name) { record(name, 'B'); }
+
+void Tracer::end(const char *name) { record(name, 'E'); }
+
+void Tracer::set_thread_name(const char *name) {
+  ThreadRing &ring = local_ring();
+  std::lock_guard lock(rings_mutex);
+  ring.name = name;
+}
+
+void Tracer::start() {
+  {
+    std::lock_guard lock(rings_mutex);
+    for (const auto &ring : rings)
+      ring->capture_start = ring->head.load(std::memory_order_acquire);
+    capture_origin = now();
+  }
+  s_enabled.store(true, std::memory_order_relaxed);
+}
+
+void Tracer::stop() {
+  s_enabled.store(false);
+  // A scope ending on another thread may be writing its last event
+  std::lock_guard lock(rings_mutex);
+  for (const auto &ring : rings) {
+    while (ring->writing.load())
+      std::this_thread::yield();
+  }
+}
+
+void Tracer::capture_frames(int frame_count, const std::string &path) {
+  frames_left = frame_count;
+  capture_path = path;
+  std::cout << "Tracing " << frame_count << " frames" << std::endl;
+  start();
+}
+
+void Tracer::end_frame() {
+  if (frames_left > 0 && --frames_left == 0) {
+    stop();
+    write_json(capture_path);
+  }
+}
+
+bool Tracer::write_json(const std::string &path) {
+  nlohmann::json events = nlohmann::json::array();
+  {
+    std::lock_guard lock(rings_mutex);
+    for (const auto &ring : rings) {
+      std::uint64_t head = ring->head.load(std::memory_order_acquire);
+      std::uint64_t first =
+          std::max(ring->capture_start,
+                   head > ring_capacity ? head - ring_capacity : 0);
+      if (first == head)
+        continue;
+
+      events.push_back({{"name", "thread_name"},
+                        {"ph", "M"},
+                        {"pid", 1},
+                        {"tid", ring->id},
+                        {"args",
+                         {{"name", ring->name.empty()
+                                       ? "thread " + std::to_string(ring->id)
+                                       : ring->name}}}});
+      for (std::uint64_t i = first; i < head; ++i) {
+        const Event &event = ring->events[i % ring_capacity];
+        events.push_back(
+            {{"name", event.name},
+             {"ph", std::string(1, event.phase)},
+             {"ts", static_cast<double>(event.timestamp - capture_origin) /
+                        1000.0},
+             {"pid", 1},
+             {"tid", ring->id}});
+      }
+    }
+  }
+
+  std::ofstream file(path);
+  if (!file) {
+    std::cerr << "Could not write the trace " << path << std::endl;
+    return false;
+  }
+  file << nlohmann::json{{"traceEvents", events}, {"displayTimeUnit", "ms"}};
+  std::cout << "Trace written to " << path << std::endl;
+  return true;
+}
+
+TEST_CASE("Tracer records each thread while capturing only") {
+  const std::filesystem::path path =
+      std::filesystem::temp_directory_path() / "tracer_test.json";
+
+  { TraceScope ignored("before the capture"); }
+
+  Tracer::capture_frames(2, path.string());
+  std::thread worker([]() {
+    Tracer::set_thread_name("worker");
+    for (int i = 0; i < 100; ++i) {
+      TraceScope scope("work");
+    }
+  });
+  worker.join();
+  for (int frame = 0; frame < 3; ++frame) {
+    TraceScope scope("frame");
+    Tracer::end_frame(); // The capture stops at the second one
+  }
+  CHECK_FALSE(Tracer::is_enabled());
+
+  nlohmann::json trace = nlohmann::json::parse(std::ifstream(path));
+  int work = 0;
+  int frames = 0;
+  bool named = false;
+  for (const auto &event : trace.at("traceEvents")) {
+    std::string name = event.at("name");
+    CHECK(name != "before the capture");
+    work += name == "work";
+    frames += name == "frame";
+    named |= name == "thread_name" && event.at("args").at("name") == "worker";
+  }
+  CHECK(work == 200); // Begin and end
+  // Frame 0 both ends, frame 1 begins before the capture stops
+  CHECK(frames == 3);
+  CHECK(named);
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("Tracer stops with scopes still ending on other threads") {
+  const std::filesystem::path path =
+      std::filesystem::temp_directory_path() / "tracer_stop_test.json";
+
+  std::atomic<bool> running{true};
+  std::atomic<int> scopes{0};
+  Tracer::start();
+  std::thread worker([&]() {
+    while (running.load()) {
+      TraceScope scope("busy");
+      scopes.fetch_add(1);
+    }
+  });
+  while (scopes.load() < 1000)
+    std::this_thread::yield();
+
+  // The worker keeps opening and closing scopes, nothing lands after stop()
+  Tracer::stop();
+  REQUIRE(Tracer::write_json(path.string()));
+  nlohmann::json first = nlohmann::json::parse(std::ifstream(path));
+  while (scopes.load() < 2000)
+    std::this_thread::yield();
+  REQUIRE(Tracer::write_json(path.string()));
+  nlohmann::json second = nlohmann::json::parse(std::ifstream(path));
+  running.store(false);
+  worker.join();
+
+  CHECK(first == second);
+  CHECK(first.at("traceEvents").size() > 1000);
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+// Timeline of begin/end events for offline analysis, written as a Chrome
+// trace loadable in chrome://tracing or Perfetto. Every thread records into
+// its own ring buffer without locking, the rings are only read by
+// write_json once stop() has waited for the writers in progress. Outside a
+// capture a TraceScope costs one relaxed atomic load and a branch.
+class Tracer {
+public:
+  // Events kept per thread, the oldest are overwritten
+  static constexpr std::size_t ring_capacity = 65536;
+
+  static bool is_enabled() {
+    return s_enabled.load(std::memory_order_relaxed);
+  }
+
+  // Names must outlive the capture (string literals)
+  static void begin(const char *name);
+  static void end(const char *name);
+  // Shown instead of the thread number, for the calling thread
+  static void set_thread_name(const char *name);
+
+  // Events recorded before start() or after stop() are left out of the
+  // trace. stop() returns once no thread is writing to its ring
+  static void start();
+  static void stop();
+  // Record the next frame_count frames then write them to path
+  static void capture_frames(int frame_count,
+                             const std::string &path = "trace.json");
+  // Called once per frame by the main loop, ends capture_frames
+  static void end_frame();
+
+  // Call once stopped, the rings are read while no thread writes them
+  static bool write_json(const std::string &path);
+
+private:
+  static inline std::atomic<bool> s_enabled{false};
+
+  static void record(const char *name, char phase);
+};
+
+// Records the enclosing block while a capture runs
+class TraceScope {
+public:
+  explicit TraceScope(const char *name)
+      : m_name(Tracer::is_enabled() ? name : nullptr) {
+    if (m_name)
+      Tracer::begin(m_name);
+  }
+  ~TraceScope() {
+    // Dropped by the tracer if the capture stopped meanwhile
+    if (m_name)
+      Tracer::end(m_name);
+  }
+
+  // Empêcher la copie
+  TraceScope(const TraceScope &) = delete;
+  TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+  const char *m_name;
+};
@@ -1,6 +1,8 @@
 #include "3D_model.hpp"
 #include "3D_loader/model_loader.hpp"
+#include <algorithm>
 #include <iostream>
+#include <utility>
 
 Model::Model(const std::string &model_path) {
   // Load model from file path
@@ -8,31 +10,63 @@ Model::Model(const std::string &model_path) {
 
   ModelLoader::Model model = ModelLoader::load_model(model_path);
 
+  // Every level goes in the same buffer, one after the other
+  float radius = std::max(model.bounding_sphere.radius, 1e-6f);
+  m_lods.push_back({0, static_cast<GLsizei>(model.combined_data.size() / 8),
+                    0.f});
+  for (ModelLoader::LodLevel &level : model.lods) {
+    m_lods.push_back({m_lods.back().first + m_lods.back().count,
+                      static_cast<GLsizei>(level.combined_data.size() / 8),
+                      level.error / radius});
+    model.combined_data.insert(model.combined_data.end(),
+                               level.combined_data.begin(),
+                               level.combined_data.end());
+  }
+
   m_vbo_vertices.bind();
   m_vbo_vertices.fill(model.combined_data.data(),
                       model.combined_data.size() * sizeof(float),
                       GL_STATIC_DRAW);
+  m_vbo_vertices.unbind();
+
+  specify_attributes(m_vao);
+
+  m_bounding_box = model.bounding_box;
+  m_bounding_sphere = model.bounding_sphere;
+  m_vertex_data = std::move(model.combined_data);
+}
 
-  m_vao.bind();
+void Model::specify_attributes(VAO &vao) const {
+  m_vbo_vertices.bind();
   constexpr int stride = 8 * sizeof(float);
 
-  m_vao.specify_attribute(0, 3, GL_FLOAT, GL_FALSE, stride,
-                          (void *)0); // Position attribute
-  m_vao.specify_attribute(1, 3, GL_FLOAT, GL_FALSE, stride,
-                          (void *)(3 * sizeof(float))); // Normal attribute
-  m_vao.specify_attribute(
+  vao.specify_attribute(0, 3, GL_FLOAT, GL_FALSE, stride,
+                        (void *)0); // Position attribute
+  vao.specify_attribute(1, 3, GL_FLOAT, GL_FALSE, stride,
+                        (void *)(3 * sizeof(float))); // Normal attribute
+  vao.specify_attribute(
       2, 2, GL_FLOAT, GL_FALSE, stride,
       (void *)(6 * sizeof(float))); // Texture coordinate attribute
-  m_vao.unbind();
 
   m_vbo_vertices.unbind();
-
-  // Store the data size for use in glDrawArrays
-  m_data_size = static_cast<int>(model.combined_data.size() / 8);
 }
 
-void Model::draw() const {
-  m_vao.bind();
-  glDrawArrays(GL_TRIANGLES, 0, m_data_size);
-  m_vao.unbind();
+int Model::select_lod(float screen_size, int current_lod) const {
+  int target = 0;
+  for (int lod = get_lod_count() - 1; lod > 0; --lod) {
+    if (m_lods[lod].error * screen_size <= lod_tolerance) {
+      target = lod;
+      break;
+    }
+  }
+  if (target <= current_lod)
+    return target; // Too coarse for the current size, refine right away
+
+  // Only coarsen to levels that are well under the tolerance
+  for (int lod = target; lod > current_lod; --lod) {
+    if (m_lods[lod].error * screen_size <=
+        lod_tolerance * (1.f - lod_hysteresis))
+      return lod;
+  }
+  return current_lod;
 }
\ No newline at end of file
@@ -1,9 +1,11 @@
 #pragma once
 
+#include "maths/bounds.hpp"
 #include "vao.hpp"
 #include "vbo.hpp"
 #include <glm/glm.hpp>
 #include <string>
+#include <vector>
 
 class Model {
 public:
@@ -19,11 +21,47 @@ public:
 
   ~Model() = default;
 
+  // Range of one level of detail in the vertex buffer, level 0 is the
+  // original mesh
+  struct Lod {
+    GLint first;
+    GLsizei count;
+    float error; // Simplification error relative to the bounding radius
+  };
+
+  // Largest error allowed on screen, in half viewport heights (~1 pixel)
+  static constexpr float lod_tolerance = 0.003f;
+  // Going coarser needs the error to drop this much under the tolerance
+  static constexpr float lod_hysteresis = 0.25f;
+
   const VAO &get_VAO() const { return m_vao; }
-  void draw() const;
+  const VBO &get_vertex_buffer() const { return m_vbo_vertices; }
+  // Point position, normal and uv (locations 0 to 2) of vao at the vertex
+  // buffer, for vertex arrays adding their own attributes to the mesh
+  void specify_attributes(VAO &vao) const;
+
+  int get_lod_count() const { return static_cast<int>(m_lods.size()); }
+  const Lod &get_lod(int lod) const { return m_lods[lod]; }
+
+  // Coarsest level whose error stays under the tolerance for a bounding
+  // sphere covering screen_size half viewport heights
+  int select_lod(float screen_size, int current_lod) const;
+
+  // Interleaved position, normal, uv (8 floats per vertex) of every level,
+  // kept on the CPU so the mesh can be merged into static batches
+  const std::vector<float> &get_vertex_data() const { return m_vertex_data; }
+
+  // Model-space bounds, computed by the loader
+  const BoundingBox &get_bounding_box() const { return m_bounding_box; }
+  const BoundingSphere &get_bounding_sphere() const {
+    return m_bounding_sphere;
+  }
 
 private:
-  int m_data_size;
+  std::vector<Lod> m_lods;
+  BoundingBox m_bounding_box;
+  BoundingSphere m_bounding_sphere;
+  std::vector<float> m_vertex_data;
   VAO m_vao;
   VBO m_vbo_vertices;
 };
\ No newline at end of file
@@ -0,0 +1,240 @@
+#include "frame_capture.hpp"
+#include <algorithm>
+#include <bit>
+#include <iostream>
+#include <utility>
+#include "doctest/doctest.h"
+#include "p6/p6.h"
+#include "recording_gl_backend.hpp"
+
+namespace {
+
+// Pixels are read as RGBA: the usual fast path, and rows need no padding
+constexpr std::size_t read_pixel_size = 4;
+
+// Long enough for a slow software renderer, the map would wait anyway
+constexpr GLuint64 fence_timeout = 10'000'000'000; // 10 s in ns
+
+GLuint make_renderbuffer(GLenum internal_format, GLsizei width,
+                         GLsizei height) {
+  GLuint renderbuffer = gl().gen_renderbuffer();
+  gl().bind_renderbuffer(renderbuffer);
+  gl().renderbuffer_storage(internal_format, width, height);
+  gl().bind_renderbuffer(0);
+  return renderbuffer;
+}
+
+} // namespace
+
+FrameCapture::FrameCapture(GLsizei width, GLsizei height, int supersampling,
+                           Writer writer)
+    : m_width(std::max<GLsizei>(width, 1)),
+      m_height(std::max<GLsizei>(height, 1)), m_writer(std::move(writer)) {
+  GLint max_size = gl().get_integer(GL_MAX_RENDERBUFFER_SIZE);
+  if (std::max(m_width, m_height) > max_size)
+    std::cerr << "Capture size " << m_width << "x" << m_height
+              << " above GL_MAX_RENDERBUFFER_SIZE (" << max_size << ")"
+              << std::endl;
+  const int requested = static_cast<int>(
+      std::bit_floor(static_cast<unsigned>(std::max(supersampling, 1))));
+  m_supersampling = requested;
+  while (m_supersampling > 1 &&
+         std::max(m_width, m_height) * m_supersampling > max_size)
+    m_supersampling /= 2;
+  if (m_supersampling < requested)
+    std::cerr << "Supersampling lowered to " << m_supersampling << "x"
+              << std::endl;
+
+  // Halving chain, from the supersampled size down to the output size
+  for (int scale = m_supersampling; scale >= 1; scale /= 2) {
+    Level level;
+    level.width = m_width * scale;
+    level.height = m_height * scale;
+    level.framebuffer = gl().gen_framebuffer();
+    level.color = make_renderbuffer(GL_RGBA8, level.width, level.height);
+    gl().bind_framebuffer(GL_FRAMEBUFFER, level.framebuffer);
+    gl().framebuffer_renderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                  level.color);
+    if (m_levels.empty()) {
+      level.depth =
+          make_renderbuffer(GL_DEPTH_COMPONENT24, level.width, level.height);
+      gl().framebuffer_renderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                                    level.depth);
+    }
+    if (gl().check_framebuffer_status(GL_FRAMEBUFFER) !=
+        GL_FRAMEBUFFER_COMPLETE)
+      std::cerr << "Incomplete capture framebuffer " << level.width << "x"
+                << level.height << std::endl;
+    m_levels.push_back(level);
+  }
+  gl().bind_framebuffer(GL_FRAMEBUFFER, 0);
+
+  auto size = static_cast<GLsizeiptr>(static_cast<std::size_t>(m_width) *
+                                      m_height * read_pixel_size);
+  for (GLuint &pixel_buffer : m_pixel_buffers) {
+    pixel_buffer = gl().gen_buffer();
+    gl().bind_buffer(GL_PIXEL_PACK_BUFFER, pixel_buffer);
+    gl().buffer_data(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+  }
+  gl().bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+  m_rgb.resize(static_cast<std::size_t>(m_width) * m_height * 3);
+}
+
+FrameCapture::~FrameCapture() {
+  for (GLsync fence : m_fences) {
+    if (fence != nullptr)
+      gl().delete_sync(fence);
+  }
+  for (GLuint pixel_buffer : m_pixel_buffers)
+    gl().delete_buffer(pixel_buffer);
+  for (const Level &level : m_levels) {
+    gl().delete_framebuffer(level.framebuffer);
+    gl().delete_renderbuffer(level.color);
+    if (level.depth != 0)
+      gl().delete_renderbuffer(level.depth);
+  }
+}
+
+void FrameCapture::begin_frame() {
+  const Level &target = m_levels.front();
+  gl().bind_framebuffer(GL_FRAMEBUFFER, target.framebuffer);
+  gl().viewport(0, 0, target.width, target.height);
+}
+
+void FrameCapture::end_frame() {
+  for (std::size_t i = 1; i < m_levels.size(); ++i) {
+    const Level &source = m_levels[i - 1];
+    const Level &target = m_levels[i];
+    gl().bind_framebuffer(GL_READ_FRAMEBUFFER, source.framebuffer);
+    gl().bind_framebuffer(GL_DRAW_FRAMEBUFFER, target.framebuffer);
+    gl().blit_framebuffer(0, 0, source.width, source.height, 0, 0,
+                          target.width, target.height, GL_COLOR_BUFFER_BIT,
+                          GL_LINEAR);
+  }
+
+  // Asynchronous read into the pixel buffer of the frame
+  std::size_t slot = m_frame_count % readback_count;
+  gl().bind_framebuffer(GL_READ_FRAMEBUFFER, m_levels.back().framebuffer);
+  gl().bind_buffer(GL_PIXEL_PACK_BUFFER, m_pixel_buffers[slot]);
+  gl().read_pixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE,
+                   nullptr);
+  gl().bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+  m_fences[slot] = gl().fence_sync();
+  ++m_frame_count;
+
+  // The next frame reuses the oldest buffer
+  if (m_frame_count - m_written_count == readback_count)
+    write_oldest();
+  gl().bind_framebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void FrameCapture::flush() {
+  while (m_written_count < m_frame_count)
+    write_oldest();
+}
+
+void FrameCapture::write_oldest() {
+  std::size_t slot = m_written_count % readback_count;
+  if (gl().client_wait_sync(m_fences[slot], fence_timeout) ==
+      GL_TIMEOUT_EXPIRED)
+    std::cerr << "Capture readback of frame " << m_written_count
+              << " still pending" << std::endl;
+  gl().delete_sync(m_fences[slot]);
+  m_fences[slot] = nullptr;
+
+  auto size = static_cast<std::size_t>(m_width) * m_height * read_pixel_size;
+  gl().bind_buffer(GL_PIXEL_PACK_BUFFER, m_pixel_buffers[slot]);
+  const auto *rgba = static_cast<const std::uint8_t *>(
+      gl().map_buffer_range(GL_PIXEL_PACK_BUFFER, 0,
+                            static_cast<GLsizeiptr>(size), GL_MAP_READ_BIT));
+  if (rgba == nullptr) {
+    std::cerr << "Error mapping the capture of frame " << m_written_count
+              << std::endl;
+    m_failed = true;
+  } else {
+    // GL rows start at the bottom
+    std::size_t width = static_cast<std::size_t>(m_width);
+    for (std::size_t y = 0; y < static_cast<std::size_t>(m_height); ++y) {
+      const std::uint8_t *source =
+          rgba + (m_height - 1 - y) * width * read_pixel_size;
+      std::uint8_t *target = m_rgb.data() + y * width * 3;
+      for (std::size_t x = 0; x < width; ++x) {
+        target[3 * x] = source[4 * x];
+        target[3 * x + 1] = source[4 * x + 1];
+        target[3 * x + 2] = source[4 * x + 2];
+      }
+    }
+    gl().unmap_buffer(GL_PIXEL_PACK_BUFFER);
+    if (!m_writer(m_written_count, m_width, m_height, m_rgb))
+      m_failed = true;
+  }
+  gl().bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+  ++m_written_count;
+}
+
+FrameCapture::Writer
+FrameCapture::png_writer(const std::filesystem::path &directory) {
+  std::filesystem::create_directories(directory);
+  return [directory](std::size_t frame, GLsizei width, GLsizei height,
+                     std::span<const std::uint8_t> rgb) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "frame_%05zu.png", frame);
+    img::save_png(directory / name, static_cast<std::size_t>(width),
+                  static_cast<std::size_t>(height), rgb.data(), 3, false);
+    return true;
+  };
+}
+
+FrameCapture::Writer FrameCapture::raw_writer(std::FILE *file) {
+  return [file](std::size_t, GLsizei, GLsizei,
+                std::span<const std::uint8_t> rgb) {
+    if (std::fwrite(rgb.data(), 1, rgb.size(), file) != rgb.size()) {
+      std::cerr << "Error writing a raw frame" << std::endl;
+      return false;
+    }
+    return true;
+  };
+}
+
+TEST_CASE("Frame capture downsamples and delivers frames in order") {
+  RecordingGlBackend backend;
+  backend.pixel_value = 200;
+  ScopedGlBackend scoped_backend(backend);
+
+  std::vector<std::size_t> frames;
+  bool all_pixels_read = true;
+  {
+    FrameCapture capture(
+        64, 32, 5,
+        [&](std::size_t frame, GLsizei width, GLsizei height,
+            std::span<const std::uint8_t> rgb) {
+          frames.push_back(frame);
+          all_pixels_read &= rgb.size() == std::size_t(width * height * 3) &&
+                             std::all_of(rgb.begin(), rgb.end(),
+                                         [](auto v) { return v == 200; });
+          return true;
+        });
+    CHECK(capture.get_supersampling() == 4);
+
+    for (int frame = 0; frame < 4; ++frame) {
+      capture.begin_frame();
+      capture.end_frame();
+    }
+    // 256x128 -> 128x64 -> 64x32
+    CHECK(backend.count("blit_framebuffer") == 8);
+    CHECK(backend.filter("viewport").back().arguments[2] == 256);
+    // Two frames still in flight
+    CHECK(frames.size() == 2);
+    capture.flush();
+    CHECK(capture.get_written_count() == 4);
+    CHECK_FALSE(capture.has_failed());
+  }
+  CHECK(frames == std::vector<std::size_t>{0, 1, 2, 3});
+  CHECK(all_pixels_read);
+  CHECK(backend.errors.empty());
+
+  // The supersampled size has to fit in a renderbuffer
+  FrameCapture wide(5000, 10, 4, FrameCapture::raw_writer(nullptr));
+  CHECK(wide.get_supersampling() == 1);
+  CHECK(backend.errors.empty());
+}
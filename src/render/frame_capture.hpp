@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <span>
+#include <vector>
+#include "gl_backend.hpp"
+
+// Offline rendering of frames to images, independent of the window size.
+// The frame is drawn into an offscreen framebuffer supersampling times
+// larger in each direction, then halved by linear blits (a 2x2 box filter
+// each) down to the output size. Pixels are read into a ring of pixel pack
+// buffers and fenced: a frame reaches the writer readback_count - 1 frames
+// later, when the GPU is long done with it, so the readback never stalls
+// the rendering.
+class FrameCapture {
+public:
+  static constexpr int readback_count = 3;
+
+  // Receives the frames in order, rows from the top, 3 bytes (RGB) per
+  // pixel. Returning false marks the capture as failed
+  using Writer = std::function<bool(std::size_t frame, GLsizei width,
+                                    GLsizei height,
+                                    std::span<const std::uint8_t> rgb)>;
+
+  // supersampling is rounded down to a power of two and lowered until the
+  // offscreen framebuffer fits in GL_MAX_RENDERBUFFER_SIZE
+  FrameCapture(GLsizei width, GLsizei height, int supersampling,
+               Writer writer);
+  ~FrameCapture();
+
+  // Empêcher la copie
+  FrameCapture(const FrameCapture &) = delete;
+  FrameCapture &operator=(const FrameCapture &) = delete;
+
+  // Bind the offscreen framebuffer and its viewport
+  void begin_frame();
+  // Downsample, start the readback and write the oldest frame in flight.
+  // The default framebuffer is bound again
+  void end_frame();
+  // Write the frames still in flight, at the end of the capture
+  void flush();
+
+  GLsizei get_width() const { return m_width; }
+  GLsizei get_height() const { return m_height; }
+  int get_supersampling() const { return m_supersampling; }
+  std::size_t get_frame_count() const { return m_frame_count; }
+  std::size_t get_written_count() const { return m_written_count; }
+  bool has_failed() const { return m_failed; }
+
+  // frame_00000.png, frame_00001.png... in directory (created if needed)
+  static Writer png_writer(const std::filesystem::path &directory);
+  // Raw rgb24 frames one after the other, for a pipe into ffmpeg:
+  // ffmpeg -f rawvideo -pix_fmt rgb24 -s WxH -r 60 -i - out.mp4
+  static Writer raw_writer(std::FILE *file);
+
+private:
+  // One step of the downsampling chain, the first one has a depth buffer
+  struct Level {
+    GLuint framebuffer = 0;
+    GLuint color = 0;
+    GLuint depth = 0;
+    GLsizei width = 0;
+    GLsizei height = 0;
+  };
+
+  GLsizei m_width;
+  GLsizei m_height;
+  int m_supersampling = 1;
+  Writer m_writer;
+
+  std::vector<Level> m_levels;
+  std::array<GLuint, readback_count> m_pixel_buffers{};
+  std::array<GLsync, readback_count> m_fences{};
+  std::size_t m_frame_count = 0;   // Frames ended
+  std::size_t m_written_count = 0; // Frames given to the writer
+  std::vector<std::uint8_t> m_rgb; // Reused for every frame
+  bool m_failed = false;
+
+  // Map the pixels of the oldest frame in flight and pass them on
+  void write_oldest();
+};
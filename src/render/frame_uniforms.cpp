@@ -0,0 +1,102 @@
+#include "frame_uniforms.hpp"
+#include <algorithm>
+
+FrameUniforms::FrameUniforms()
+    : m_frame_data(GL_UNIFORM_BUFFER, sizeof(FrameData),
+                   static_cast<std::size_t>(
+                       gl().get_integer(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT))) {
+  // Two RGBA32F texels per light: position then intensity
+  create(m_lights, GL_RGBA32F, 64 * sizeof(LightData));
+  // One (offset, count) pair per cluster
+  create(m_clusters, GL_RG32UI, 16 * 9 * 24 * sizeof(glm::uvec2));
+  create(m_light_indices, GL_R32UI, 1024 * sizeof(std::uint32_t));
+}
+
+FrameUniforms::~FrameUniforms() {
+  destroy(m_light_indices);
+  destroy(m_clusters);
+  destroy(m_lights);
+}
+
+void FrameUniforms::create(TextureBuffer &texture_buffer, GLenum format,
+                           std::size_t capacity) {
+  texture_buffer.capacity = capacity;
+  texture_buffer.buffer = gl().gen_buffer();
+  gl().bind_buffer(GL_TEXTURE_BUFFER, texture_buffer.buffer);
+  gl().buffer_data(GL_TEXTURE_BUFFER, capacity, nullptr, GL_DYNAMIC_DRAW);
+  gl().bind_buffer(GL_TEXTURE_BUFFER, 0);
+
+  texture_buffer.texture = gl().gen_texture();
+  gl().bind_texture(GL_TEXTURE_BUFFER, texture_buffer.texture);
+  gl().tex_buffer(GL_TEXTURE_BUFFER, format, texture_buffer.buffer);
+  gl().bind_texture(GL_TEXTURE_BUFFER, 0);
+}
+
+void FrameUniforms::destroy(TextureBuffer &texture_buffer) {
+  gl().delete_texture(texture_buffer.texture);
+  gl().delete_buffer(texture_buffer.buffer);
+}
+
+void FrameUniforms::upload(TextureBuffer &texture_buffer, const void *data,
+                           std::size_t size) {
+  gl().bind_buffer(GL_TEXTURE_BUFFER, texture_buffer.buffer);
+  if (size > texture_buffer.capacity) {
+    texture_buffer.capacity = std::max(size, 2 * texture_buffer.capacity);
+    gl().buffer_data(GL_TEXTURE_BUFFER, texture_buffer.capacity, nullptr,
+                     GL_DYNAMIC_DRAW);
+  }
+  if (size > 0) {
+    gl().buffer_sub_data(GL_TEXTURE_BUFFER, 0, size, data);
+  }
+  gl().bind_buffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void FrameUniforms::attach(Program &program) const {
+  program.bind_uniform_block("FrameData", block_binding);
+  program.use();
+  program.set_uniform("u_light_buffer", static_cast<int>(light_texture_unit));
+  program.set_uniform("u_cluster_buffer",
+                      static_cast<int>(cluster_texture_unit));
+  program.set_uniform("u_light_index_buffer",
+                      static_cast<int>(light_index_texture_unit));
+}
+
+void FrameUniforms::update(const glm::mat4 &view_matrix,
+                           const glm::mat4 &proj_matrix,
+                           const std::vector<LightData> &lights,
+                           const LightGrid *light_grid,
+                           const glm::vec2 &viewport_size) {
+  FrameData data{view_matrix, proj_matrix, proj_matrix * view_matrix,
+                 glm::ivec4(static_cast<int>(lights.size()), 0, 0, 0),
+                 glm::ivec4(0), glm::vec4(0.f)};
+
+  upload(m_lights, lights.data(), lights.size() * sizeof(LightData));
+
+  if (light_grid) {
+    data.light_count.y = light_grid->get_directional_count();
+    data.light_count.z = 1;
+    data.cluster_grid = glm::ivec4(light_grid->get_dimensions(), 0);
+    data.cluster_depth =
+        glm::vec4(light_grid->get_near(), light_grid->get_slice_scale(),
+                  viewport_size.x, viewport_size.y);
+
+    const auto &clusters = light_grid->get_clusters();
+    const auto &indices = light_grid->get_light_indices();
+    upload(m_clusters, clusters.data(), clusters.size() * sizeof(glm::uvec2));
+    upload(m_light_indices, indices.data(),
+           indices.size() * sizeof(std::uint32_t));
+  }
+
+  std::size_t offset = m_frame_data.write(&data, sizeof(FrameData));
+  gl().bind_buffer_range(GL_UNIFORM_BUFFER, block_binding,
+                         m_frame_data.get_id(),
+                         static_cast<GLintptr>(offset), sizeof(FrameData));
+
+  gl().active_texture(GL_TEXTURE0 + light_texture_unit);
+  gl().bind_texture(GL_TEXTURE_BUFFER, m_lights.texture);
+  gl().active_texture(GL_TEXTURE0 + cluster_texture_unit);
+  gl().bind_texture(GL_TEXTURE_BUFFER, m_clusters.texture);
+  gl().active_texture(GL_TEXTURE0 + light_index_texture_unit);
+  gl().bind_texture(GL_TEXTURE_BUFFER, m_light_indices.texture);
+  gl().active_texture(GL_TEXTURE0);
+}
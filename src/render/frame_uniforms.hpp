@@ -0,0 +1,71 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include "light.hpp"
+#include "light_grid.hpp"
+#include "p6/p6.h"
+#include "program.hpp"
+#include "stream_buffer.hpp"
+
+// Per-frame shader constants, written once per frame and shared by every
+// program: the view/projection matrices live in a std140 uniform block
+// (FrameData), streamed through a ring of fenced segments, and the lights in
+// a buffer texture, which has no length limit unlike a std140 array. When a
+// LightGrid is given, its cluster records and light index list are uploaded
+// as two more buffer textures.
+class FrameUniforms {
+public:
+  static constexpr GLuint block_binding = 0;
+  static constexpr GLuint light_texture_unit = 2;
+  static constexpr GLuint cluster_texture_unit = 3;
+  static constexpr GLuint light_index_texture_unit = 4;
+
+  FrameUniforms();
+  ~FrameUniforms();
+
+  // Empêcher la copie
+  FrameUniforms(const FrameUniforms &) = delete;
+  FrameUniforms &operator=(const FrameUniforms &) = delete;
+
+  // Connect the FrameData block and the light samplers of a program
+  void attach(Program &program) const;
+
+  // Without a grid the shaders loop over every light
+  void update(const glm::mat4 &view_matrix, const glm::mat4 &proj_matrix,
+              const std::vector<LightData> &lights,
+              const LightGrid *light_grid = nullptr,
+              const glm::vec2 &viewport_size = glm::vec2(0.f));
+  // Once the frame's draws are issued
+  void end_frame() { m_frame_data.end_frame(); }
+
+private:
+  // std140 mirror of the FrameData block
+  struct FrameData {
+    glm::mat4 view_matrix;
+    glm::mat4 proj_matrix;
+    glm::mat4 view_proj_matrix;
+    glm::ivec4 light_count;   // x: lights, y: directional, z: clustered
+    glm::ivec4 cluster_grid;  // xyz: tiles and slices
+    glm::vec4 cluster_depth;  // x: near, y: slice scale, zw: viewport size
+  };
+
+  // Buffer object exposed to the shaders as a samplerBuffer
+  struct TextureBuffer {
+    GLuint buffer = 0;
+    GLuint texture = 0;
+    std::size_t capacity = 0; // In bytes
+  };
+
+  StreamBuffer m_frame_data;
+  TextureBuffer m_lights;
+  TextureBuffer m_clusters;
+  TextureBuffer m_light_indices;
+
+  static void create(TextureBuffer &texture_buffer, GLenum format,
+                     std::size_t capacity);
+  static void destroy(TextureBuffer &texture_buffer);
+  // Grow the buffer if needed (doubling) and upload the data
+  static void upload(TextureBuffer &texture_buffer, const void *data,
+                     std::size_t size);
+};
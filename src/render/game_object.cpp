@@ -1,20 +1,37 @@
 #include "game_object.hpp"
 #include "texture_manager.hpp"
+#include "profiling/trace.hpp"
 #include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <utility>
 
-GameObject::GameObject(const std::string &model_path,
+GameObject::GameObject(std::shared_ptr<const Model> model,
                        const std::string &texture_path)
     : m_use_texture(true), m_position(glm::vec3(0.0f)),
       m_rotation(glm::vec3(0.0f)), m_scale(1.0f),
-      m_3D_model(Model(model_path)) {
+      m_3D_model(std::move(model)) {
   load_texture(texture_path);
   update_model_matrix();
   set_lighting_factors({1.0f, 1.0f, 1.0f}, {0.5f, 0.5f, 0.5f}, 64.0f);
 }
 
-GameObject::GameObject(const std::string &model_path, const glm::vec3 &color)
+GameObject::GameObject(std::shared_ptr<const Model> model,
+                       const glm::vec3 &color)
     : m_use_texture(false), m_base_color(color), m_position(glm::vec3(0.0f)),
-      m_rotation(glm::vec3(0.0f)), m_scale(1.0f), m_3D_model(model_path) {
+      m_rotation(glm::vec3(0.0f)), m_scale(1.0f),
+      m_3D_model(std::move(model)) {
+  update_model_matrix();
+  set_lighting_factors({1.0f, 1.0f, 1.0f}, {0.5f, 0.5f, 0.5f}, 64.0f);
+}
+
+GameObject::GameObject(std::shared_ptr<const Model> model,
+                       const TextureArray &texture_array,
+                       const std::string &texture_path)
+    : m_3D_model(std::move(model)), m_use_texture(true),
+      m_texture_path(texture_path), m_texture_array(&texture_array),
+      m_texture_layer(texture_array.layer_of(texture_path)),
+      m_position(glm::vec3(0.0f)), m_rotation(glm::vec3(0.0f)),
+      m_scale(1.0f) {
   update_model_matrix();
   set_lighting_factors({1.0f, 1.0f, 1.0f}, {0.5f, 0.5f, 0.5f}, 64.0f);
 }
@@ -42,17 +59,22 @@ void GameObject::set_lighting_factors(const glm::vec3 &new_diffuse,
   m_shininess_factor = new_shininess;
 }
 
-void GameObject::draw() const { m_3D_model.draw(); }
+void GameObject::update_lod(const View &view) {
+  m_lod = m_3D_model->select_lod(view.screen_size(m_world_sphere), m_lod);
+}
 
 void GameObject::load_texture(const std::string &texture_path) {
   // Load texture from file path
   std::cout << "Loading texture from: " << texture_path << std::endl;
 
   m_texture_object = TextureManager::load_texture(texture_path);
+  m_texture_path = texture_path;
 }
 
 void GameObject::change_texture(const std::string &texture_path) {
   load_texture(texture_path);
+  m_texture_array = nullptr;
+  m_texture_layer = -1;
   this->m_use_texture = true;
 }
 
@@ -67,6 +89,10 @@ void GameObject::update_model_matrix() {
   m_model_matrix = glm::rotate(m_model_matrix, glm::radians(m_rotation.z),
                                glm::vec3(0, 0, 1));
   m_model_matrix = glm::scale(m_model_matrix, m_scale);
+  m_normal_matrix = glm::transpose(glm::inverse(glm::mat3(m_model_matrix)));
+
+  m_world_box = transform(m_3D_model->get_bounding_box(), m_model_matrix);
+  m_world_sphere = transform(m_3D_model->get_bounding_sphere(), m_model_matrix);
 }
 
 void GameObject::move_x(const float offset) {
@@ -102,68 +128,38 @@ void GameObject::interpolate_material_factors(const glm::vec3 &target_diffuse,
       glm::mix(m_shininess_factor, target_shininess, blend_factor);
 }
 
-void GameObject::setup_matrices(Program &program, const glm::mat4 &view_matrix,
-                                const glm::mat4 &proj_matrix,
-                                const glm::mat4 &model_matrix) {
-  glm::mat4 MV_matrix = view_matrix * model_matrix;
-  glm::mat3 normal_matrix = glm::transpose(glm::inverse(glm::mat3(MV_matrix)));
-  glm::mat4 MVP_matrix = proj_matrix * MV_matrix;
-
-  glUniformMatrix4fv(program.u_MVP_matrix, 1, GL_FALSE,
-                     glm::value_ptr(MVP_matrix));
-  glUniformMatrix4fv(program.u_MV_matrix, 1, GL_FALSE,
-                     glm::value_ptr(MV_matrix));
-  glUniformMatrix3fv(program.u_normal_matrix, 1, GL_FALSE,
-                     glm::value_ptr(normal_matrix));
-}
-
-void GameObject::setup_shader(Program &program, const glm::vec3 &kd,
-                              const glm::vec3 &ks, float shininess,
-                              const glm::vec3 &color, bool use_texture) {
-  glUniform3fv(program.u_kd, 1, glm::value_ptr(kd));
-  glUniform3fv(program.u_ks, 1, glm::value_ptr(ks));
-  glUniform1f(program.u_shininess, shininess);
-
-  if (use_texture && this->get_use_texture()) {
-    glUniform1i(program.u_texture, 0); // Bind texture unit 0
-    glBindTexture(GL_TEXTURE_2D, this->get_texture());
-    glUniform1i(program.u_use_color, 0); // Signal to use texture
+void GameObject::submit(RenderQueue &queue, Program &program,
+                        const View &view) const {
+  TraceScope trace("GameObject::submit");
+  DrawPacket packet;
+  packet.program_id = program.id();
+  packet.program = &program;
+  packet.vertex_array = m_3D_model->get_VAO().get_id();
+  packet.model_matrix = &m_model_matrix;
+  packet.normal_matrix = &m_normal_matrix;
+
+  DrawPacket::Material &material = packet.material;
+  material.diffuse = m_diffuse_factor;
+  material.specular = m_specular_factor;
+  material.shininess = m_shininess_factor;
+  if (!m_use_texture) {
+    material.use_color = true;
+    material.color = m_base_color;
+  } else if (m_texture_array != nullptr) {
+    material.use_texture_array = true;
+    material.texture_layer = static_cast<float>(m_texture_layer);
+    packet.texture_unit = TextureArray::texture_unit;
+    packet.texture_target = GL_TEXTURE_2D_ARRAY;
+    packet.texture = m_texture_array->get_id();
   } else {
-    glUniform1i(program.u_use_color, 1); // Signal to use color
-    glUniform3fv(program.u_color, 1,
-                 glm::value_ptr(color)); // Send the color to the shader
+    packet.texture_target = GL_TEXTURE_2D;
+    packet.texture = m_texture_object;
   }
-}
-
-void GameObject::render_game_object(Program &program,
-                                    const glm::mat4 &view_matrix,
-                                    const glm::mat4 &proj_matrix) {
-  program.use();
 
-  glm::mat4 model_matrix = this->get_model_matrix();
-  setup_matrices(program, view_matrix, proj_matrix, model_matrix);
+  const Model::Lod &range = m_3D_model->get_lod(m_lod);
+  packet.first = range.first;
+  packet.count = range.count;
 
-  glm::vec3 diffuse = this->get_diffuse_factor();
-  glm::vec3 specular = this->get_specular_factor();
-  float shininess = this->get_shininess_factor();
-  setup_shader(program, diffuse, specular, shininess, this->get_base_color(),
-               true);
-
-  this->draw();
+  queue.submit(RenderPass::Opaque, view.depth_of(m_world_sphere.center),
+               packet);
 }
-
-void GameObject::render_edge(Program &program, const glm::mat4 &view_matrix,
-                             const glm::mat4 &proj_matrix,
-                             const float scale_factor) {
-  program.use();
-
-  glm::mat4 model_matrix = glm::scale(
-      this->get_model_matrix(), {scale_factor, scale_factor, scale_factor});
-  setup_matrices(program, view_matrix, proj_matrix, model_matrix);
-
-  glm::vec3 white(1.0f, 1.0f, 1.0f);
-  glm::vec3 black(0.0f, 0.0f, 0.0f);
-  setup_shader(program, white, white, 0.0f, black, false);
-
-  this->draw();
-}
\ No newline at end of file
@@ -1,33 +1,46 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <memory>
 #include <string>
 #include "3D_model.hpp"
 #include "glm/gtc/type_ptr.hpp"
 #include "program.hpp"
+#include "render_queue.hpp"
+#include "texture_array.hpp"
+#include "view.hpp"
 
 class GameObject {
 private:
-    Model     m_3D_model;
-    GLuint    m_texture_object;
+    std::shared_ptr<const Model> m_3D_model; // Shared by every object of the same mesh
+    GLuint    m_texture_object = 0;
     bool      m_use_texture; // Indicates whether to use a texture
     glm::vec3 m_base_color;  // Base color if no texture is used
 
+    std::string         m_texture_path;
+    const TextureArray* m_texture_array = nullptr; // Set when the texture is packed in an array
+    int                 m_texture_layer = -1;
+
     glm::vec3 m_position;
     glm::vec3 m_rotation;
     glm::vec3 m_scale;
-    glm::mat4 m_model_matrix; // Transformation matrix of the object
+    glm::mat4 m_model_matrix;  // Transformation matrix of the object
+    glm::mat3 m_normal_matrix; // Inverse transpose of the model matrix
+
+    BoundingBox    m_world_box; // Model bounds moved with the model matrix
+    BoundingSphere m_world_sphere;
+    int            m_lod = 0; // Level of detail drawn, see update_lod
 
     glm::vec3 m_diffuse_factor;   // Diffuse reflectivity
     glm::vec3 m_specular_factor;  // Specular reflectivity
     float     m_shininess_factor; // Shininess for specular highlight
 
-    void setup_matrices(Program& program, const glm::mat4& view_matrix, const glm::mat4& proj_matrix, const glm::mat4& model_matrix);
-    void setup_shader(Program& program, const glm::vec3& kd, const glm::vec3& ks, float shininess, const glm::vec3& color, bool use_texture);
-
 public:
-    GameObject(const std::string& model_path, const std::string& texture_path);
-    GameObject(const std::string& model_path, const glm::vec3& color);
+    // The mesh comes from a ModelCache, shared by every object using it
+    GameObject(std::shared_ptr<const Model> model, const std::string& texture_path);
+    GameObject(std::shared_ptr<const Model> model, const glm::vec3& color);
+    // Texture sampled from its layer in a baked array, never loaded on its own
+    GameObject(std::shared_ptr<const Model> model, const TextureArray& texture_array, const std::string& texture_path);
 
     void set_position(const glm::vec3& new_position);
     void set_rotation(const glm::vec3& new_rotation);
@@ -44,10 +57,25 @@ public:
     GLuint    get_texture() const { return m_texture_object; }
     bool      get_use_texture() const { return m_use_texture; }
 
+    const std::string&  get_texture_path() const { return m_texture_path; }
+    const TextureArray* get_texture_array() const { return m_texture_array; }
+    int                 get_texture_layer() const { return m_texture_layer; }
+    const Model&        get_model() const { return *m_3D_model; }
+
+    const std::shared_ptr<const Model>& get_shared_model() const { return m_3D_model; }
+
     glm::vec3 get_position() const { return m_position; }
     glm::vec3 get_rotation() const { return m_rotation; }
     glm::vec3 get_scale() const { return m_scale; }
     glm::mat4 get_model_matrix() const { return m_model_matrix; }
+    const glm::mat3& get_normal_matrix() const { return m_normal_matrix; }
+
+    const BoundingBox&    get_world_box() const { return m_world_box; }
+    const BoundingSphere& get_world_sphere() const { return m_world_sphere; }
+    int                   get_lod() const { return m_lod; }
+
+    // Pick the level of detail from the projected size of the object
+    void update_lod(const View& view);
 
     glm::vec3 get_diffuse_factor() const { return m_diffuse_factor; }
     glm::vec3 get_specular_factor() const { return m_specular_factor; }
@@ -56,12 +84,11 @@ public:
     void load_texture(const std::string& texture_path);
     void update_model_matrix();
     void change_texture(const std::string& texture_path);
+
     void change_color(const glm::vec3& color);
 
     void interpolate_material_factors(const glm::vec3& target_diffuse, const glm::vec3& target_specular, float target_shininess, float blend_factor);
 
-    void render_game_object(Program& program, const glm::mat4& view_matrix, const glm::mat4& proj_matrix);
-    void render_edge(Program& program, const glm::mat4& view_matrix, const glm::mat4& proj_matrix, const float scale_factor);
-
-    void draw() const;
+    // Queue the current level of detail, drawn by RenderQueue::execute
+    void submit(RenderQueue& queue, Program& program, const View& view) const;
 };
@@ -0,0 +1,344 @@
+#include "gl_backend.hpp"
+#include <vector>
+
+namespace {
+
+class OpenGLBackend : public GlBackend {
+public:
+  void use_program(GLuint program) override { glUseProgram(program); }
+  void bind_vertex_array(GLuint vertex_array) override {
+    glBindVertexArray(vertex_array);
+  }
+  void bind_buffer(GLenum target, GLuint buffer) override {
+    glBindBuffer(target, buffer);
+  }
+  void bind_buffer_base(GLenum target, GLuint index, GLuint buffer) override {
+    glBindBufferBase(target, index, buffer);
+  }
+  void active_texture(GLenum unit) override { glActiveTexture(unit); }
+  void bind_texture(GLenum target, GLuint texture) override {
+    glBindTexture(target, texture);
+  }
+
+  GLuint gen_vertex_array() override {
+    GLuint vertex_array = 0;
+    glGenVertexArrays(1, &vertex_array);
+    return vertex_array;
+  }
+  void delete_vertex_array(GLuint vertex_array) override {
+    glDeleteVertexArrays(1, &vertex_array);
+  }
+  GLuint gen_buffer() override {
+    GLuint buffer = 0;
+    glGenBuffers(1, &buffer);
+    return buffer;
+  }
+  void delete_buffer(GLuint buffer) override { glDeleteBuffers(1, &buffer); }
+  GLuint gen_texture() override {
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    return texture;
+  }
+  void delete_texture(GLuint texture) override {
+    glDeleteTextures(1, &texture);
+  }
+
+  void enable_vertex_attrib_array(GLuint index) override {
+    glEnableVertexAttribArray(index);
+  }
+  void vertex_attrib_pointer(GLuint index, GLint size, GLenum type,
+                             GLboolean normalized, GLsizei stride,
+                             const void *pointer) override {
+    glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+  }
+  void vertex_attrib_1f(GLuint index, GLfloat value) override {
+    glVertexAttrib1f(index, value);
+  }
+  void vertex_attrib_divisor(GLuint index, GLuint divisor) override {
+    glVertexAttribDivisor(index, divisor);
+  }
+
+  void buffer_data(GLenum target, GLsizeiptr size, const void *data,
+                   GLenum usage) override {
+    glBufferData(target, size, data, usage);
+  }
+  void buffer_sub_data(GLenum target, GLintptr offset, GLsizeiptr size,
+                       const void *data) override {
+    glBufferSubData(target, offset, size, data);
+  }
+
+  void buffer_storage(GLenum target, GLsizeiptr size, const void *data,
+                      GLbitfield flags) override {
+    glBufferStorage(target, size, data, flags);
+  }
+  void *map_buffer_range(GLenum target, GLintptr offset, GLsizeiptr length,
+                         GLbitfield access) override {
+    return glMapBufferRange(target, offset, length, access);
+  }
+  void unmap_buffer(GLenum target) override { glUnmapBuffer(target); }
+  void bind_buffer_range(GLenum target, GLuint index, GLuint buffer,
+                         GLintptr offset, GLsizeiptr size) override {
+    glBindBufferRange(target, index, buffer, offset, size);
+  }
+
+  GLsync fence_sync() override {
+    return glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+  GLenum client_wait_sync(GLsync sync, GLuint64 timeout) override {
+    return glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+  }
+  void delete_sync(GLsync sync) override { glDeleteSync(sync); }
+
+  GLuint gen_query() override {
+    GLuint query = 0;
+    glGenQueries(1, &query);
+    return query;
+  }
+  void delete_query(GLuint query) override { glDeleteQueries(1, &query); }
+  void begin_query(GLenum target, GLuint query) override {
+    glBeginQuery(target, query);
+  }
+  void end_query(GLenum target) override { glEndQuery(target); }
+  GLuint64 get_query_object_ui64(GLuint query, GLenum name) override {
+    GLuint64 value = 0;
+    glGetQueryObjectui64v(query, name, &value);
+    return value;
+  }
+
+  GLuint gen_framebuffer() override {
+    GLuint framebuffer = 0;
+    glGenFramebuffers(1, &framebuffer);
+    return framebuffer;
+  }
+  void delete_framebuffer(GLuint framebuffer) override {
+    glDeleteFramebuffers(1, &framebuffer);
+  }
+  void bind_framebuffer(GLenum target, GLuint framebuffer) override {
+    glBindFramebuffer(target, framebuffer);
+  }
+  GLuint gen_renderbuffer() override {
+    GLuint renderbuffer = 0;
+    glGenRenderbuffers(1, &renderbuffer);
+    return renderbuffer;
+  }
+  void delete_renderbuffer(GLuint renderbuffer) override {
+    glDeleteRenderbuffers(1, &renderbuffer);
+  }
+  void bind_renderbuffer(GLuint renderbuffer) override {
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+  }
+  void renderbuffer_storage(GLenum internal_format, GLsizei width,
+                            GLsizei height) override {
+    glRenderbufferStorage(GL_RENDERBUFFER, internal_format, width, height);
+  }
+  void framebuffer_renderbuffer(GLenum target, GLenum attachment,
+                                GLuint renderbuffer) override {
+    glFramebufferRenderbuffer(target, attachment, GL_RENDERBUFFER,
+                              renderbuffer);
+  }
+  GLenum check_framebuffer_status(GLenum target) override {
+    return glCheckFramebufferStatus(target);
+  }
+  void blit_framebuffer(GLint src_x0, GLint src_y0, GLint src_x1,
+                        GLint src_y1, GLint dst_x0, GLint dst_y0,
+                        GLint dst_x1, GLint dst_y1, GLbitfield mask,
+                        GLenum filter) override {
+    glBlitFramebuffer(src_x0, src_y0, src_x1, src_y1, dst_x0, dst_y0, dst_x1,
+                      dst_y1, mask, filter);
+  }
+  void viewport(GLint x, GLint y, GLsizei width, GLsizei height) override {
+    glViewport(x, y, width, height);
+  }
+  void read_pixels(GLint x, GLint y, GLsizei width, GLsizei height,
+                   GLenum format, GLenum type, void *pixels) override {
+    glReadPixels(x, y, width, height, format, type, pixels);
+  }
+
+  void tex_image_2d(GLenum target, GLint level, GLint internal_format,
+                    GLsizei width, GLsizei height, GLenum format, GLenum type,
+                    const void *data) override {
+    glTexImage2D(target, level, internal_format, width, height, 0, format,
+                 type, data);
+  }
+  void compressed_tex_image_2d(GLenum target, GLint level,
+                               GLenum internal_format, GLsizei width,
+                               GLsizei height, GLsizei image_size,
+                               const void *data) override {
+    glCompressedTexImage2D(target, level, internal_format, width, height, 0,
+                           image_size, data);
+  }
+  void compressed_tex_image_3d(GLenum target, GLint level,
+                               GLenum internal_format, GLsizei width,
+                               GLsizei height, GLsizei depth,
+                               GLsizei image_size, const void *data) override {
+    glCompressedTexImage3D(target, level, internal_format, width, height,
+                           depth, 0, image_size, data);
+  }
+  void tex_image_3d(GLenum target, GLint level, GLint internal_format,
+                    GLsizei width, GLsizei height, GLsizei depth,
+                    GLenum format, GLenum type, const void *data) override {
+    glTexImage3D(target, level, internal_format, width, height, depth, 0,
+                 format, type, data);
+  }
+  void tex_sub_image_3d(GLenum target, GLint level, GLint x_offset,
+                        GLint y_offset, GLint z_offset, GLsizei width,
+                        GLsizei height, GLsizei depth, GLenum format,
+                        GLenum type, const void *data) override {
+    glTexSubImage3D(target, level, x_offset, y_offset, z_offset, width,
+                    height, depth, format, type, data);
+  }
+  void tex_buffer(GLenum target, GLenum internal_format,
+                  GLuint buffer) override {
+    glTexBuffer(target, internal_format, buffer);
+  }
+  void tex_parameter_i(GLenum target, GLenum name, GLint value) override {
+    glTexParameteri(target, name, value);
+  }
+  void tex_parameter_f(GLenum target, GLenum name, GLfloat value) override {
+    glTexParameterf(target, name, value);
+  }
+  void generate_mipmap(GLenum target) override { glGenerateMipmap(target); }
+
+  GLuint create_shader(GLenum type) override { return glCreateShader(type); }
+  void shader_source(GLuint shader, const std::string &source) override {
+    const GLchar *text = source.c_str();
+    glShaderSource(shader, 1, &text, nullptr);
+  }
+  void compile_shader(GLuint shader) override { glCompileShader(shader); }
+  GLint get_shader_i(GLuint shader, GLenum name) override {
+    GLint value = 0;
+    glGetShaderiv(shader, name, &value);
+    return value;
+  }
+  std::string get_shader_info_log(GLuint shader) override {
+    std::vector<GLchar> log(
+        static_cast<std::size_t>(get_shader_i(shader, GL_INFO_LOG_LENGTH)) + 1);
+    glGetShaderInfoLog(shader, static_cast<GLsizei>(log.size()), nullptr,
+                       log.data());
+    return log.data();
+  }
+  void delete_shader(GLuint shader) override { glDeleteShader(shader); }
+  GLuint create_program() override { return glCreateProgram(); }
+  void attach_shader(GLuint program, GLuint shader) override {
+    glAttachShader(program, shader);
+  }
+  void link_program(GLuint program) override { glLinkProgram(program); }
+  GLint get_program_i(GLuint program, GLenum name) override {
+    GLint value = 0;
+    glGetProgramiv(program, name, &value);
+    return value;
+  }
+  std::string get_program_info_log(GLuint program) override {
+    std::vector<GLchar> log(
+        static_cast<std::size_t>(get_program_i(program, GL_INFO_LOG_LENGTH)) +
+        1);
+    glGetProgramInfoLog(program, static_cast<GLsizei>(log.size()), nullptr,
+                        log.data());
+    return log.data();
+  }
+  void delete_program(GLuint program) override { glDeleteProgram(program); }
+
+  std::string get_active_uniform(GLuint program, GLuint index, GLint &size,
+                                 GLenum &type) override {
+    std::vector<GLchar> name(static_cast<std::size_t>(get_program_i(
+                                 program, GL_ACTIVE_UNIFORM_MAX_LENGTH)) +
+                             1);
+    glGetActiveUniform(program, index, static_cast<GLsizei>(name.size()),
+                       nullptr, &size, &type, name.data());
+    return name.data();
+  }
+  std::string get_active_attrib(GLuint program, GLuint index, GLint &size,
+                                GLenum &type) override {
+    std::vector<GLchar> name(static_cast<std::size_t>(get_program_i(
+                                 program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH)) +
+                             1);
+    glGetActiveAttrib(program, index, static_cast<GLsizei>(name.size()),
+                      nullptr, &size, &type, name.data());
+    return name.data();
+  }
+  GLint get_uniform_location(GLuint program, const char *name) override {
+    return glGetUniformLocation(program, name);
+  }
+  GLint get_attrib_location(GLuint program, const char *name) override {
+    return glGetAttribLocation(program, name);
+  }
+  GLuint get_uniform_block_index(GLuint program,
+                                 const char *block_name) override {
+    return glGetUniformBlockIndex(program, block_name);
+  }
+  void uniform_block_binding(GLuint program, GLuint block_index,
+                             GLuint binding) override {
+    glUniformBlockBinding(program, block_index, binding);
+  }
+
+  void uniform_1i(GLint location, GLint value) override {
+    glUniform1i(location, value);
+  }
+  void uniform_1f(GLint location, GLfloat value) override {
+    glUniform1f(location, value);
+  }
+  void uniform_3fv(GLint location, const GLfloat *value) override {
+    glUniform3fv(location, 1, value);
+  }
+  void uniform_4fv(GLint location, const GLfloat *value) override {
+    glUniform4fv(location, 1, value);
+  }
+  void uniform_matrix_3fv(GLint location, const GLfloat *value) override {
+    glUniformMatrix3fv(location, 1, GL_FALSE, value);
+  }
+  void uniform_matrix_4fv(GLint location, const GLfloat *value) override {
+    glUniformMatrix4fv(location, 1, GL_FALSE, value);
+  }
+
+  GLenum get_error() override { return glGetError(); }
+  GLint get_integer(GLenum name) override {
+    GLint value = 0;
+    glGetIntegerv(name, &value);
+    return value;
+  }
+  GLfloat get_float(GLenum name) override {
+    GLfloat value = 0.f;
+    glGetFloatv(name, &value);
+    return value;
+  }
+  const char *get_string_i(GLenum name, GLuint index) override {
+    return reinterpret_cast<const char *>(glGetStringi(name, index));
+  }
+
+  void draw_arrays(GLenum mode, GLint first, GLsizei count) override {
+    glDrawArrays(mode, first, count);
+  }
+  void multi_draw_arrays(GLenum mode, const GLint *first, const GLsizei *count,
+                         GLsizei draw_count) override {
+    glMultiDrawArrays(mode, first, count, draw_count);
+  }
+  void draw_arrays_instanced(GLenum mode, GLint first, GLsizei count,
+                             GLsizei instance_count) override {
+    glDrawArraysInstanced(mode, first, count, instance_count);
+  }
+  void draw_arrays_instanced_base_instance(GLenum mode, GLint first,
+                                           GLsizei count,
+                                           GLsizei instance_count,
+                                           GLuint base_instance) override {
+    glDrawArraysInstancedBaseInstance(mode, first, count, instance_count,
+                                      base_instance);
+  }
+};
+
+GlBackend *&current_backend() {
+  static GlBackend *backend = &GlBackend::opengl();
+  return backend;
+}
+
+} // namespace
+
+GlBackend &GlBackend::opengl() {
+  static OpenGLBackend backend;
+  return backend;
+}
+
+GlBackend &GlBackend::current() { return *current_backend(); }
+
+void GlBackend::set_current(GlBackend &backend) {
+  current_backend() = &backend;
+}
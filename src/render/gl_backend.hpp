@@ -0,0 +1,195 @@
+#pragma once
+
+#include <string>
+#include "p6/p6.h"
+
+// Thin dispatch layer over the GL functions used by the renderer. Render code
+// calls gl().xxx() instead of glXxx(), so tests can swap the OpenGL backend
+// for a RecordingGlBackend and run without a context.
+class GlBackend {
+public:
+  virtual ~GlBackend() = default;
+
+  // Bindings
+  virtual void use_program(GLuint program) = 0;
+  virtual void bind_vertex_array(GLuint vertex_array) = 0;
+  virtual void bind_buffer(GLenum target, GLuint buffer) = 0;
+  virtual void bind_buffer_base(GLenum target, GLuint index,
+                                GLuint buffer) = 0;
+  virtual void active_texture(GLenum unit) = 0;
+  virtual void bind_texture(GLenum target, GLuint texture) = 0;
+
+  // Objects
+  virtual GLuint gen_vertex_array() = 0;
+  virtual void delete_vertex_array(GLuint vertex_array) = 0;
+  virtual GLuint gen_buffer() = 0;
+  virtual void delete_buffer(GLuint buffer) = 0;
+  virtual GLuint gen_texture() = 0;
+  virtual void delete_texture(GLuint texture) = 0;
+
+  // Vertex attributes
+  virtual void enable_vertex_attrib_array(GLuint index) = 0;
+  virtual void vertex_attrib_pointer(GLuint index, GLint size, GLenum type,
+                                     GLboolean normalized, GLsizei stride,
+                                     const void *pointer) = 0;
+  virtual void vertex_attrib_1f(GLuint index, GLfloat value) = 0;
+  // Instances sharing a value of the attribute, 0 for a per-vertex attribute
+  virtual void vertex_attrib_divisor(GLuint index, GLuint divisor) = 0;
+
+  // Buffer uploads
+  virtual void buffer_data(GLenum target, GLsizeiptr size, const void *data,
+                           GLenum usage) = 0;
+  virtual void buffer_sub_data(GLenum target, GLintptr offset,
+                               GLsizeiptr size, const void *data) = 0;
+  // Immutable storage (GL 4.4 / ARB_buffer_storage)
+  virtual void buffer_storage(GLenum target, GLsizeiptr size,
+                              const void *data, GLbitfield flags) = 0;
+  virtual void *map_buffer_range(GLenum target, GLintptr offset,
+                                 GLsizeiptr length, GLbitfield access) = 0;
+  virtual void unmap_buffer(GLenum target) = 0;
+  virtual void bind_buffer_range(GLenum target, GLuint index, GLuint buffer,
+                                 GLintptr offset, GLsizeiptr size) = 0;
+
+  // Synchronisation
+  virtual GLsync fence_sync() = 0;
+  // GL_ALREADY_SIGNALED, GL_CONDITION_SATISFIED, GL_TIMEOUT_EXPIRED or
+  // GL_WAIT_FAILED, timeout in nanoseconds
+  virtual GLenum client_wait_sync(GLsync sync, GLuint64 timeout) = 0;
+  virtual void delete_sync(GLsync sync) = 0;
+
+  // Query objects, the result is read without waiting once
+  // GL_QUERY_RESULT_AVAILABLE is set
+  virtual GLuint gen_query() = 0;
+  virtual void delete_query(GLuint query) = 0;
+  virtual void begin_query(GLenum target, GLuint query) = 0;
+  virtual void end_query(GLenum target) = 0;
+  virtual GLuint64 get_query_object_ui64(GLuint query, GLenum name) = 0;
+
+  // Framebuffers, for offscreen rendering
+  virtual GLuint gen_framebuffer() = 0;
+  virtual void delete_framebuffer(GLuint framebuffer) = 0;
+  virtual void bind_framebuffer(GLenum target, GLuint framebuffer) = 0;
+  virtual GLuint gen_renderbuffer() = 0;
+  virtual void delete_renderbuffer(GLuint renderbuffer) = 0;
+  virtual void bind_renderbuffer(GLuint renderbuffer) = 0;
+  // Storage of the bound renderbuffer
+  virtual void renderbuffer_storage(GLenum internal_format, GLsizei width,
+                                    GLsizei height) = 0;
+  virtual void framebuffer_renderbuffer(GLenum target, GLenum attachment,
+                                        GLuint renderbuffer) = 0;
+  virtual GLenum check_framebuffer_status(GLenum target) = 0;
+  virtual void blit_framebuffer(GLint src_x0, GLint src_y0, GLint src_x1,
+                                GLint src_y1, GLint dst_x0, GLint dst_y0,
+                                GLint dst_x1, GLint dst_y1, GLbitfield mask,
+                                GLenum filter) = 0;
+  virtual void viewport(GLint x, GLint y, GLsizei width, GLsizei height) = 0;
+  // With a buffer bound to GL_PIXEL_PACK_BUFFER, pixels is an offset in it
+  // and the read does not wait for the GPU
+  virtual void read_pixels(GLint x, GLint y, GLsizei width, GLsizei height,
+                           GLenum format, GLenum type, void *pixels) = 0;
+
+  // Texture uploads
+  virtual void tex_image_2d(GLenum target, GLint level, GLint internal_format,
+                            GLsizei width, GLsizei height, GLenum format,
+                            GLenum type, const void *data) = 0;
+  virtual void compressed_tex_image_2d(GLenum target, GLint level,
+                                       GLenum internal_format, GLsizei width,
+                                       GLsizei height, GLsizei image_size,
+                                       const void *data) = 0;
+  virtual void compressed_tex_image_3d(GLenum target, GLint level,
+                                       GLenum internal_format, GLsizei width,
+                                       GLsizei height, GLsizei depth,
+                                       GLsizei image_size,
+                                       const void *data) = 0;
+  virtual void tex_image_3d(GLenum target, GLint level, GLint internal_format,
+                            GLsizei width, GLsizei height, GLsizei depth,
+                            GLenum format, GLenum type, const void *data) = 0;
+  virtual void tex_sub_image_3d(GLenum target, GLint level, GLint x_offset,
+                                GLint y_offset, GLint z_offset, GLsizei width,
+                                GLsizei height, GLsizei depth, GLenum format,
+                                GLenum type, const void *data) = 0;
+  virtual void tex_buffer(GLenum target, GLenum internal_format,
+                          GLuint buffer) = 0;
+  virtual void tex_parameter_i(GLenum target, GLenum name, GLint value) = 0;
+  virtual void tex_parameter_f(GLenum target, GLenum name, GLfloat value) = 0;
+  virtual void generate_mipmap(GLenum target) = 0;
+
+  // Shaders and programs
+  virtual GLuint create_shader(GLenum type) = 0;
+  virtual void shader_source(GLuint shader, const std::string &source) = 0;
+  virtual void compile_shader(GLuint shader) = 0;
+  virtual GLint get_shader_i(GLuint shader, GLenum name) = 0;
+  virtual std::string get_shader_info_log(GLuint shader) = 0;
+  virtual void delete_shader(GLuint shader) = 0;
+  virtual GLuint create_program() = 0;
+  virtual void attach_shader(GLuint program, GLuint shader) = 0;
+  virtual void link_program(GLuint program) = 0;
+  virtual GLint get_program_i(GLuint program, GLenum name) = 0;
+  virtual std::string get_program_info_log(GLuint program) = 0;
+  virtual void delete_program(GLuint program) = 0;
+
+  // Reflection, the active resource name is returned
+  virtual std::string get_active_uniform(GLuint program, GLuint index,
+                                         GLint &size, GLenum &type) = 0;
+  virtual std::string get_active_attrib(GLuint program, GLuint index,
+                                        GLint &size, GLenum &type) = 0;
+  virtual GLint get_uniform_location(GLuint program, const char *name) = 0;
+  virtual GLint get_attrib_location(GLuint program, const char *name) = 0;
+  virtual GLuint get_uniform_block_index(GLuint program,
+                                         const char *block_name) = 0;
+  virtual void uniform_block_binding(GLuint program, GLuint block_index,
+                                     GLuint binding) = 0;
+
+  // Uniform uploads, to the program in use
+  virtual void uniform_1i(GLint location, GLint value) = 0;
+  virtual void uniform_1f(GLint location, GLfloat value) = 0;
+  virtual void uniform_3fv(GLint location, const GLfloat *value) = 0;
+  virtual void uniform_4fv(GLint location, const GLfloat *value) = 0;
+  virtual void uniform_matrix_3fv(GLint location, const GLfloat *value) = 0;
+  virtual void uniform_matrix_4fv(GLint location, const GLfloat *value) = 0;
+
+  // Queries
+  virtual GLenum get_error() = 0;
+  virtual GLint get_integer(GLenum name) = 0;
+  virtual GLfloat get_float(GLenum name) = 0;
+  virtual const char *get_string_i(GLenum name, GLuint index) = 0;
+
+  // Draws
+  virtual void draw_arrays(GLenum mode, GLint first, GLsizei count) = 0;
+  virtual void multi_draw_arrays(GLenum mode, const GLint *first,
+                                 const GLsizei *count, GLsizei draw_count) = 0;
+  virtual void draw_arrays_instanced(GLenum mode, GLint first, GLsizei count,
+                                     GLsizei instance_count) = 0;
+  // Instanced attributes start at base_instance (GL 4.2)
+  virtual void draw_arrays_instanced_base_instance(GLenum mode, GLint first,
+                                                   GLsizei count,
+                                                   GLsizei instance_count,
+                                                   GLuint base_instance) = 0;
+
+  // Forwards to the current GL context
+  static GlBackend &opengl();
+
+  // Backend the render code talks to, opengl() unless swapped
+  static GlBackend &current();
+  static void set_current(GlBackend &backend);
+};
+
+// Shorthand used by the render code
+inline GlBackend &gl() { return GlBackend::current(); }
+
+// Swaps the current backend for the lifetime of the object
+class ScopedGlBackend {
+public:
+  explicit ScopedGlBackend(GlBackend &backend)
+      : m_previous(GlBackend::current()) {
+    GlBackend::set_current(backend);
+  }
+  ~ScopedGlBackend() { GlBackend::set_current(m_previous); }
+
+  // Empêcher la copie
+  ScopedGlBackend(const ScopedGlBackend &) = delete;
+  ScopedGlBackend &operator=(const ScopedGlBackend &) = delete;
+
+private:
+  GlBackend &m_previous;
+};
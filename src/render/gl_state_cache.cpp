@@ -0,0 +1,88 @@
+#include "gl_state_cache.hpp"
+#include "doctest/doctest.h"
+#include "recording_gl_backend.hpp"
+
+GlStateCache::GlStateCache(GlBackend &backend) : m_backend(backend) {}
+
+void GlStateCache::use_program(GLuint program) {
+  if (program == m_program) {
+    ++m_skipped;
+    return;
+  }
+  m_program = program;
+  m_backend.use_program(program);
+  ++m_issued;
+}
+
+void GlStateCache::bind_vertex_array(GLuint vertex_array) {
+  if (vertex_array == m_vertex_array) {
+    ++m_skipped;
+    return;
+  }
+  m_vertex_array = vertex_array;
+  m_backend.bind_vertex_array(vertex_array);
+  ++m_issued;
+}
+
+void GlStateCache::bind_texture(GLuint unit, GLenum target, GLuint texture) {
+  // Units past the shadow copy are bound every time
+  const bool cached = unit < texture_unit_count;
+  if (cached && m_textures[unit].target == target &&
+      m_textures[unit].texture == texture) {
+    ++m_skipped;
+    return;
+  }
+  if (unit != m_active_unit) {
+    m_active_unit = unit;
+    m_backend.active_texture(GL_TEXTURE0 + unit);
+    ++m_issued;
+  }
+  if (cached)
+    m_textures[unit] = {target, texture};
+  m_backend.bind_texture(target, texture);
+  ++m_issued;
+}
+
+void GlStateCache::invalidate() {
+  m_program = unknown;
+  m_vertex_array = unknown;
+  m_active_unit = unknown;
+  m_textures.fill({});
+}
+
+TEST_CASE("GL state cache drops redundant binds") {
+  RecordingGlBackend backend;
+  GlStateCache cache(backend);
+
+  cache.use_program(3);
+  cache.use_program(3);
+  cache.bind_vertex_array(7);
+  cache.bind_vertex_array(7);
+  cache.bind_texture(0, GL_TEXTURE_2D, 11);
+  cache.bind_texture(0, GL_TEXTURE_2D, 11);
+  CHECK(backend.count("use_program") == 1);
+  CHECK(backend.count("bind_vertex_array") == 1);
+  CHECK(backend.count("bind_texture") == 1);
+  CHECK(backend.count("active_texture") == 1);
+  CHECK(cache.get_skipped_count() == 3);
+
+  // A different unit switches the active unit once
+  cache.bind_texture(1, GL_TEXTURE_2D_ARRAY, 12);
+  cache.bind_texture(1, GL_TEXTURE_2D_ARRAY, 13);
+  CHECK(backend.count("active_texture") == 2);
+  CHECK(backend.count("bind_texture") == 3);
+
+  // Units past the shadow copy are not cached
+  const GLuint uncached = GlStateCache::texture_unit_count;
+  cache.bind_texture(uncached, GL_TEXTURE_2D, 14);
+  cache.bind_texture(uncached, GL_TEXTURE_2D, 14);
+  CHECK(backend.count("bind_texture") == 5);
+  CHECK(backend.count("active_texture") == 3);
+
+  // After an invalidation everything is issued again
+  cache.invalidate();
+  cache.use_program(3);
+  cache.bind_vertex_array(7);
+  CHECK(backend.count("use_program") == 2);
+  CHECK(backend.count("bind_vertex_array") == 2);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include "gl_backend.hpp"
+
+// Shadow copy of the bindings last set through it, redundant calls are
+// dropped. Anything binding behind its back must call invalidate().
+class GlStateCache {
+public:
+  static constexpr std::size_t texture_unit_count = 8;
+
+  explicit GlStateCache(GlBackend &backend = GlBackend::current());
+
+  void use_program(GLuint program);
+  void bind_vertex_array(GLuint vertex_array);
+  void bind_texture(GLuint unit, GLenum target, GLuint texture);
+
+  // Forget the shadow state, the next calls are all issued
+  void invalidate();
+
+  GlBackend &backend() { return m_backend; }
+
+  int get_issued_count() const { return m_issued; }
+  int get_skipped_count() const { return m_skipped; }
+  void reset_counters() { m_issued = m_skipped = 0; }
+
+private:
+  // Values no valid binding can have
+  static constexpr GLuint unknown = ~GLuint(0);
+
+  struct TextureBinding {
+    GLenum target = 0;
+    GLuint texture = unknown;
+  };
+
+  GlBackend &m_backend;
+  GLuint m_program = unknown;
+  GLuint m_vertex_array = unknown;
+  GLuint m_active_unit = unknown;
+  std::array<TextureBinding, texture_unit_count> m_textures{};
+
+  int m_issued = 0;
+  int m_skipped = 0;
+};
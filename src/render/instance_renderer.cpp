@@ -0,0 +1,274 @@
+#include "instance_renderer.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <optional>
+#include "doctest/doctest.h"
+#include "recording_gl_backend.hpp"
+#include "test_model_file.hpp"
+#include "texture_manager.hpp"
+
+namespace {
+
+// Instanced attributes starting past the first instance are core since GL 4.2
+bool has_base_instance() {
+  GLint major = gl().get_integer(GL_MAJOR_VERSION);
+  GLint minor = gl().get_integer(GL_MINOR_VERSION);
+  return major > 4 || (major == 4 && minor >= 2) ||
+         TextureManager::has_extension("GL_ARB_base_instance");
+}
+
+} // namespace
+
+InstanceRenderer::InstanceRenderer()
+    : m_stream(GL_ARRAY_BUFFER, initial_capacity * sizeof(Instance),
+               sizeof(Instance)),
+      m_base_instance(has_base_instance()) {}
+
+InstanceRenderer::BatchKey
+InstanceRenderer::key_of(const GameObject &object) {
+  return {&object.get_model(),          object.get_lod(),
+          object.get_use_texture(),     object.get_texture(),
+          object.get_texture_array(),   object.get_diffuse_factor(),
+          object.get_specular_factor(), object.get_shininess_factor()};
+}
+
+void InstanceRenderer::clear() {
+  // Keep the batches of the last frame, their instances are reused
+  std::erase_if(m_batches,
+                [](const Batch &batch) { return batch.instances.empty(); });
+  for (Batch &batch : m_batches)
+    batch.instances.clear();
+  m_instances.clear();
+}
+
+void InstanceRenderer::add(const GameObject &object, const View &view) {
+  BatchKey key = key_of(object);
+  auto batch = std::find_if(
+      m_batches.begin(), m_batches.end(),
+      [&](const Batch &batch) { return batch.key == key; });
+  float depth = view.depth_of(object.get_world_sphere().center);
+  if (batch == m_batches.end()) {
+    m_batches.push_back({key, &vertex_array_of(object), depth, {}, nullptr});
+    batch = std::prev(m_batches.end());
+  } else if (batch->instances.empty()) {
+    batch->depth = depth; // First instance of the frame
+  } else {
+    batch->depth = std::min(batch->depth, depth);
+  }
+
+  batch->instances.push_back(
+      {object.get_model_matrix(), object.get_normal_matrix(),
+       glm::vec4(object.get_base_color(),
+                 static_cast<float>(object.get_texture_layer()))});
+}
+
+InstanceRenderer::MeshVertexArray &
+InstanceRenderer::vertex_array_of(const GameObject &object) {
+  MeshVertexArray &vertex_array = m_vertex_arrays[&object.get_model()];
+  if (!vertex_array.vao) {
+    vertex_array.model = object.get_shared_model();
+    vertex_array.vao = std::make_unique<VAO>();
+    vertex_array.model->specify_attributes(*vertex_array.vao);
+  }
+  return vertex_array;
+}
+
+void InstanceRenderer::specify_instance_attributes(
+    MeshVertexArray &vertex_array, std::size_t offset) {
+  vertex_array.attribute_generation = m_stream.get_generation();
+  gl().bind_buffer(GL_ARRAY_BUFFER, m_stream.get_id());
+
+  VAO &vao = *vertex_array.vao;
+  constexpr int stride = sizeof(Instance);
+  // A matrix takes one location per column
+  for (GLuint column = 0; column < 4; ++column) {
+    vao.specify_attribute(
+        6 + column, 4, GL_FLOAT, GL_FALSE, stride,
+        (void *)(offset + offsetof(Instance, model_matrix) +
+                 column * sizeof(glm::vec4))); // Model matrix
+    vao.set_divisor(6 + column, 1);
+  }
+  for (GLuint column = 0; column < 3; ++column) {
+    vao.specify_attribute(
+        10 + column, 3, GL_FLOAT, GL_FALSE, stride,
+        (void *)(offset + offsetof(Instance, normal_matrix) +
+                 column * sizeof(glm::vec3))); // Normal matrix
+    vao.set_divisor(10 + column, 1);
+  }
+  vao.specify_attribute(13, 4, GL_FLOAT, GL_FALSE, stride,
+                        (void *)(offset + offsetof(Instance, data))); // Colour
+  vao.set_divisor(13, 1);
+
+  gl().bind_buffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceRenderer::submit(RenderQueue &queue, Program &program) {
+  for (const Batch &batch : m_batches) {
+    m_instances.insert(m_instances.end(), batch.instances.begin(),
+                       batch.instances.end());
+  }
+  if (m_instances.empty())
+    return;
+
+  std::size_t offset = m_stream.write(
+      m_instances.data(), m_instances.size() * sizeof(Instance));
+  auto base_instance = static_cast<GLuint>(offset / sizeof(Instance));
+
+  for (Batch &batch : m_batches) {
+    if (batch.instances.empty())
+      continue;
+
+    MeshVertexArray *vertex_array = batch.vertex_array;
+    if (m_base_instance) {
+      // A new storage (grown or orphaned) needs the attributes again
+      if (m_stream.get_generation() != vertex_array->attribute_generation)
+        specify_instance_attributes(*vertex_array, 0);
+    } else {
+      // The first instance moves every frame, so do the attributes
+      if (!batch.own_vertex_array) {
+        batch.own_vertex_array = std::make_unique<MeshVertexArray>();
+        batch.own_vertex_array->model = vertex_array->model;
+        batch.own_vertex_array->vao = std::make_unique<VAO>();
+        vertex_array->model->specify_attributes(
+            *batch.own_vertex_array->vao);
+      }
+      vertex_array = batch.own_vertex_array.get();
+      specify_instance_attributes(*vertex_array,
+                                  base_instance * sizeof(Instance));
+    }
+
+    const BatchKey &key = batch.key;
+    DrawPacket packet;
+    packet.program_id = program.id();
+    packet.program = &program;
+    packet.vertex_array = vertex_array->vao->get_id();
+
+    DrawPacket::Material &material = packet.material;
+    material.diffuse = key.diffuse;
+    material.specular = key.specular;
+    material.shininess = key.shininess;
+    if (!key.use_texture) {
+      material.use_color = true;
+    } else if (key.texture_array != nullptr) {
+      material.use_texture_array = true;
+      packet.texture_unit = TextureArray::texture_unit;
+      packet.texture_target = GL_TEXTURE_2D_ARRAY;
+      packet.texture = key.texture_array->get_id();
+    } else {
+      packet.texture_target = GL_TEXTURE_2D;
+      packet.texture = key.texture;
+    }
+
+    const Model::Lod &range = key.model->get_lod(key.lod);
+    packet.first = range.first;
+    packet.count = range.count;
+    packet.instance_count = static_cast<GLsizei>(batch.instances.size());
+    packet.base_instance = m_base_instance ? base_instance : 0;
+    base_instance += static_cast<GLuint>(batch.instances.size());
+
+    queue.submit(RenderPass::Opaque, batch.depth, packet);
+  }
+}
+
+namespace {
+
+// Objects sharing a one triangle model, drawn through a recording backend
+// reporting the given GL version
+struct InstancingTest {
+  RecordingGlBackend backend;
+  ScopedGlBackend scoped_backend;
+  TestModelFile model_file;
+  std::shared_ptr<const Model> model;
+  std::vector<std::unique_ptr<GameObject>> objects;
+  Program program;
+  std::optional<InstanceRenderer> renderer; // Reads the version
+  RenderQueue queue;
+  GlStateCache cache;
+  View view;
+
+  InstancingTest(GLint major_version, GLint minor_version)
+      : scoped_backend(backend), model_file("instance_renderer_test.obj"),
+        model(std::make_shared<const Model>(model_file.get_path().string())),
+        program(Program::Sources{"", ""}),
+        view(glm::mat4(1.f), glm::mat4(1.f)) {
+    backend.major_version = major_version;
+    backend.minor_version = minor_version;
+    backend.active_uniforms = {{"u_model_matrix", GL_FLOAT_MAT4},
+                               {"u_instanced", GL_BOOL}};
+    renderer.emplace();
+  }
+
+  GameObject &add_object(const glm::vec3 &color, const glm::vec3 &position) {
+    objects.push_back(std::make_unique<GameObject>(model, color));
+    objects.back()->set_position(position);
+    return *objects.back();
+  }
+
+  void render_frame() {
+    renderer->clear();
+    for (const auto &object : objects)
+      renderer->add(*object, view);
+    renderer->submit(queue, program);
+    queue.execute(cache);
+    renderer->end_frame();
+  }
+};
+
+} // namespace
+
+TEST_CASE("Objects sharing a model are drawn with one instanced draw") {
+  InstancingTest test(4, 6);
+  for (int i = 0; i < 200; ++i) {
+    test.add_object(glm::vec3(i % 2 == 0 ? 1.f : 0.f, 0.f, 0.f),
+                    glm::vec3(i, 0.f, -10.f));
+  }
+  test.render_frame(); // Points the instance attributes at the stream buffer
+  test.backend.reset();
+  test.render_frame();
+
+  // The colour is per instance, both colours share the draw
+  RecordingGlBackend &backend = test.backend;
+  CHECK(backend.errors.empty());
+  CHECK(test.renderer->get_batch_count() == 1);
+  CHECK(backend.count("draw_arrays") == 0);
+  auto draws = backend.filter("draw_arrays_instanced_base_instance");
+  REQUIRE(draws.size() == 1);
+  CHECK(draws[0].arguments[2] == 3);   // Vertices of the mesh
+  CHECK(draws[0].arguments[3] == 200); // Instances
+  // The matrices come from the instance attributes
+  CHECK(backend.count("uniform_matrix_4fv") == 0);
+}
+
+TEST_CASE("Instanced draws point the attributes at each batch before GL 4.2") {
+  InstancingTest test(4, 1);
+  // Two batches of the same model
+  for (int i = 0; i < 200; ++i) {
+    test.add_object(glm::vec3(1.f), glm::vec3(i, 0.f, -10.f))
+        .set_lighting_factors(glm::vec3(1.f), glm::vec3(1.f),
+                              i < 100 ? 1.f : 2.f);
+  }
+  test.render_frame();
+  test.backend.reset();
+  test.render_frame();
+
+  RecordingGlBackend &backend = test.backend;
+  CHECK(backend.errors.empty());
+  CHECK(test.renderer->get_batch_count() == 2);
+  CHECK(backend.count("draw_arrays_instanced_base_instance") == 0);
+  auto draws = backend.filter("draw_arrays_instanced");
+  REQUIRE(draws.size() == 2);
+  CHECK(draws[0].arguments[3] == 100);
+  CHECK(draws[1].arguments[3] == 100);
+
+  // The model matrix of the second batch starts 100 instances later
+  std::vector<long long> offsets;
+  long long stride = 0;
+  for (const auto &call : backend.filter("vertex_attrib_pointer")) {
+    if (call.arguments[0] == 6) {
+      offsets.push_back(call.arguments[4]);
+      stride = call.arguments[3];
+    }
+  }
+  REQUIRE(offsets.size() == 2);
+  CHECK(std::abs(offsets[1] - offsets[0]) == 100 * stride);
+}
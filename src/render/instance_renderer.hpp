@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include "3D_model.hpp"
+#include "game_object.hpp"
+#include "program.hpp"
+#include "render_queue.hpp"
+#include "stream_buffer.hpp"
+#include "vao.hpp"
+#include "view.hpp"
+
+// Draws the objects sharing a Model with one instanced draw per mesh, level
+// of detail, texture and lighting factors. The matrices, colour and texture
+// layer of every object are written to a StreamBuffer once per frame and
+// read through attributes advancing once per instance (locations 6 to 13,
+// see 3D.vs.glsl). Without base instance (before GL 4.2) each batch has its
+// own vertex array, its instance attributes pointing at its first instance.
+class InstanceRenderer {
+public:
+  // Instances per frame before the stream buffer grows
+  static constexpr std::size_t initial_capacity = 1024;
+
+  InstanceRenderer();
+
+  // Empêcher la copie
+  InstanceRenderer(const InstanceRenderer &) = delete;
+  InstanceRenderer &operator=(const InstanceRenderer &) = delete;
+
+  void clear();
+  // The object is drawn at its current level of detail
+  void add(const GameObject &object, const View &view);
+
+  // Upload everything added since clear() and queue one packet per batch
+  void submit(RenderQueue &queue, Program &program);
+  // Once the queue has been executed
+  void end_frame() { m_stream.end_frame(); }
+
+  std::size_t get_instance_count() const { return m_instances.size(); }
+  std::size_t get_batch_count() const { return m_batches.size(); }
+
+private:
+  struct Instance {
+    glm::mat4 model_matrix;
+    glm::mat3 normal_matrix;
+    glm::vec4 data; // rgb: colour, a: texture array layer
+  };
+
+  // Mesh attributes plus the per-instance ones, one per Model
+  struct MeshVertexArray {
+    std::shared_ptr<const Model> model; // Keeps the vertex buffer alive
+    std::unique_ptr<VAO> vao;
+    // Storage the instance attributes point to, see StreamBuffer
+    std::uint64_t attribute_generation = 0;
+  };
+
+  // State shared by the instances of a draw
+  struct BatchKey {
+    const Model *model;
+    int lod;
+    bool use_texture;
+    GLuint texture;
+    const TextureArray *texture_array;
+    glm::vec3 diffuse;
+    glm::vec3 specular;
+    float shininess;
+
+    bool operator==(const BatchKey &) const = default;
+  };
+
+  struct Batch {
+    BatchKey key;
+    MeshVertexArray *vertex_array;
+    float depth; // Nearest instance
+    std::vector<Instance> instances;
+    // Without base instance, replaces vertex_array for this batch
+    std::unique_ptr<MeshVertexArray> own_vertex_array;
+  };
+
+  std::vector<Batch> m_batches;
+  std::vector<Instance> m_instances; // Every batch, one after the other
+  std::unordered_map<const Model *, MeshVertexArray> m_vertex_arrays;
+  StreamBuffer m_stream;
+  bool m_base_instance; // glDrawArraysInstancedBaseInstance is available
+
+  static BatchKey key_of(const GameObject &object);
+  MeshVertexArray &vertex_array_of(const GameObject &object);
+  // offset: byte offset of the first instance in the stream buffer
+  void specify_instance_attributes(MeshVertexArray &vertex_array,
+                                   std::size_t offset);
+};
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// Light as read by the shaders, in view space
+struct LightData {
+  glm::vec4 position;  // w = 0 for a directional light (xyz is then -direction)
+  glm::vec4 intensity; // rgb, w unused
+};
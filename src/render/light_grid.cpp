@@ -0,0 +1,233 @@
+#include "light_grid.hpp"
+#include <algorithm>
+#include <cmath>
+#include "doctest/doctest.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include "maths/random_stream.hpp"
+
+// Must match the attenuation of tex_3D.fs.glsl
+static constexpr float attenuation_constant = 1.f;
+static constexpr float attenuation_linear = 0.1f;
+static constexpr float attenuation_quadratic = 0.01f;
+
+LightGrid::LightGrid(int tiles_x, int tiles_y, int slices)
+    : m_dimensions(tiles_x, tiles_y, slices) {}
+
+float LightGrid::light_radius(const glm::vec3 &intensity) {
+  float max_intensity = std::max({intensity.r, intensity.g, intensity.b});
+  if (max_intensity <= light_cutoff)
+    return 0.f;
+
+  // Solve intensity / (c + l.d + q.d²) = cutoff for d
+  float c = attenuation_constant - max_intensity / light_cutoff;
+  float discriminant =
+      attenuation_linear * attenuation_linear - 4.f * attenuation_quadratic * c;
+  return (-attenuation_linear + std::sqrt(discriminant)) /
+         (2.f * attenuation_quadratic);
+}
+
+float LightGrid::slice_depth(int slice) const {
+  float fraction =
+      static_cast<float>(slice) / static_cast<float>(m_dimensions.z);
+  return m_near * std::pow(m_far / m_near, fraction);
+}
+
+glm::ivec2 LightGrid::tile_of(const glm::vec2 &ndc) const {
+  glm::vec2 tile = glm::floor((ndc * 0.5f + 0.5f) *
+                              glm::vec2(m_dimensions.x, m_dimensions.y));
+  return glm::ivec2(tile);
+}
+
+int LightGrid::slice_of(float view_depth) const {
+  if (view_depth <= m_near)
+    return 0;
+  int slice = static_cast<int>(std::floor(std::log(view_depth / m_near) *
+                                          m_slice_scale));
+  return std::clamp(slice, 0, m_dimensions.z - 1);
+}
+
+glm::ivec3 LightGrid::cluster_of(const glm::vec3 &position_vs) const {
+  float depth = std::max(-position_vs.z, m_near);
+  glm::vec2 ndc(m_proj_matrix[0][0] * position_vs.x / depth,
+                m_proj_matrix[1][1] * position_vs.y / depth);
+  glm::ivec2 tile = tile_of(ndc);
+  return {std::clamp(tile.x, 0, m_dimensions.x - 1),
+          std::clamp(tile.y, 0, m_dimensions.y - 1), slice_of(depth)};
+}
+
+std::span<const std::uint32_t>
+LightGrid::lights_in_cluster(const glm::ivec3 &cluster) const {
+  const glm::uvec2 &record =
+      m_clusters[flat_index(cluster.x, cluster.y, cluster.z)];
+  return {m_light_indices.data() + record.x, record.y};
+}
+
+void LightGrid::compute_cluster_bounds(const glm::mat4 &proj_matrix) {
+  m_proj_matrix = proj_matrix;
+  m_near = proj_matrix[3][2] / (proj_matrix[2][2] - 1.f);
+  m_far = proj_matrix[3][2] / (proj_matrix[2][2] + 1.f);
+  m_slice_scale = static_cast<float>(m_dimensions.z) / std::log(m_far / m_near);
+
+  std::size_t cluster_count = static_cast<std::size_t>(m_dimensions.x) *
+                              m_dimensions.y * m_dimensions.z;
+  m_cluster_bounds.resize(cluster_count);
+  m_cluster_lights.resize(cluster_count);
+  m_clusters.resize(cluster_count);
+
+  for (int z = 0; z < m_dimensions.z; ++z) {
+    float depths[2] = {slice_depth(z), slice_depth(z + 1)};
+    for (int y = 0; y < m_dimensions.y; ++y) {
+      float ndc_y[2] = {-1.f + 2.f * y / m_dimensions.y,
+                        -1.f + 2.f * (y + 1) / m_dimensions.y};
+      for (int x = 0; x < m_dimensions.x; ++x) {
+        float ndc_x[2] = {-1.f + 2.f * x / m_dimensions.x,
+                          -1.f + 2.f * (x + 1) / m_dimensions.x};
+
+        // The cluster is a frustum slice, bound its eight corners
+        Bounds bounds{glm::vec3(INFINITY), glm::vec3(-INFINITY)};
+        for (float depth : depths) {
+          for (float nx : ndc_x) {
+            for (float ny : ndc_y) {
+              glm::vec3 corner(nx * depth / proj_matrix[0][0],
+                               ny * depth / proj_matrix[1][1], -depth);
+              bounds.min = glm::min(bounds.min, corner);
+              bounds.max = glm::max(bounds.max, corner);
+            }
+          }
+        }
+        m_cluster_bounds[flat_index(x, y, z)] = bounds;
+      }
+    }
+  }
+}
+
+void LightGrid::build(const std::vector<LightData> &lights,
+                      const glm::mat4 &proj_matrix) {
+  if (proj_matrix != m_proj_matrix)
+    compute_cluster_bounds(proj_matrix);
+
+  for (auto &cluster_lights : m_cluster_lights)
+    cluster_lights.clear();
+  m_light_indices.clear();
+
+  for (std::uint32_t i = 0; i < lights.size(); ++i) {
+    if (lights[i].position.w == 0.f)
+      m_light_indices.push_back(i);
+  }
+  m_directional_count = static_cast<int>(m_light_indices.size());
+
+  for (std::uint32_t i = 0; i < lights.size(); ++i) {
+    if (lights[i].position.w == 0.f)
+      continue;
+
+    glm::vec3 center(lights[i].position);
+    float radius = light_radius(glm::vec3(lights[i].intensity));
+    float min_depth = std::max(-center.z - radius, m_near);
+    float max_depth = std::min(-center.z + radius, m_far);
+    if (radius <= 0.f || min_depth > max_depth)
+      continue;
+
+    // Screen extent of the sphere's bounding box, x/d and y/d reach their
+    // extremes at the corners of the (coordinate, depth) rectangle
+    glm::ivec2 first_tile(m_dimensions.x, m_dimensions.y);
+    glm::ivec2 last_tile(-1);
+    for (float depth : {min_depth, max_depth}) {
+      for (float sign : {-1.f, 1.f}) {
+        glm::vec2 ndc(m_proj_matrix[0][0] * (center.x + sign * radius) / depth,
+                      m_proj_matrix[1][1] * (center.y + sign * radius) / depth);
+        glm::ivec2 tile = tile_of(ndc);
+        first_tile = glm::min(first_tile, tile);
+        last_tile = glm::max(last_tile, tile);
+      }
+    }
+    first_tile = glm::max(first_tile, glm::ivec2(0));
+    last_tile = glm::min(
+        last_tile, glm::ivec2(m_dimensions.x - 1, m_dimensions.y - 1));
+
+    int first_slice = slice_of(min_depth);
+    int last_slice = slice_of(max_depth);
+    for (int z = first_slice; z <= last_slice; ++z) {
+      for (int y = first_tile.y; y <= last_tile.y; ++y) {
+        for (int x = first_tile.x; x <= last_tile.x; ++x) {
+          int index = flat_index(x, y, z);
+          const Bounds &bounds = m_cluster_bounds[index];
+          glm::vec3 closest = glm::clamp(center, bounds.min, bounds.max);
+          glm::vec3 offset = closest - center;
+          if (glm::dot(offset, offset) <= radius * radius)
+            m_cluster_lights[index].push_back(i);
+        }
+      }
+    }
+  }
+
+  for (std::size_t index = 0; index < m_cluster_lights.size(); ++index) {
+    m_clusters[index] = glm::uvec2(m_light_indices.size(),
+                                   m_cluster_lights[index].size());
+    m_light_indices.insert(m_light_indices.end(),
+                           m_cluster_lights[index].begin(),
+                           m_cluster_lights[index].end());
+  }
+}
+
+TEST_CASE("Light radius matches the shader attenuation") {
+  glm::vec3 intensity(2.f, 1.f, 0.5f);
+  float radius = LightGrid::light_radius(intensity);
+  float attenuation =
+      1.f / (attenuation_constant + attenuation_linear * radius +
+             attenuation_quadratic * radius * radius);
+  CHECK(2.f * attenuation == doctest::Approx(LightGrid::light_cutoff));
+  CHECK(LightGrid::light_radius(glm::vec3(LightGrid::light_cutoff / 2.f)) ==
+        0.f);
+}
+
+TEST_CASE("Cluster assignment is conservative") {
+  glm::mat4 proj =
+      glm::perspective(glm::radians(90.f), 16.f / 9.f, 0.1f, 10000.f);
+
+  std::vector<LightData> lights = {
+      {{-0.5f, 1.f, 1.f, 0.f}, {1.f, 1.f, 1.f, 0.f}},    // Directional
+      {{0.f, 0.f, -50.f, 1.f}, {0.2f, 0.2f, 0.2f, 0.f}}, // Small, centered
+      {{-40.f, 10.f, -30.f, 1.f}, {1.f, 0.5f, 0.f, 0.f}},
+      {{5.f, -3.f, 4.f, 1.f}, {0.5f, 0.5f, 0.5f, 0.f}}, // Behind the camera
+  };
+
+  LightGrid grid;
+  grid.build(lights, proj);
+
+  REQUIRE(grid.get_directional_count() == 1);
+  CHECK(grid.get_light_indices()[0] == 0);
+
+  // Every visible point within range of a light must land in a cluster
+  // listing that light. Fixed seed, the same points on every run
+  RandomStream random(32);
+  for (std::uint32_t i = 1; i < lights.size(); ++i) {
+    glm::vec3 center(lights[i].position);
+    float radius = LightGrid::light_radius(glm::vec3(lights[i].intensity));
+    for (int sample = 0; sample < 2000; ++sample) {
+      glm::vec3 point = center + random.in_ball(radius);
+      if (-point.z < grid.get_near() || -point.z > grid.get_far())
+        continue;
+      glm::vec2 ndc(proj[0][0] * point.x / -point.z,
+                    proj[1][1] * point.y / -point.z);
+      if (std::abs(ndc.x) > 1.f || std::abs(ndc.y) > 1.f)
+        continue; // Off screen
+
+      auto cluster_lights = grid.lights_in_cluster(grid.cluster_of(point));
+      CHECK(std::find(cluster_lights.begin(), cluster_lights.end(), i) !=
+            cluster_lights.end());
+    }
+  }
+
+  // The small central light stays out of the corner clusters
+  auto corner_lights = grid.lights_in_cluster({0, 0, grid.slice_of(50.f)});
+  CHECK(std::find(corner_lights.begin(), corner_lights.end(), 1u) ==
+        corner_lights.end());
+
+  // Directional lights are not repeated in the clusters
+  auto center_lights =
+      grid.lights_in_cluster(grid.cluster_of({0.f, 0.f, -50.f}));
+  CHECK(std::find(center_lights.begin(), center_lights.end(), 0u) ==
+        center_lights.end());
+  CHECK(std::find(center_lights.begin(), center_lights.end(), 1u) !=
+        center_lights.end());
+}
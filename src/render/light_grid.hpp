@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+#include "light.hpp"
+
+// Clustered light culling, computed on the CPU every frame. The view frustum
+// is split into screen tiles and exponential depth slices; each cluster
+// records the point lights whose range overlaps it, so the fragment shader
+// only shades the lights of its own cluster. Directional lights affect every
+// cluster and are listed once at the start of the index list.
+class LightGrid {
+public:
+  // Contribution below which a point light is considered out of range
+  static constexpr float light_cutoff = 1.f / 64.f;
+
+  explicit LightGrid(int tiles_x = 16, int tiles_y = 9, int slices = 24);
+
+  // Assign view-space lights to the clusters of a perspective projection
+  void build(const std::vector<LightData> &lights,
+             const glm::mat4 &proj_matrix);
+
+  // Distance at which the shader attenuation brings a light under the cutoff
+  static float light_radius(const glm::vec3 &intensity);
+
+  // Cluster of a view-space position (clamped to the grid)
+  glm::ivec3 cluster_of(const glm::vec3 &position_vs) const;
+  int slice_of(float view_depth) const;
+
+  std::span<const std::uint32_t>
+  lights_in_cluster(const glm::ivec3 &cluster) const;
+
+  const glm::ivec3 &get_dimensions() const { return m_dimensions; }
+  float get_near() const { return m_near; }
+  float get_far() const { return m_far; }
+  // Scale applied to log(depth / near) to get a slice index
+  float get_slice_scale() const { return m_slice_scale; }
+
+  // GPU payload: (offset, count) into the index list for every cluster, and
+  // the index list itself (directional lights first)
+  const std::vector<glm::uvec2> &get_clusters() const { return m_clusters; }
+  const std::vector<std::uint32_t> &get_light_indices() const {
+    return m_light_indices;
+  }
+  int get_directional_count() const { return m_directional_count; }
+
+private:
+  struct Bounds {
+    glm::vec3 min;
+    glm::vec3 max;
+  };
+
+  glm::ivec3 m_dimensions;
+  glm::mat4 m_proj_matrix{0.f};
+  float m_near = 0.1f;
+  float m_far = 1.f;
+  float m_slice_scale = 1.f;
+
+  std::vector<Bounds> m_cluster_bounds; // View space, per projection
+  std::vector<glm::uvec2> m_clusters;
+  std::vector<std::uint32_t> m_light_indices;
+  int m_directional_count = 0;
+
+  // Per-cluster light lists before compaction, reused between frames
+  std::vector<std::vector<std::uint32_t>> m_cluster_lights;
+
+  int flat_index(int x, int y, int z) const {
+    return (z * m_dimensions.y + y) * m_dimensions.x + x;
+  }
+  float slice_depth(int slice) const;
+  // Tile under a point in normalized device coordinates, not clamped
+  glm::ivec2 tile_of(const glm::vec2 &ndc) const;
+  void compute_cluster_bounds(const glm::mat4 &proj_matrix);
+};
@@ -0,0 +1,41 @@
+#include "light_manager.hpp"
+#include "../scene_objects/particle.hpp"
+
+void LightManager::add_flash(const glm::vec3 &position, const glm::vec3 &color,
+                             float lifespan) {
+  std::size_t slot = m_flash_count;
+  if (m_flash_count == flash_capacity) {
+    slot = 0;
+    for (std::size_t i = 1; i < m_flash_count; ++i) {
+      if (m_flashes[i].lifespan < m_flashes[slot].lifespan)
+        slot = i;
+    }
+  } else {
+    ++m_flash_count;
+  }
+  m_flashes[slot] = {position, color, lifespan, lifespan};
+}
+
+void LightManager::update() {
+  for (std::size_t i = 0; i < m_flash_count;) {
+    m_flashes[i].lifespan -= Particle::lifespan_decay;
+    if (m_flashes[i].lifespan <= 0.f) {
+      // Swap with the last flash, the order does not matter
+      m_flashes[i] = m_flashes[--m_flash_count];
+    } else {
+      ++i;
+    }
+  }
+}
+
+void LightManager::append_lights(const glm::mat4 &view_matrix,
+                                 std::vector<LightData> &lights) const {
+  for (std::size_t i = 0; i < m_flash_count; ++i) {
+    const Flash &flash = m_flashes[i];
+    // Quadratic fade: a bright burst that dies out quickly
+    float fade = flash.lifespan / flash.max_lifespan;
+    lights.push_back({view_matrix * glm::vec4(flash.position, 1.f),
+                      glm::vec4(flash.color * flash_intensity * fade * fade,
+                                0.f)});
+  }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+#include "light.hpp"
+
+// Transient point lights (firework flashes) kept in a fixed-capacity pool:
+// adding, fading and gathering the flashes never allocates. Once the pool is
+// full, a new flash replaces the most faded one.
+class LightManager {
+public:
+  static constexpr std::size_t flash_capacity = 512;
+  static constexpr float flash_intensity = 8.f; // Peak intensity of a flash
+
+  // World-space flash, fading out over lifespan (same units as Particle)
+  void add_flash(const glm::vec3 &position, const glm::vec3 &color,
+                 float lifespan = 255.f);
+
+  // Fade the flashes by one frame and drop the dead ones
+  void update();
+
+  // Append the live flashes to a light list, in view space
+  void append_lights(const glm::mat4 &view_matrix,
+                     std::vector<LightData> &lights) const;
+
+  std::size_t get_flash_count() const { return m_flash_count; }
+
+private:
+  struct Flash {
+    glm::vec3 position;
+    glm::vec3 color;
+    float lifespan;
+    float max_lifespan;
+  };
+
+  std::array<Flash, flash_capacity> m_flashes{};
+  std::size_t m_flash_count = 0;
+};
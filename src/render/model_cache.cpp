@@ -0,0 +1,83 @@
+#include "model_cache.hpp"
+#include <filesystem>
+#include "doctest/doctest.h"
+#include "recording_gl_backend.hpp"
+#include "test_model_file.hpp"
+
+std::string ModelCache::key_for(const std::string &file_path) {
+  std::error_code error;
+  std::filesystem::path path =
+      std::filesystem::weakly_canonical(file_path, error);
+  if (error)
+    return std::filesystem::path(file_path).lexically_normal().string();
+  return path.string();
+}
+
+std::shared_ptr<const Model> ModelCache::load(const std::string &file_path) {
+  std::shared_ptr<const Model> &model = m_models[key_for(file_path)];
+  if (model) {
+    ++m_hits;
+    return model;
+  }
+
+  ++m_misses;
+  model = std::make_shared<const Model>(file_path);
+  return model;
+}
+
+std::shared_ptr<const Model>
+ModelCache::find(const std::string &file_path) const {
+  auto model = m_models.find(key_for(file_path));
+  return model != m_models.end() ? model->second : nullptr;
+}
+
+std::size_t ModelCache::purge() {
+  return std::erase_if(m_models, [](const auto &entry) {
+    return entry.second.use_count() == 1;
+  });
+}
+
+ModelCache::Stats ModelCache::get_stats() const {
+  Stats stats;
+  stats.model_count = m_models.size();
+  stats.hits = m_hits;
+  stats.misses = m_misses;
+  for (const auto &[path, model] : m_models) {
+    const std::vector<float> &vertices = model->get_vertex_data();
+    stats.cpu_bytes += vertices.capacity() * sizeof(float);
+    stats.gpu_bytes += vertices.size() * sizeof(float);
+  }
+  return stats;
+}
+
+TEST_CASE("Model cache loads a file once and purges unused models") {
+  RecordingGlBackend backend;
+  ScopedGlBackend scoped_backend(backend);
+
+  TestModelFile model_file("model_cache_test.obj");
+  const std::filesystem::path &model_path = model_file.get_path();
+  const std::filesystem::path directory = model_path.parent_path();
+
+  ModelCache cache;
+  auto model = cache.load(model_path.string());
+  // Another spelling of the same file
+  auto same = cache.load((directory / "." / "model_cache_test.obj").string());
+  CHECK(model == same);
+  CHECK(cache.find(model_path.string()) == model);
+  CHECK(backend.count("gen_vertex_array") == 1);
+
+  ModelCache::Stats stats = cache.get_stats();
+  CHECK(stats.model_count == 1);
+  CHECK(stats.hits == 1);
+  CHECK(stats.misses == 1);
+  CHECK(stats.gpu_bytes == 3 * 8 * sizeof(float));
+
+  // Still referenced
+  CHECK(cache.purge() == 0);
+  model.reset();
+  same.reset();
+  CHECK(cache.purge() == 1);
+  CHECK(cache.find(model_path.string()) == nullptr);
+  CHECK(cache.get_stats().gpu_bytes == 0);
+  CHECK(backend.count("delete_vertex_array") == 1);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "3D_model.hpp"
+
+// Meshes loaded once per file and shared by every object drawing them. The
+// cache keeps a reference to each Model, so it stays loaded after its last
+// object is gone until purge() is called. Must be destroyed while the GL
+// context is alive.
+class ModelCache {
+public:
+  struct Stats {
+    std::size_t model_count = 0;
+    std::size_t cpu_bytes = 0; // Vertex data kept for static batching
+    std::size_t gpu_bytes = 0; // Vertex buffers
+    std::size_t hits = 0;      // Loads served without parsing a file
+    std::size_t misses = 0;
+  };
+
+  ModelCache() = default;
+
+  // Empêcher la copie
+  ModelCache(const ModelCache &) = delete;
+  ModelCache &operator=(const ModelCache &) = delete;
+
+  // Parse the file on the first request, the other paths to the same file
+  // return the same Model
+  std::shared_ptr<const Model> load(const std::string &file_path);
+  // Model already loaded from the file, nullptr if none
+  std::shared_ptr<const Model> find(const std::string &file_path) const;
+
+  // Unload the models only the cache references, returns how many
+  std::size_t purge();
+
+  Stats get_stats() const;
+
+private:
+  std::unordered_map<std::string, std::shared_ptr<const Model>> m_models;
+  std::size_t m_hits = 0;
+  std::size_t m_misses = 0;
+
+  // Same key for every spelling of a path
+  static std::string key_for(const std::string &file_path);
+};
@@ -0,0 +1,149 @@
+#include "particle_renderer.hpp"
+#include <algorithm>
+#include <cmath>
+#include "doctest/doctest.h"
+#include "gl_state_cache.hpp"
+#include "recording_gl_backend.hpp"
+#include "scene_objects/firework_simulation.hpp"
+
+ParticleRenderer::ParticleRenderer()
+    : m_stream(GL_ARRAY_BUFFER, initial_capacity * sizeof(Vertex),
+               sizeof(Vertex)) {}
+
+void ParticleRenderer::specify_attributes() {
+  m_attribute_generation = m_stream.get_generation();
+  gl().bind_buffer(GL_ARRAY_BUFFER, m_stream.get_id());
+  constexpr int stride = sizeof(Vertex);
+  m_vao.specify_attribute(0, 3, GL_FLOAT, GL_FALSE, stride,
+                          (void *)offsetof(Vertex, position)); // Position
+  m_vao.specify_attribute(4, 3, GL_FLOAT, GL_FALSE, stride,
+                          (void *)offsetof(Vertex, color)); // Particle color
+  m_vao.specify_attribute(5, 4, GL_FLOAT, GL_FALSE, stride,
+                          (void *)offsetof(Vertex, data)); // Particle data
+  gl().bind_buffer(GL_ARRAY_BUFFER, 0);
+}
+
+ParticleRenderer::Lod ParticleRenderer::lod_for(float distance) {
+  Lod lod;
+  lod.stride = std::clamp(static_cast<int>(distance / lod_distance), 1,
+                          max_lod_stride);
+  // Sprite area grows with the stride up to max_size_scale, alpha makes up
+  // for the rest
+  lod.size_scale =
+      std::min(std::sqrt(static_cast<float>(lod.stride)), max_size_scale);
+  lod.alpha_scale =
+      static_cast<float>(lod.stride) / (lod.size_scale * lod.size_scale);
+  return lod;
+}
+
+void ParticleRenderer::add(const Particle &particle, float size_scale,
+                           float alpha_scale) {
+  m_vertices.push_back({particle.location, particle.m_color,
+                        glm::vec4(particle.lifespan, size_scale, alpha_scale,
+                                  particle.seed ? 1.f : 0.f)});
+}
+
+void ParticleRenderer::submit(RenderQueue &queue, Program &program) {
+  if (m_vertices.empty())
+    return;
+
+  std::size_t offset =
+      m_stream.write(m_vertices.data(), m_vertices.size() * sizeof(Vertex));
+  // A new storage (grown or orphaned) needs the attributes again
+  if (m_stream.get_generation() != m_attribute_generation)
+    specify_attributes();
+
+  DrawPacket packet;
+  packet.program_id = program.id();
+  packet.program = &program;
+  packet.vertex_array = m_vao.get_id();
+  packet.model_matrix = &m_model_matrix;
+  packet.material.is_particle = true;
+  packet.mode = GL_POINTS;
+  packet.first = static_cast<GLint>(offset / sizeof(Vertex));
+  packet.count = static_cast<GLsizei>(m_vertices.size());
+
+  // Points are not sorted among themselves, the packet depth only orders it
+  // against other transparent packets
+  queue.submit(RenderPass::Transparent, 0.f, packet);
+}
+
+TEST_CASE("A frame of 85 fireworks stays within the GL call budget") {
+  RecordingGlBackend backend;
+  backend.active_uniforms = {{"u_model_matrix", GL_FLOAT_MAT4},
+                             {"u_is_particle", GL_BOOL}};
+  ScopedGlBackend scoped_backend(backend);
+
+  Program program(Program::Sources{"", ""});
+  ParticleRenderer renderer;
+  RenderQueue queue;
+  GlStateCache cache;
+
+  // One shell per tick. Every shell explodes within 81 ticks and its sparks
+  // live 102 ticks: after 85 ticks, shells and bursts are mixed
+  FireworkEmitter emitter;
+  emitter.spawn_chance = 1.f;
+  FireworkSimulation simulation({emitter}, 7, false);
+  const FireworkSimulation::Snapshot *snapshot = nullptr;
+  for (int tick = 0; tick < 85; ++tick)
+    snapshot = &simulation.next_frame();
+  REQUIRE(snapshot->bursts.size() == 85);
+
+  auto render_frame = [&]() {
+    renderer.clear();
+    for (const FireworkSimulation::Snapshot::Burst &burst : snapshot->bursts)
+      snapshot->draw(burst, renderer, glm::vec3(0.f));
+    renderer.submit(queue, program);
+    queue.execute(cache);
+    renderer.end_frame();
+  };
+  render_frame(); // Points the vertex attributes at the stream buffer
+  backend.reset();
+  render_frame();
+
+  constexpr std::size_t max_calls_per_frame = 12;
+  CHECK(backend.errors.empty());
+  CHECK(backend.count("draw_arrays") == 1);
+  CHECK(backend.get_call_count() <= max_calls_per_frame);
+  CHECK(renderer.get_particle_count() > 85); // Sparks included
+  // The particles go through the persistent mapping, without upload calls
+  // nor waits on the GPU
+  CHECK(backend.uploaded_bytes == 0);
+  CHECK(backend.count("map_buffer_range") == 0);
+  CHECK(backend.count("client_wait_sync") == 0);
+  CHECK(backend.count("fence_sync") == 1);
+}
+
+TEST_CASE("Particle attributes follow the stream buffer when it grows") {
+  RecordingGlBackend backend;
+  backend.active_uniforms = {{"u_model_matrix", GL_FLOAT_MAT4},
+                             {"u_is_particle", GL_BOOL}};
+  backend.reuse_buffer_names = true;
+  ScopedGlBackend scoped_backend(backend);
+
+  Program program(Program::Sources{"", ""});
+  ParticleRenderer renderer;
+  RenderQueue queue;
+  GlStateCache cache;
+  RandomStream random(40);
+  const Particle particle(0.f, 0.f, -10.f, glm::vec3(1.f), random);
+
+  auto render_frame = [&](std::size_t particle_count) {
+    renderer.clear();
+    for (std::size_t i = 0; i < particle_count; ++i)
+      renderer.add(particle);
+    renderer.submit(queue, program);
+    queue.execute(cache);
+    renderer.end_frame();
+  };
+  render_frame(10);
+  auto first_buffer = backend.filter("gen_buffer").back().arguments[0];
+  backend.reset();
+
+  // The new storage gets the name of the deleted one
+  render_frame(ParticleRenderer::initial_capacity + 1);
+  REQUIRE(backend.count("gen_buffer") == 1);
+  CHECK(backend.filter("gen_buffer")[0].arguments[0] == first_buffer);
+  CHECK(backend.count("vertex_attrib_pointer") == 3);
+  CHECK(backend.errors.empty());
+}
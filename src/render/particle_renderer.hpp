@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "program.hpp"
+#include "render_queue.hpp"
+#include "scene_objects/particle.hpp"
+#include "vao.hpp"
+#include "stream_buffer.hpp"
+
+// Collects the visible particles of a frame and draws them as GL_POINTS with
+// a single write to a persistently mapped StreamBuffer and a single draw
+// call. Colour, lifespan and sprite scale are per-vertex attributes instead
+// of per-particle uniforms.
+class ParticleRenderer {
+public:
+  // Subset of a burst drawn at a given distance
+  struct Lod {
+    int stride = 1;          // Draw one particle out of stride
+    float size_scale = 1.f;  // Bigger sprites...
+    float alpha_scale = 1.f; // ...and more opacity to cover the same area
+  };
+
+  static constexpr float lod_distance = 150.f; // Full detail below
+  static constexpr int max_lod_stride = 8;
+  static constexpr float max_size_scale = 2.f;
+  // Particles per frame before the stream buffer grows
+  static constexpr std::size_t initial_capacity = 16384;
+
+  ParticleRenderer();
+
+  // Empêcher la copie
+  ParticleRenderer(const ParticleRenderer &) = delete;
+  ParticleRenderer &operator=(const ParticleRenderer &) = delete;
+
+  static Lod lod_for(float distance);
+
+  void clear() { m_vertices.clear(); }
+  void add(const Particle &particle, float size_scale = 1.f,
+           float alpha_scale = 1.f);
+
+  // Upload everything added since clear() and queue it as one transparent
+  // packet
+  void submit(RenderQueue &queue, Program &program);
+  // Once the queue has been executed
+  void end_frame() { m_stream.end_frame(); }
+
+  std::size_t get_particle_count() const { return m_vertices.size(); }
+
+private:
+  struct Vertex {
+    glm::vec3 position; // World space
+    glm::vec3 color;
+    glm::vec4 data; // lifespan, size scale, alpha scale, seed
+  };
+
+  std::vector<Vertex> m_vertices;
+  glm::mat4 m_model_matrix{1.f}; // Already in world space
+  VAO m_vao;
+  StreamBuffer m_stream;
+  std::uint64_t m_attribute_generation = 0; // Storage the attributes point to
+
+  void specify_attributes();
+};
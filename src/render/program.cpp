@@ -1,6 +1,173 @@
 #include "program.hpp"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
 
-void Program::use() const
-{
-    m_program.use();
+namespace {
+
+std::string read_file(const std::filesystem::path &path) {
+  std::ifstream file(path);
+  if (!file) {
+    std::cerr << "Could not open shader " << path << std::endl;
+    return "";
+  }
+  std::stringstream content;
+  content << file.rdbuf();
+  return content.str();
+}
+
+GLuint compile_shader(GLenum type, const std::string &source) {
+  GLuint shader = gl().create_shader(type);
+  gl().shader_source(shader, source);
+  gl().compile_shader(shader);
+  if (gl().get_shader_i(shader, GL_COMPILE_STATUS) != GL_TRUE) {
+    std::cerr << "Shader compilation failed:\n"
+              << gl().get_shader_info_log(shader) << std::endl;
+  }
+  return shader;
+}
+
+} // namespace
+
+Program::Program(const std::filesystem::path &vertex_shader_path,
+                 const std::filesystem::path &fragment_shader_path)
+    : Program(Sources{read_file(vertex_shader_path),
+                      read_file(fragment_shader_path)}) {}
+
+Program::Program(const Sources &sources) {
+  compile(sources);
+  reflect();
+}
+
+Program::~Program() { gl().delete_program(m_id); }
+
+void Program::use() const { gl().use_program(m_id); }
+
+void Program::compile(const Sources &sources) {
+  GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER, sources.vertex);
+  GLuint fragment_shader =
+      compile_shader(GL_FRAGMENT_SHADER, sources.fragment);
+
+  m_id = gl().create_program();
+  gl().attach_shader(m_id, vertex_shader);
+  gl().attach_shader(m_id, fragment_shader);
+  gl().link_program(m_id);
+  if (gl().get_program_i(m_id, GL_LINK_STATUS) != GL_TRUE) {
+    std::cerr << "Program link failed:\n"
+              << gl().get_program_info_log(m_id) << std::endl;
+  }
+
+  // The program keeps the compiled code
+  gl().delete_shader(vertex_shader);
+  gl().delete_shader(fragment_shader);
+}
+
+void Program::reflect() {
+  GLint uniform_count = gl().get_program_i(m_id, GL_ACTIVE_UNIFORMS);
+  for (GLint i = 0; i < uniform_count; ++i) {
+    GLint size = 0;
+    GLenum type = 0;
+    std::string uniform_name =
+        gl().get_active_uniform(m_id, static_cast<GLuint>(i), size, type);
+
+    // Arrays of basic types are reported once as "name[0]", register every
+    // element as well as the bare name
+    std::string base_name = uniform_name;
+    if (base_name.ends_with("[0]"))
+      base_name.resize(base_name.size() - 3);
+
+    for (GLint element = 0; element < size; ++element) {
+      std::string element_name =
+          size > 1 ? base_name + "[" + std::to_string(element) + "]"
+                   : uniform_name;
+      GLint location = gl().get_uniform_location(m_id, element_name.c_str());
+      if (location < 0)
+        continue; // Uniform blocks members have no location
+
+      m_uniform_indices[ShaderName::fnv1a(element_name)] = m_uniforms.size();
+      if (element == 0)
+        m_uniform_indices[ShaderName::fnv1a(base_name)] = m_uniforms.size();
+      m_uniforms.push_back({location, type});
+    }
+  }
+
+  GLint attribute_count = gl().get_program_i(m_id, GL_ACTIVE_ATTRIBUTES);
+  for (GLint i = 0; i < attribute_count; ++i) {
+    GLint size = 0;
+    GLenum type = 0;
+    std::string name =
+        gl().get_active_attrib(m_id, static_cast<GLuint>(i), size, type);
+    m_attribute_locations[ShaderName::fnv1a(name)] =
+        gl().get_attrib_location(m_id, name.c_str());
+  }
+}
+
+void Program::bind_uniform_block(const char *block_name, GLuint binding) const {
+  GLuint block_index = gl().get_uniform_block_index(m_id, block_name);
+  if (block_index != GL_INVALID_INDEX)
+    gl().uniform_block_binding(m_id, block_index, binding);
+}
+
+GLint Program::uniform_location(ShaderName name) const {
+  auto it = m_uniform_indices.find(name.hash);
+  return it == m_uniform_indices.end() ? -1 : m_uniforms[it->second].location;
+}
+
+GLint Program::attribute_location(ShaderName name) const {
+  auto it = m_attribute_locations.find(name.hash);
+  return it == m_attribute_locations.end() ? -1 : it->second;
+}
+
+Program::Uniform *Program::changed_uniform(ShaderName name, const void *value,
+                                           std::size_t size) {
+  auto it = m_uniform_indices.find(name.hash);
+  if (it == m_uniform_indices.end())
+    return nullptr; // Not active, optimized out by the compiler
+
+  Uniform &uniform = m_uniforms[it->second];
+  if (uniform.has_value &&
+      std::memcmp(uniform.value.data(), value, size) == 0) {
+    ++m_skipped_count;
+    return nullptr;
+  }
+
+  std::memcpy(uniform.value.data(), value, size);
+  uniform.has_value = true;
+  ++m_upload_count;
+  return &uniform;
+}
+
+void Program::set_uniform(ShaderName name, int value) {
+  if (Uniform *uniform = changed_uniform(name, &value, sizeof(value)))
+    gl().uniform_1i(uniform->location, value);
+}
+
+void Program::set_uniform(ShaderName name, float value) {
+  if (Uniform *uniform = changed_uniform(name, &value, sizeof(value)))
+    gl().uniform_1f(uniform->location, value);
+}
+
+void Program::set_uniform(ShaderName name, const glm::vec3 &value) {
+  if (Uniform *uniform =
+          changed_uniform(name, glm::value_ptr(value), sizeof(float) * 3))
+    gl().uniform_3fv(uniform->location, glm::value_ptr(value));
+}
+
+void Program::set_uniform(ShaderName name, const glm::vec4 &value) {
+  if (Uniform *uniform =
+          changed_uniform(name, glm::value_ptr(value), sizeof(float) * 4))
+    gl().uniform_4fv(uniform->location, glm::value_ptr(value));
+}
+
+void Program::set_uniform(ShaderName name, const glm::mat3 &value) {
+  if (Uniform *uniform =
+          changed_uniform(name, glm::value_ptr(value), sizeof(float) * 9))
+    gl().uniform_matrix_3fv(uniform->location, glm::value_ptr(value));
+}
+
+void Program::set_uniform(ShaderName name, const glm::mat4 &value) {
+  if (Uniform *uniform =
+          changed_uniform(name, glm::value_ptr(value), sizeof(float) * 16))
+    gl().uniform_matrix_4fv(uniform->location, glm::value_ptr(value));
 }
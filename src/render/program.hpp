@@ -1,88 +1,107 @@
 #pragma once
-// #include "game_object.hpp"
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "gl_backend.hpp"
 #include "glm/gtc/type_ptr.hpp"
-#include "p6/p6.h"
 
+// Name of a uniform or attribute, reduced to its FNV-1a hash. String literals
+// are hashed at compile time, so looking a uniform up costs one integer hash.
+struct ShaderName {
+  std::uint64_t hash;
+
+  consteval ShaderName(const char *name) : hash(fnv1a(name)) {}
+
+  // For names built at runtime ("u_lights[3].position")
+  static ShaderName runtime(std::string_view name) {
+    return ShaderName(fnv1a(name), 0);
+  }
+
+  static constexpr std::uint64_t fnv1a(std::string_view name) {
+    std::uint64_t hash = 14695981039346656037ull;
+    for (char c : name) {
+      hash ^= static_cast<unsigned char>(c);
+      hash *= 1099511628211ull;
+    }
+    return hash;
+  }
+
+private:
+  constexpr ShaderName(std::uint64_t h, int) : hash(h) {}
+};
+
+// Linked shader program, compiled through the current GlBackend. Active
+// uniforms and attributes are reflected at link time into hashed name ->
+// location tables, and the typed setters remember the last value sent to
+// each uniform so redundant uploads are skipped.
 class Program {
 public:
-  p6::Shader m_program;
-
-  GLint u_MVP_matrix;
-  GLint u_MV_matrix;
-  GLint u_normal_matrix;
-
-  GLint u_texture;
-  GLint u_color;
-  GLint u_use_color;
-
-  GLint u_is_particle;
-  GLint u_is_seed;
-  GLint u_lifespan;
-
-  GLint u_kd;
-  GLint u_ks;
-  GLint u_shininess;
-
-  GLint u_light_pos_vs_0;
-  GLint u_light_intensity_0;
-  GLint u_light_pos_vs_1;
-  GLint u_light_intensity_1;
-  GLint u_light_pos_vs_2;
-  GLint u_light_intensity_2;
-  GLint u_light_pos_vs_3;
-  GLint u_light_intensity_3;
-  GLint u_light_pos_vs_4;
-  GLint u_light_intensity_4;
-  GLint u_light_pos_vs_5;
-  GLint u_light_intensity_5;
-
-  Program()
-      : m_program{p6::load_shader("../src/shaders/3D.vs.glsl",
-                                  "../src/shaders/tex_3D.fs.glsl")},
-        u_MVP_matrix(glGetUniformLocation(m_program.id(), "u_MVP_matrix")),
-        u_MV_matrix(glGetUniformLocation(m_program.id(), "u_MV_matrix")),
-        u_normal_matrix(
-            glGetUniformLocation(m_program.id(), "u_normal_matrix")),
-        u_texture(glGetUniformLocation(m_program.id(), "u_texture")),
-        u_color(glGetUniformLocation(m_program.id(), "u_color")),
-        u_use_color(glGetUniformLocation(m_program.id(), "u_use_color")),
-        u_is_particle(glGetUniformLocation(m_program.id(), "u_is_particle")),
-        u_is_seed(glGetUniformLocation(m_program.id(), "u_is_seed")),
-        u_lifespan(glGetUniformLocation(m_program.id(), "u_lifespan")),
-        u_kd(glGetUniformLocation(m_program.id(), "u_kd")),
-        u_ks(glGetUniformLocation(m_program.id(), "u_ks")),
-        u_shininess(glGetUniformLocation(m_program.id(), "u_shininess")),
-        u_light_pos_vs_0(
-            glGetUniformLocation(m_program.id(), "u_lights[0].position")),
-        u_light_intensity_0(
-            glGetUniformLocation(m_program.id(), "u_lights[0].intensity")),
-
-        u_light_pos_vs_1(
-            glGetUniformLocation(m_program.id(), "u_lights[1].position")),
-        u_light_intensity_1(
-            glGetUniformLocation(m_program.id(), "u_lights[1].intensity")),
-
-        u_light_pos_vs_2(
-            glGetUniformLocation(m_program.id(), "u_lights[2].position")),
-        u_light_intensity_2(
-            glGetUniformLocation(m_program.id(), "u_lights[2].intensity")),
-
-        u_light_pos_vs_3(
-            glGetUniformLocation(m_program.id(), "u_lights[3].position")),
-        u_light_intensity_3(
-            glGetUniformLocation(m_program.id(), "u_lights[3].intensity")),
-
-        u_light_pos_vs_4(
-            glGetUniformLocation(m_program.id(), "u_lights[4].position")),
-        u_light_intensity_4(
-            glGetUniformLocation(m_program.id(), "u_lights[4].intensity")),
-
-        u_light_pos_vs_5(
-            glGetUniformLocation(m_program.id(), "u_lights[5].position")),
-        u_light_intensity_5(
-            glGetUniformLocation(m_program.id(), "u_lights[5].intensity"))
-
-  {}
+  // GLSL code of both stages, for programs not read from files
+  struct Sources {
+    std::string vertex;
+    std::string fragment;
+  };
+
+  explicit Program(
+      const std::filesystem::path &vertex_shader_path =
+          "../src/shaders/3D.vs.glsl",
+      const std::filesystem::path &fragment_shader_path =
+          "../src/shaders/tex_3D.fs.glsl");
+  explicit Program(const Sources &sources);
+  ~Program();
+
+  // Empêcher la copie
+  Program(const Program &) = delete;
+  Program &operator=(const Program &) = delete;
 
   void use() const;
+  GLuint id() const { return m_id; }
+
+  // Attach a uniform block of the program to a buffer binding point
+  void bind_uniform_block(const char *block_name, GLuint binding) const;
+
+  // -1 when the name is not an active uniform/attribute of the program
+  GLint uniform_location(ShaderName name) const;
+  GLint attribute_location(ShaderName name) const;
+
+  // The program must be in use
+  void set_uniform(ShaderName name, int value);
+  void set_uniform(ShaderName name, float value);
+  void set_uniform(ShaderName name, const glm::vec3 &value);
+  void set_uniform(ShaderName name, const glm::vec4 &value);
+  void set_uniform(ShaderName name, const glm::mat3 &value);
+  void set_uniform(ShaderName name, const glm::mat4 &value);
+
+  // Uploads actually issued / skipped because the value was already set
+  std::size_t get_upload_count() const { return m_upload_count; }
+  std::size_t get_skipped_upload_count() const { return m_skipped_count; }
+
+private:
+  struct Uniform {
+    GLint location;
+    GLenum type;
+    bool has_value = false;
+    std::array<float, 16> value{}; // Last uploaded value (ints are bit-cast)
+  };
+
+  GLuint m_id = 0;
+  std::vector<Uniform> m_uniforms;
+  std::unordered_map<std::uint64_t, std::size_t> m_uniform_indices;
+  std::unordered_map<std::uint64_t, GLint> m_attribute_locations;
+
+  std::size_t m_upload_count = 0;
+  std::size_t m_skipped_count = 0;
+
+  void compile(const Sources &sources);
+  void reflect();
+
+  // Returns the uniform if the value differs from the cached one, after
+  // updating the cache
+  Uniform *changed_uniform(ShaderName name, const void *value,
+                           std::size_t size);
 };
@@ -0,0 +1,812 @@
+#include "recording_gl_backend.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include "doctest/doctest.h"
+
+namespace {
+
+// Size of one pixel of an uncompressed upload or read
+std::size_t pixel_size(GLenum format, GLenum type) {
+  std::size_t components = 4;
+  switch (format) {
+  case GL_RED:
+    components = 1;
+    break;
+  case GL_RG:
+    components = 2;
+    break;
+  case GL_RGB:
+    components = 3;
+    break;
+  default:
+    break;
+  }
+  return components * (type == GL_FLOAT ? 4 : 1);
+}
+
+} // namespace
+
+void RecordingGlBackend::reset() {
+  calls.clear();
+  uploaded_bytes = 0;
+}
+
+long RecordingGlBackend::count(const std::string &function) const {
+  return std::count_if(calls.begin(), calls.end(), [&](const Call &call) {
+    return call.function == function;
+  });
+}
+
+std::vector<RecordingGlBackend::Call>
+RecordingGlBackend::filter(const std::string &function) const {
+  std::vector<Call> result;
+  std::copy_if(calls.begin(), calls.end(), std::back_inserter(result),
+               [&](const Call &call) { return call.function == function; });
+  return result;
+}
+
+void RecordingGlBackend::record(const char *function,
+                                std::vector<long long> arguments) {
+  calls.push_back({function, std::move(arguments)});
+}
+
+void RecordingGlBackend::error(const std::string &message) {
+  errors.push_back(message);
+}
+
+GLuint RecordingGlBackend::bound_buffer(const char *function, GLenum target) {
+  auto it = m_bound_buffers.find(target);
+  if (it == m_bound_buffers.end() || it->second == 0) {
+    error(std::string(function) + ": no buffer bound to the target");
+    return 0;
+  }
+  return it->second;
+}
+
+void RecordingGlBackend::check_draw(const char *function) {
+  if (m_program == 0)
+    error(std::string(function) + ": no program in use");
+  if (m_vertex_array == 0)
+    error(std::string(function) + ": no vertex array bound");
+}
+
+void RecordingGlBackend::check_uniform(const char *function) {
+  if (m_program == 0)
+    error(std::string(function) + ": no program in use");
+}
+
+void RecordingGlBackend::use_program(GLuint program) {
+  record("use_program", {program});
+  if (program != 0 && !m_programs.contains(program))
+    error("use_program: unknown program " + std::to_string(program));
+  m_program = program;
+}
+
+void RecordingGlBackend::bind_vertex_array(GLuint vertex_array) {
+  record("bind_vertex_array", {vertex_array});
+  if (vertex_array != 0 && !m_vertex_arrays.contains(vertex_array))
+    error("bind_vertex_array: unknown vertex array " +
+          std::to_string(vertex_array));
+  m_vertex_array = vertex_array;
+}
+
+void RecordingGlBackend::bind_buffer(GLenum target, GLuint buffer) {
+  record("bind_buffer", {target, buffer});
+  if (buffer != 0 && !m_buffers.contains(buffer))
+    error("bind_buffer: unknown buffer " + std::to_string(buffer));
+  m_bound_buffers[target] = buffer;
+}
+
+void RecordingGlBackend::bind_buffer_base(GLenum target, GLuint index,
+                                          GLuint buffer) {
+  record("bind_buffer_base", {target, index, buffer});
+  if (buffer != 0 && !m_buffers.contains(buffer))
+    error("bind_buffer_base: unknown buffer " + std::to_string(buffer));
+  m_bound_buffers[target] = buffer;
+}
+
+void RecordingGlBackend::active_texture(GLenum unit) {
+  record("active_texture", {unit});
+  if (unit < GL_TEXTURE0)
+    error("active_texture: not a texture unit");
+}
+
+void RecordingGlBackend::bind_texture(GLenum target, GLuint texture) {
+  record("bind_texture", {target, texture});
+  if (texture != 0 && !m_textures.contains(texture))
+    error("bind_texture: unknown texture " + std::to_string(texture));
+}
+
+GLuint RecordingGlBackend::gen_vertex_array() {
+  GLuint name = m_next_name++;
+  record("gen_vertex_array", {name});
+  m_vertex_arrays.insert(name);
+  return name;
+}
+
+void RecordingGlBackend::delete_vertex_array(GLuint vertex_array) {
+  record("delete_vertex_array", {vertex_array});
+  if (vertex_array != 0 && m_vertex_arrays.erase(vertex_array) == 0)
+    error("delete_vertex_array: unknown vertex array");
+  if (m_vertex_array == vertex_array)
+    m_vertex_array = 0;
+}
+
+GLuint RecordingGlBackend::gen_buffer() {
+  GLuint name = 0;
+  if (reuse_buffer_names && !m_deleted_buffers.empty()) {
+    name = m_deleted_buffers.back();
+    m_deleted_buffers.pop_back();
+  } else {
+    name = m_next_name++;
+  }
+  record("gen_buffer", {name});
+  m_buffers[name] = {};
+  return name;
+}
+
+void RecordingGlBackend::delete_buffer(GLuint buffer) {
+  record("delete_buffer", {buffer});
+  if (buffer != 0 && m_buffers.erase(buffer) == 0)
+    error("delete_buffer: unknown buffer");
+  else if (buffer != 0)
+    m_deleted_buffers.push_back(buffer);
+  for (auto &[target, bound] : m_bound_buffers) {
+    if (bound == buffer)
+      bound = 0;
+  }
+}
+
+GLuint RecordingGlBackend::gen_texture() {
+  GLuint name = m_next_name++;
+  record("gen_texture", {name});
+  m_textures.insert(name);
+  return name;
+}
+
+void RecordingGlBackend::delete_texture(GLuint texture) {
+  record("delete_texture", {texture});
+  if (texture != 0 && m_textures.erase(texture) == 0)
+    error("delete_texture: unknown texture");
+}
+
+void RecordingGlBackend::enable_vertex_attrib_array(GLuint index) {
+  record("enable_vertex_attrib_array", {index});
+  if (m_vertex_array == 0)
+    error("enable_vertex_attrib_array: no vertex array bound");
+}
+
+void RecordingGlBackend::vertex_attrib_pointer(GLuint index, GLint size,
+                                               GLenum type, GLboolean,
+                                               GLsizei stride,
+                                               const void *pointer) {
+  record("vertex_attrib_pointer",
+         {index, size, type, stride, reinterpret_cast<long long>(pointer)});
+  if (m_vertex_array == 0)
+    error("vertex_attrib_pointer: no vertex array bound");
+  bound_buffer("vertex_attrib_pointer", GL_ARRAY_BUFFER);
+}
+
+void RecordingGlBackend::vertex_attrib_1f(GLuint index, GLfloat value) {
+  record("vertex_attrib_1f", {index, static_cast<long long>(value)});
+}
+
+void RecordingGlBackend::vertex_attrib_divisor(GLuint index, GLuint divisor) {
+  record("vertex_attrib_divisor", {index, divisor});
+  if (m_vertex_array == 0)
+    error("vertex_attrib_divisor: no vertex array bound");
+}
+
+void RecordingGlBackend::buffer_data(GLenum target, GLsizeiptr size,
+                                     const void *data, GLenum usage) {
+  record("buffer_data", {target, size, usage});
+  if (GLuint buffer = bound_buffer("buffer_data", target)) {
+    Buffer &storage = m_buffers[buffer];
+    if (storage.immutable)
+      error("buffer_data: the buffer has immutable storage");
+    storage.data.assign(static_cast<std::size_t>(size), 0);
+    if (data != nullptr)
+      std::memcpy(storage.data.data(), data, storage.data.size());
+  }
+  if (data != nullptr)
+    uploaded_bytes += static_cast<std::size_t>(size);
+}
+
+void RecordingGlBackend::buffer_sub_data(GLenum target, GLintptr offset,
+                                         GLsizeiptr size, const void *data) {
+  record("buffer_sub_data", {target, offset, size});
+  if (GLuint buffer = bound_buffer("buffer_sub_data", target)) {
+    std::vector<std::uint8_t> &storage = m_buffers[buffer].data;
+    if (static_cast<std::size_t>(offset + size) > storage.size())
+      error("buffer_sub_data: range outside the buffer storage");
+    else
+      std::memcpy(storage.data() + offset, data,
+                  static_cast<std::size_t>(size));
+  }
+  uploaded_bytes += static_cast<std::size_t>(size);
+}
+
+void RecordingGlBackend::buffer_storage(GLenum target, GLsizeiptr size,
+                                        const void *data, GLbitfield flags) {
+  record("buffer_storage", {target, size, flags});
+  if (GLuint buffer = bound_buffer("buffer_storage", target)) {
+    Buffer &storage = m_buffers[buffer];
+    if (storage.immutable)
+      error("buffer_storage: the storage is already immutable");
+    storage.immutable = true;
+    storage.data.assign(static_cast<std::size_t>(size), 0);
+    if (data != nullptr)
+      std::memcpy(storage.data.data(), data, storage.data.size());
+  }
+  if (data != nullptr)
+    uploaded_bytes += static_cast<std::size_t>(size);
+}
+
+void *RecordingGlBackend::map_buffer_range(GLenum target, GLintptr offset,
+                                           GLsizeiptr length,
+                                           GLbitfield access) {
+  record("map_buffer_range", {target, offset, length, access});
+  GLuint buffer = bound_buffer("map_buffer_range", target);
+  if (buffer == 0)
+    return nullptr;
+
+  Buffer &storage = m_buffers[buffer];
+  if (storage.mapped) {
+    error("map_buffer_range: the buffer is already mapped");
+    return nullptr;
+  }
+  if (static_cast<std::size_t>(offset + length) > storage.data.size()) {
+    error("map_buffer_range: range outside the buffer storage");
+    return nullptr;
+  }
+  if ((access & GL_MAP_PERSISTENT_BIT) && !storage.immutable) {
+    error("map_buffer_range: persistent mapping of mutable storage");
+    return nullptr;
+  }
+  storage.mapped = true;
+  return storage.data.data() + offset;
+}
+
+void RecordingGlBackend::unmap_buffer(GLenum target) {
+  record("unmap_buffer", {target});
+  if (GLuint buffer = bound_buffer("unmap_buffer", target)) {
+    if (!m_buffers[buffer].mapped)
+      error("unmap_buffer: the buffer is not mapped");
+    m_buffers[buffer].mapped = false;
+  }
+}
+
+void RecordingGlBackend::bind_buffer_range(GLenum target, GLuint index,
+                                           GLuint buffer, GLintptr offset,
+                                           GLsizeiptr size) {
+  record("bind_buffer_range", {target, index, buffer, offset, size});
+  auto it = m_buffers.find(buffer);
+  if (it == m_buffers.end())
+    error("bind_buffer_range: unknown buffer " + std::to_string(buffer));
+  else if (static_cast<std::size_t>(offset + size) > it->second.data.size())
+    error("bind_buffer_range: range outside the buffer storage");
+  m_bound_buffers[target] = buffer;
+}
+
+GLsync RecordingGlBackend::fence_sync() {
+  std::uintptr_t name = m_next_name++;
+  record("fence_sync", {static_cast<long long>(name)});
+  m_fences.insert(name);
+  return reinterpret_cast<GLsync>(name);
+}
+
+GLenum RecordingGlBackend::client_wait_sync(GLsync sync, GLuint64 timeout) {
+  auto name = reinterpret_cast<std::uintptr_t>(sync);
+  record("client_wait_sync",
+         {static_cast<long long>(name), static_cast<long long>(timeout)});
+  if (!m_fences.contains(name)) {
+    error("client_wait_sync: unknown fence");
+    return GL_WAIT_FAILED;
+  }
+  return fences_signaled ? GL_ALREADY_SIGNALED : GL_TIMEOUT_EXPIRED;
+}
+
+void RecordingGlBackend::delete_sync(GLsync sync) {
+  auto name = reinterpret_cast<std::uintptr_t>(sync);
+  record("delete_sync", {static_cast<long long>(name)});
+  if (m_fences.erase(name) == 0)
+    error("delete_sync: unknown fence");
+}
+
+GLuint RecordingGlBackend::gen_query() {
+  GLuint name = m_next_name++;
+  record("gen_query", {name});
+  m_queries[name] = false;
+  return name;
+}
+
+void RecordingGlBackend::delete_query(GLuint query) {
+  record("delete_query", {query});
+  if (m_queries.erase(query) == 0)
+    error("delete_query: unknown query");
+}
+
+void RecordingGlBackend::begin_query(GLenum target, GLuint query) {
+  record("begin_query", {target, query});
+  if (!m_queries.contains(query))
+    error("begin_query: unknown query");
+  if (m_active_queries.contains(target))
+    error("begin_query: a query is already active on the target");
+  m_active_queries[target] = query;
+}
+
+void RecordingGlBackend::end_query(GLenum target) {
+  record("end_query", {target});
+  auto active = m_active_queries.find(target);
+  if (active == m_active_queries.end()) {
+    error("end_query: no active query on the target");
+    return;
+  }
+  m_queries[active->second] = true;
+  m_active_queries.erase(active);
+}
+
+GLuint64 RecordingGlBackend::get_query_object_ui64(GLuint query, GLenum name) {
+  record("get_query_object_ui64", {query, name});
+  auto ended = m_queries.find(query);
+  if (ended == m_queries.end() || !ended->second) {
+    error("get_query_object_ui64: the query has no result");
+    return 0;
+  }
+  if (name == GL_QUERY_RESULT_AVAILABLE)
+    return queries_available ? GL_TRUE : GL_FALSE;
+  if (!queries_available)
+    error("get_query_object_ui64: waiting on a pending result");
+  return query_result;
+}
+
+GLuint RecordingGlBackend::bound_framebuffer(GLenum target) const {
+  return target == GL_READ_FRAMEBUFFER ? m_read_framebuffer
+                                       : m_draw_framebuffer;
+}
+
+GLuint RecordingGlBackend::gen_framebuffer() {
+  GLuint name = m_next_name++;
+  record("gen_framebuffer", {name});
+  m_framebuffers[name];
+  return name;
+}
+
+void RecordingGlBackend::delete_framebuffer(GLuint framebuffer) {
+  record("delete_framebuffer", {framebuffer});
+  if (m_framebuffers.erase(framebuffer) == 0)
+    error("delete_framebuffer: unknown framebuffer");
+  // Deleting a bound framebuffer binds the default one
+  if (m_draw_framebuffer == framebuffer)
+    m_draw_framebuffer = 0;
+  if (m_read_framebuffer == framebuffer)
+    m_read_framebuffer = 0;
+}
+
+void RecordingGlBackend::bind_framebuffer(GLenum target, GLuint framebuffer) {
+  record("bind_framebuffer", {target, framebuffer});
+  if (framebuffer != 0 && !m_framebuffers.contains(framebuffer))
+    error("bind_framebuffer: unknown framebuffer " +
+          std::to_string(framebuffer));
+  if (target != GL_READ_FRAMEBUFFER)
+    m_draw_framebuffer = framebuffer;
+  if (target != GL_DRAW_FRAMEBUFFER)
+    m_read_framebuffer = framebuffer;
+}
+
+GLuint RecordingGlBackend::gen_renderbuffer() {
+  GLuint name = m_next_name++;
+  record("gen_renderbuffer", {name});
+  m_renderbuffers.insert(name);
+  return name;
+}
+
+void RecordingGlBackend::delete_renderbuffer(GLuint renderbuffer) {
+  record("delete_renderbuffer", {renderbuffer});
+  if (m_renderbuffers.erase(renderbuffer) == 0)
+    error("delete_renderbuffer: unknown renderbuffer");
+  if (m_renderbuffer == renderbuffer)
+    m_renderbuffer = 0;
+}
+
+void RecordingGlBackend::bind_renderbuffer(GLuint renderbuffer) {
+  record("bind_renderbuffer", {renderbuffer});
+  if (renderbuffer != 0 && !m_renderbuffers.contains(renderbuffer))
+    error("bind_renderbuffer: unknown renderbuffer");
+  m_renderbuffer = renderbuffer;
+}
+
+void RecordingGlBackend::renderbuffer_storage(GLenum internal_format,
+                                              GLsizei width, GLsizei height) {
+  record("renderbuffer_storage", {internal_format, width, height});
+  if (m_renderbuffer == 0)
+    error("renderbuffer_storage: no renderbuffer bound");
+}
+
+void RecordingGlBackend::framebuffer_renderbuffer(GLenum target,
+                                                  GLenum attachment,
+                                                  GLuint renderbuffer) {
+  record("framebuffer_renderbuffer", {target, attachment, renderbuffer});
+  GLuint framebuffer = bound_framebuffer(target);
+  if (framebuffer == 0) {
+    error("framebuffer_renderbuffer: the default framebuffer is bound");
+    return;
+  }
+  if (!m_renderbuffers.contains(renderbuffer))
+    error("framebuffer_renderbuffer: unknown renderbuffer");
+  m_framebuffers[framebuffer].insert(attachment);
+}
+
+GLenum RecordingGlBackend::check_framebuffer_status(GLenum target) {
+  record("check_framebuffer_status", {target});
+  GLuint framebuffer = bound_framebuffer(target);
+  if (framebuffer != 0 &&
+      !m_framebuffers[framebuffer].contains(GL_COLOR_ATTACHMENT0))
+    return GL_FRAMEBUFFER_INCOMPLETE_MISSING_ATTACHMENT;
+  return GL_FRAMEBUFFER_COMPLETE;
+}
+
+void RecordingGlBackend::blit_framebuffer(GLint src_x0, GLint src_y0,
+                                          GLint src_x1, GLint src_y1,
+                                          GLint dst_x0, GLint dst_y0,
+                                          GLint dst_x1, GLint dst_y1,
+                                          GLbitfield mask, GLenum filter) {
+  record("blit_framebuffer", {src_x0, src_y0, src_x1, src_y1, dst_x0, dst_y0,
+                              dst_x1, dst_y1, mask, filter});
+  if (m_read_framebuffer == m_draw_framebuffer)
+    error("blit_framebuffer: reading and drawing the same framebuffer");
+  if ((mask & GL_DEPTH_BUFFER_BIT) && filter != GL_NEAREST)
+    error("blit_framebuffer: depth can only be blitted with GL_NEAREST");
+}
+
+void RecordingGlBackend::viewport(GLint x, GLint y, GLsizei width,
+                                  GLsizei height) {
+  record("viewport", {x, y, width, height});
+}
+
+void RecordingGlBackend::read_pixels(GLint x, GLint y, GLsizei width,
+                                     GLsizei height, GLenum format,
+                                     GLenum type, void *pixels) {
+  record("read_pixels", {x, y, width, height, format, type});
+  std::size_t size = static_cast<std::size_t>(width) *
+                     static_cast<std::size_t>(height) *
+                     pixel_size(format, type);
+  auto pack = m_bound_buffers.find(GL_PIXEL_PACK_BUFFER);
+  if (pack == m_bound_buffers.end() || pack->second == 0) {
+    std::memset(pixels, pixel_value, size);
+    return;
+  }
+
+  Buffer &storage = m_buffers[pack->second];
+  auto offset = reinterpret_cast<std::uintptr_t>(pixels);
+  if (storage.mapped)
+    error("read_pixels: the pack buffer is mapped");
+  else if (offset + size > storage.data.size())
+    error("read_pixels: range outside the pack buffer storage");
+  else
+    std::memset(storage.data.data() + offset, pixel_value, size);
+}
+
+void RecordingGlBackend::tex_image_2d(GLenum target, GLint level, GLint,
+                                      GLsizei width, GLsizei height,
+                                      GLenum format, GLenum type,
+                                      const void *data) {
+  record("tex_image_2d", {target, level, width, height});
+  if (data != nullptr)
+    uploaded_bytes += static_cast<std::size_t>(width) *
+                      static_cast<std::size_t>(height) *
+                      pixel_size(format, type);
+}
+
+void RecordingGlBackend::compressed_tex_image_2d(GLenum target, GLint level,
+                                                 GLenum, GLsizei width,
+                                                 GLsizei height,
+                                                 GLsizei image_size,
+                                                 const void *) {
+  record("compressed_tex_image_2d", {target, level, width, height, image_size});
+  uploaded_bytes += static_cast<std::size_t>(image_size);
+}
+
+void RecordingGlBackend::compressed_tex_image_3d(GLenum target, GLint level,
+                                                 GLenum, GLsizei width,
+                                                 GLsizei height, GLsizei depth,
+                                                 GLsizei image_size,
+                                                 const void *) {
+  record("compressed_tex_image_3d",
+         {target, level, width, height, depth, image_size});
+  uploaded_bytes += static_cast<std::size_t>(image_size);
+}
+
+void RecordingGlBackend::tex_image_3d(GLenum target, GLint level, GLint,
+                                      GLsizei width, GLsizei height,
+                                      GLsizei depth, GLenum format,
+                                      GLenum type, const void *data) {
+  record("tex_image_3d", {target, level, width, height, depth});
+  if (data != nullptr)
+    uploaded_bytes += static_cast<std::size_t>(width) *
+                      static_cast<std::size_t>(height) *
+                      static_cast<std::size_t>(depth) *
+                      pixel_size(format, type);
+}
+
+void RecordingGlBackend::tex_sub_image_3d(GLenum target, GLint level,
+                                          GLint x_offset, GLint y_offset,
+                                          GLint z_offset, GLsizei width,
+                                          GLsizei height, GLsizei depth,
+                                          GLenum format, GLenum type,
+                                          const void *) {
+  record("tex_sub_image_3d", {target, level, x_offset, y_offset, z_offset,
+                              width, height, depth});
+  uploaded_bytes += static_cast<std::size_t>(width) *
+                    static_cast<std::size_t>(height) *
+                    static_cast<std::size_t>(depth) * pixel_size(format, type);
+}
+
+void RecordingGlBackend::tex_buffer(GLenum target, GLenum internal_format,
+                                    GLuint buffer) {
+  record("tex_buffer", {target, internal_format, buffer});
+  if (!m_buffers.contains(buffer))
+    error("tex_buffer: unknown buffer " + std::to_string(buffer));
+}
+
+void RecordingGlBackend::tex_parameter_i(GLenum target, GLenum name,
+                                         GLint value) {
+  record("tex_parameter_i", {target, name, value});
+}
+
+void RecordingGlBackend::tex_parameter_f(GLenum target, GLenum name,
+                                         GLfloat value) {
+  record("tex_parameter_f", {target, name, static_cast<long long>(value)});
+}
+
+void RecordingGlBackend::generate_mipmap(GLenum target) {
+  record("generate_mipmap", {target});
+}
+
+GLuint RecordingGlBackend::create_shader(GLenum type) {
+  GLuint name = m_next_name++;
+  record("create_shader", {type, name});
+  m_shaders.insert(name);
+  return name;
+}
+
+void RecordingGlBackend::shader_source(GLuint shader, const std::string &) {
+  record("shader_source", {shader});
+  if (!m_shaders.contains(shader))
+    error("shader_source: unknown shader");
+}
+
+void RecordingGlBackend::compile_shader(GLuint shader) {
+  record("compile_shader", {shader});
+  if (!m_shaders.contains(shader))
+    error("compile_shader: unknown shader");
+}
+
+GLint RecordingGlBackend::get_shader_i(GLuint shader, GLenum name) {
+  record("get_shader_i", {shader, name});
+  return name == GL_COMPILE_STATUS ? GL_TRUE : 0;
+}
+
+std::string RecordingGlBackend::get_shader_info_log(GLuint shader) {
+  record("get_shader_info_log", {shader});
+  return "";
+}
+
+void RecordingGlBackend::delete_shader(GLuint shader) {
+  record("delete_shader", {shader});
+  if (m_shaders.erase(shader) == 0)
+    error("delete_shader: unknown shader");
+}
+
+GLuint RecordingGlBackend::create_program() {
+  GLuint name = m_next_name++;
+  record("create_program", {name});
+  m_programs.insert(name);
+  return name;
+}
+
+void RecordingGlBackend::attach_shader(GLuint program, GLuint shader) {
+  record("attach_shader", {program, shader});
+  if (!m_programs.contains(program) || !m_shaders.contains(shader))
+    error("attach_shader: unknown program or shader");
+}
+
+void RecordingGlBackend::link_program(GLuint program) {
+  record("link_program", {program});
+  if (!m_programs.contains(program))
+    error("link_program: unknown program");
+}
+
+GLint RecordingGlBackend::get_program_i(GLuint program, GLenum name) {
+  record("get_program_i", {program, name});
+  switch (name) {
+  case GL_LINK_STATUS:
+    return GL_TRUE;
+  case GL_ACTIVE_UNIFORMS:
+    return static_cast<GLint>(active_uniforms.size());
+  case GL_ACTIVE_ATTRIBUTES:
+    return static_cast<GLint>(active_attributes.size());
+  default:
+    return 0;
+  }
+}
+
+std::string RecordingGlBackend::get_program_info_log(GLuint program) {
+  record("get_program_info_log", {program});
+  return "";
+}
+
+void RecordingGlBackend::delete_program(GLuint program) {
+  record("delete_program", {program});
+  if (m_programs.erase(program) == 0)
+    error("delete_program: unknown program");
+  if (m_program == program)
+    m_program = 0;
+}
+
+std::string RecordingGlBackend::get_active_uniform(GLuint program,
+                                                   GLuint index, GLint &size,
+                                                   GLenum &type) {
+  record("get_active_uniform", {program, index});
+  size = 1;
+  type = active_uniforms.at(index).second;
+  return active_uniforms.at(index).first;
+}
+
+std::string RecordingGlBackend::get_active_attrib(GLuint program,
+                                                  GLuint index, GLint &size,
+                                                  GLenum &type) {
+  record("get_active_attrib", {program, index});
+  size = 1;
+  type = active_attributes.at(index).second;
+  return active_attributes.at(index).first;
+}
+
+GLint RecordingGlBackend::get_uniform_location(GLuint program,
+                                               const char *name) {
+  record("get_uniform_location", {program});
+  for (std::size_t i = 0; i < active_uniforms.size(); ++i) {
+    if (active_uniforms[i].first == name)
+      return static_cast<GLint>(i);
+  }
+  return -1;
+}
+
+GLint RecordingGlBackend::get_attrib_location(GLuint program,
+                                              const char *name) {
+  record("get_attrib_location", {program});
+  for (std::size_t i = 0; i < active_attributes.size(); ++i) {
+    if (active_attributes[i].first == name)
+      return static_cast<GLint>(i);
+  }
+  return -1;
+}
+
+GLuint RecordingGlBackend::get_uniform_block_index(GLuint program,
+                                                   const char *) {
+  record("get_uniform_block_index", {program});
+  return 0;
+}
+
+void RecordingGlBackend::uniform_block_binding(GLuint program,
+                                               GLuint block_index,
+                                               GLuint binding) {
+  record("uniform_block_binding", {program, block_index, binding});
+}
+
+void RecordingGlBackend::uniform_1i(GLint location, GLint value) {
+  record("uniform_1i", {location, value});
+  check_uniform("uniform_1i");
+}
+
+void RecordingGlBackend::uniform_1f(GLint location, GLfloat value) {
+  record("uniform_1f", {location, static_cast<long long>(value)});
+  check_uniform("uniform_1f");
+}
+
+void RecordingGlBackend::uniform_3fv(GLint location, const GLfloat *) {
+  record("uniform_3fv", {location});
+  check_uniform("uniform_3fv");
+}
+
+void RecordingGlBackend::uniform_4fv(GLint location, const GLfloat *) {
+  record("uniform_4fv", {location});
+  check_uniform("uniform_4fv");
+}
+
+void RecordingGlBackend::uniform_matrix_3fv(GLint location, const GLfloat *) {
+  record("uniform_matrix_3fv", {location});
+  check_uniform("uniform_matrix_3fv");
+}
+
+void RecordingGlBackend::uniform_matrix_4fv(GLint location, const GLfloat *) {
+  record("uniform_matrix_4fv", {location});
+  check_uniform("uniform_matrix_4fv");
+}
+
+GLenum RecordingGlBackend::get_error() {
+  record("get_error");
+  return GL_NO_ERROR;
+}
+
+GLint RecordingGlBackend::get_integer(GLenum name) {
+  record("get_integer", {name});
+  switch (name) {
+  case GL_MAJOR_VERSION:
+    return major_version;
+  case GL_MINOR_VERSION:
+    return minor_version;
+  case GL_MAX_RENDERBUFFER_SIZE:
+    return 8192;
+  default:
+    return 0;
+  }
+}
+
+GLfloat RecordingGlBackend::get_float(GLenum name) {
+  record("get_float", {name});
+  return 0.f;
+}
+
+const char *RecordingGlBackend::get_string_i(GLenum name, GLuint index) {
+  record("get_string_i", {name, index});
+  return nullptr;
+}
+
+void RecordingGlBackend::draw_arrays(GLenum mode, GLint first, GLsizei count) {
+  record("draw_arrays", {mode, first, count});
+  check_draw("draw_arrays");
+}
+
+void RecordingGlBackend::multi_draw_arrays(GLenum mode, const GLint *first,
+                                           const GLsizei *count,
+                                           GLsizei draw_count) {
+  std::vector<long long> arguments{mode, draw_count};
+  for (GLsizei i = 0; i < draw_count; ++i) {
+    arguments.push_back(first[i]);
+    arguments.push_back(count[i]);
+  }
+  record("multi_draw_arrays", std::move(arguments));
+  check_draw("multi_draw_arrays");
+}
+
+void RecordingGlBackend::draw_arrays_instanced(GLenum mode, GLint first,
+                                               GLsizei count,
+                                               GLsizei instance_count) {
+  record("draw_arrays_instanced", {mode, first, count, instance_count});
+  check_draw("draw_arrays_instanced");
+}
+
+void RecordingGlBackend::draw_arrays_instanced_base_instance(
+    GLenum mode, GLint first, GLsizei count, GLsizei instance_count,
+    GLuint base_instance) {
+  record("draw_arrays_instanced_base_instance",
+         {mode, first, count, instance_count, base_instance});
+  check_draw("draw_arrays_instanced_base_instance");
+}
+
+TEST_CASE("Recording GL backend reports misuse") {
+  RecordingGlBackend backend;
+
+  GLuint buffer = backend.gen_buffer();
+  backend.buffer_data(GL_ARRAY_BUFFER, 16, nullptr, GL_STATIC_DRAW);
+  CHECK(backend.errors.size() == 1); // Nothing bound
+
+  backend.bind_buffer(GL_ARRAY_BUFFER, buffer);
+  backend.buffer_data(GL_ARRAY_BUFFER, 16, nullptr, GL_STATIC_DRAW);
+  float data[8] = {};
+  backend.buffer_sub_data(GL_ARRAY_BUFFER, 0, sizeof(data), data);
+  CHECK(backend.errors.size() == 2); // 32 bytes in a 16 bytes buffer
+  CHECK(backend.uploaded_bytes == sizeof(data));
+
+  backend.draw_arrays(GL_TRIANGLES, 0, 3);
+  CHECK(backend.errors.size() == 4); // No program, no vertex array
+
+  backend.bind_texture(GL_TEXTURE_2D, 1234);
+  CHECK(backend.errors.size() == 5);
+
+  backend.reset();
+  CHECK(backend.get_call_count() == 0);
+  CHECK(backend.uploaded_bytes == 0);
+}
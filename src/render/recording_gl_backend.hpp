@@ -0,0 +1,226 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include "gl_backend.hpp"
+
+// GlBackend that records the calls instead of issuing them, for headless
+// tests. It hands out object names, tracks the bindings and reports misuse
+// (unknown objects, uploads without a bound buffer, draws without a program
+// or vertex array...) in errors instead of crashing.
+class RecordingGlBackend : public GlBackend {
+public:
+  struct Call {
+    std::string function;
+    std::vector<long long> arguments;
+  };
+
+  std::vector<Call> calls;
+  std::vector<std::string> errors;
+  std::size_t uploaded_bytes = 0; // Buffer and texture data sent
+
+  // Reported by the reflection of every linked program, a location is the
+  // index of the name
+  std::vector<std::pair<std::string, GLenum>> active_uniforms;
+  std::vector<std::pair<std::string, GLenum>> active_attributes;
+
+  // Reported GL version, 4.6 exposes every optional path
+  GLint major_version = 4;
+  GLint minor_version = 6;
+  // false simulates a GPU still busy with every fenced command
+  bool fences_signaled = true;
+  // Result of every ended query (nanoseconds for a timer), false simulates
+  // results still on their way
+  GLuint64 query_result = 0;
+  bool queries_available = true;
+  // Value of every byte written by read_pixels
+  std::uint8_t pixel_value = 0;
+  // gen_buffer hands back the last deleted name, as Mesa does
+  bool reuse_buffer_names = false;
+
+  // Forget the calls and uploads, objects and bindings are kept. Called at
+  // the start of a frame to measure it alone
+  void reset();
+
+  long count(const std::string &function) const;
+  // Calls of one function, in order
+  std::vector<Call> filter(const std::string &function) const;
+  std::size_t get_call_count() const { return calls.size(); }
+  // Data store of a buffer, written by uploads and mapped pointers
+  const std::vector<std::uint8_t> &get_buffer_data(GLuint buffer) const {
+    return m_buffers.at(buffer).data;
+  }
+
+  void use_program(GLuint program) override;
+  void bind_vertex_array(GLuint vertex_array) override;
+  void bind_buffer(GLenum target, GLuint buffer) override;
+  void bind_buffer_base(GLenum target, GLuint index, GLuint buffer) override;
+  void active_texture(GLenum unit) override;
+  void bind_texture(GLenum target, GLuint texture) override;
+
+  GLuint gen_vertex_array() override;
+  void delete_vertex_array(GLuint vertex_array) override;
+  GLuint gen_buffer() override;
+  void delete_buffer(GLuint buffer) override;
+  GLuint gen_texture() override;
+  void delete_texture(GLuint texture) override;
+
+  void enable_vertex_attrib_array(GLuint index) override;
+  void vertex_attrib_pointer(GLuint index, GLint size, GLenum type,
+                             GLboolean normalized, GLsizei stride,
+                             const void *pointer) override;
+  void vertex_attrib_1f(GLuint index, GLfloat value) override;
+  void vertex_attrib_divisor(GLuint index, GLuint divisor) override;
+
+  void buffer_data(GLenum target, GLsizeiptr size, const void *data,
+                   GLenum usage) override;
+  void buffer_sub_data(GLenum target, GLintptr offset, GLsizeiptr size,
+                       const void *data) override;
+  void buffer_storage(GLenum target, GLsizeiptr size, const void *data,
+                      GLbitfield flags) override;
+  void *map_buffer_range(GLenum target, GLintptr offset, GLsizeiptr length,
+                         GLbitfield access) override;
+  void unmap_buffer(GLenum target) override;
+  void bind_buffer_range(GLenum target, GLuint index, GLuint buffer,
+                         GLintptr offset, GLsizeiptr size) override;
+
+  GLsync fence_sync() override;
+  GLenum client_wait_sync(GLsync sync, GLuint64 timeout) override;
+  void delete_sync(GLsync sync) override;
+
+  GLuint gen_query() override;
+  void delete_query(GLuint query) override;
+  void begin_query(GLenum target, GLuint query) override;
+  void end_query(GLenum target) override;
+  GLuint64 get_query_object_ui64(GLuint query, GLenum name) override;
+
+  GLuint gen_framebuffer() override;
+  void delete_framebuffer(GLuint framebuffer) override;
+  void bind_framebuffer(GLenum target, GLuint framebuffer) override;
+  GLuint gen_renderbuffer() override;
+  void delete_renderbuffer(GLuint renderbuffer) override;
+  void bind_renderbuffer(GLuint renderbuffer) override;
+  void renderbuffer_storage(GLenum internal_format, GLsizei width,
+                            GLsizei height) override;
+  void framebuffer_renderbuffer(GLenum target, GLenum attachment,
+                                GLuint renderbuffer) override;
+  GLenum check_framebuffer_status(GLenum target) override;
+  void blit_framebuffer(GLint src_x0, GLint src_y0, GLint src_x1,
+                        GLint src_y1, GLint dst_x0, GLint dst_y0,
+                        GLint dst_x1, GLint dst_y1, GLbitfield mask,
+                        GLenum filter) override;
+  void viewport(GLint x, GLint y, GLsizei width, GLsizei height) override;
+  void read_pixels(GLint x, GLint y, GLsizei width, GLsizei height,
+                   GLenum format, GLenum type, void *pixels) override;
+
+  void tex_image_2d(GLenum target, GLint level, GLint internal_format,
+                    GLsizei width, GLsizei height, GLenum format, GLenum type,
+                    const void *data) override;
+  void compressed_tex_image_2d(GLenum target, GLint level,
+                               GLenum internal_format, GLsizei width,
+                               GLsizei height, GLsizei image_size,
+                               const void *data) override;
+  void compressed_tex_image_3d(GLenum target, GLint level,
+                               GLenum internal_format, GLsizei width,
+                               GLsizei height, GLsizei depth,
+                               GLsizei image_size, const void *data) override;
+  void tex_image_3d(GLenum target, GLint level, GLint internal_format,
+                    GLsizei width, GLsizei height, GLsizei depth,
+                    GLenum format, GLenum type, const void *data) override;
+  void tex_sub_image_3d(GLenum target, GLint level, GLint x_offset,
+                        GLint y_offset, GLint z_offset, GLsizei width,
+                        GLsizei height, GLsizei depth, GLenum format,
+                        GLenum type, const void *data) override;
+  void tex_buffer(GLenum target, GLenum internal_format,
+                  GLuint buffer) override;
+  void tex_parameter_i(GLenum target, GLenum name, GLint value) override;
+  void tex_parameter_f(GLenum target, GLenum name, GLfloat value) override;
+  void generate_mipmap(GLenum target) override;
+
+  GLuint create_shader(GLenum type) override;
+  void shader_source(GLuint shader, const std::string &source) override;
+  void compile_shader(GLuint shader) override;
+  GLint get_shader_i(GLuint shader, GLenum name) override;
+  std::string get_shader_info_log(GLuint shader) override;
+  void delete_shader(GLuint shader) override;
+  GLuint create_program() override;
+  void attach_shader(GLuint program, GLuint shader) override;
+  void link_program(GLuint program) override;
+  GLint get_program_i(GLuint program, GLenum name) override;
+  std::string get_program_info_log(GLuint program) override;
+  void delete_program(GLuint program) override;
+
+  std::string get_active_uniform(GLuint program, GLuint index, GLint &size,
+                                 GLenum &type) override;
+  std::string get_active_attrib(GLuint program, GLuint index, GLint &size,
+                                GLenum &type) override;
+  GLint get_uniform_location(GLuint program, const char *name) override;
+  GLint get_attrib_location(GLuint program, const char *name) override;
+  GLuint get_uniform_block_index(GLuint program,
+                                 const char *block_name) override;
+  void uniform_block_binding(GLuint program, GLuint block_index,
+                             GLuint binding) override;
+
+  void uniform_1i(GLint location, GLint value) override;
+  void uniform_1f(GLint location, GLfloat value) override;
+  void uniform_3fv(GLint location, const GLfloat *value) override;
+  void uniform_4fv(GLint location, const GLfloat *value) override;
+  void uniform_matrix_3fv(GLint location, const GLfloat *value) override;
+  void uniform_matrix_4fv(GLint location, const GLfloat *value) override;
+
+  GLenum get_error() override;
+  GLint get_integer(GLenum name) override;
+  GLfloat get_float(GLenum name) override;
+  const char *get_string_i(GLenum name, GLuint index) override;
+
+  void draw_arrays(GLenum mode, GLint first, GLsizei count) override;
+  void multi_draw_arrays(GLenum mode, const GLint *first, const GLsizei *count,
+                         GLsizei draw_count) override;
+  void draw_arrays_instanced(GLenum mode, GLint first, GLsizei count,
+                             GLsizei instance_count) override;
+  void draw_arrays_instanced_base_instance(GLenum mode, GLint first,
+                                           GLsizei count,
+                                           GLsizei instance_count,
+                                           GLuint base_instance) override;
+
+private:
+  struct Buffer {
+    std::vector<std::uint8_t> data;
+    bool immutable = false;
+    bool mapped = false;
+  };
+
+  GLuint m_next_name = 1; // Shared by every kind of object
+  std::set<GLuint> m_vertex_arrays;
+  std::map<GLuint, Buffer> m_buffers;
+  std::vector<GLuint> m_deleted_buffers; // Reused by reuse_buffer_names
+  std::set<std::uintptr_t> m_fences;
+  std::set<GLuint> m_textures;
+  std::map<GLuint, bool> m_queries;          // Query -> ended at least once
+  std::map<GLenum, GLuint> m_active_queries; // Target -> query
+  std::map<GLuint, std::set<GLenum>> m_framebuffers; // -> attachments
+  std::set<GLuint> m_renderbuffers;
+  std::set<GLuint> m_shaders;
+  std::set<GLuint> m_programs;
+
+  GLuint m_program = 0;
+  GLuint m_vertex_array = 0;
+  std::map<GLenum, GLuint> m_bound_buffers; // Target -> buffer
+  GLuint m_draw_framebuffer = 0;
+  GLuint m_read_framebuffer = 0;
+  GLuint m_renderbuffer = 0;
+
+  void record(const char *function, std::vector<long long> arguments = {});
+  void error(const std::string &message);
+  // Buffer bound to target, 0 (and an error) if none
+  GLuint bound_buffer(const char *function, GLenum target);
+  void check_draw(const char *function);
+  void check_uniform(const char *function);
+  // Framebuffer bound to target (GL_FRAMEBUFFER is the draw one)
+  GLuint bound_framebuffer(GLenum target) const;
+};
@@ -0,0 +1,273 @@
+#include "render_queue.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <memory>
+#include <optional>
+#include "doctest/doctest.h"
+#include "memory/frame_arena.hpp"
+#include "profiling/trace.hpp"
+#include "recording_gl_backend.hpp"
+
+namespace {
+
+std::uint32_t hash_float(std::uint32_t hash, float value) {
+  return (hash ^ std::bit_cast<std::uint32_t>(value)) * 16777619u;
+}
+
+// Assigning would keep the resource of the old vector, rebuild it instead.
+// The old storage belongs to a past frame and is dropped
+template <typename T>
+void rebind(std::pmr::vector<T> &vector, std::pmr::memory_resource *memory,
+            std::size_t capacity) {
+  std::destroy_at(&vector);
+  std::construct_at(&vector, memory);
+  vector.reserve(capacity);
+}
+
+} // namespace
+
+std::uint64_t RenderQueue::make_key(RenderPass pass, GLuint program,
+                                    GLuint texture, std::uint32_t material,
+                                    GLuint vertex_array, std::uint32_t depth) {
+  auto field = [](std::uint64_t value, int bits) {
+    return value & ((std::uint64_t(1) << bits) - 1);
+  };
+
+  std::uint64_t key = field(static_cast<std::uint64_t>(pass), 4) << 60;
+  if (pass == RenderPass::Transparent) {
+    key |= field(0xFFFF - depth, 16) << 44;
+    key |= field(program, 12) << 32;
+    key |= field(texture, 12) << 20;
+    key |= field(vertex_array, 12) << 8;
+    key |= field(material, 8);
+  } else {
+    key |= field(program, 12) << 48;
+    key |= field(texture, 12) << 36;
+    key |= field(material, 8) << 28;
+    key |= field(vertex_array, 12) << 16;
+    key |= field(depth, 16);
+  }
+  return key;
+}
+
+std::uint32_t RenderQueue::material_id(const DrawPacket::Material &material) {
+  std::uint32_t hash = 2166136261u;
+  for (float value :
+       {material.diffuse.x, material.diffuse.y, material.diffuse.z,
+        material.specular.x, material.specular.y, material.specular.z,
+        material.shininess, material.color.x, material.color.y,
+        material.color.z, material.texture_layer}) {
+    hash = hash_float(hash, value);
+  }
+  hash = hash_float(hash, static_cast<float>(material.use_color |
+                                             material.use_texture_array << 1 |
+                                             material.is_particle << 2));
+  return (hash ^ (hash >> 8) ^ (hash >> 16) ^ (hash >> 24)) & 0xFF;
+}
+
+void RenderQueue::submit(RenderPass pass, float view_depth,
+                         const DrawPacket &packet) {
+  float normalized = std::clamp(view_depth / m_max_depth, 0.f, 1.f);
+  auto depth = static_cast<std::uint32_t>(normalized * 0xFFFF);
+
+  m_keys.emplace_back(make_key(pass, packet.program_id, packet.texture,
+                               material_id(packet.material),
+                               packet.vertex_array, depth),
+                      static_cast<std::uint32_t>(m_packets.size()));
+  m_packets.push_back(packet);
+}
+
+void RenderQueue::begin_frame(std::pmr::memory_resource *memory) {
+  rebind(m_packets, memory, m_last_size);
+  rebind(m_keys, memory, m_last_size);
+}
+
+void RenderQueue::clear() {
+  m_last_size = m_packets.size();
+  m_packets.clear();
+  m_keys.clear();
+}
+
+void RenderQueue::apply_uniforms(const DrawPacket &packet) {
+  Program &program = *packet.program;
+  if (packet.model_matrix)
+    program.set_uniform("u_model_matrix", *packet.model_matrix);
+  if (packet.normal_matrix)
+    program.set_uniform("u_normal_matrix", *packet.normal_matrix);
+
+  program.set_uniform("u_instanced", packet.instance_count > 0 ? 1 : 0);
+
+  const DrawPacket::Material &material = packet.material;
+  program.set_uniform("u_is_particle", material.is_particle ? 1 : 0);
+  if (material.is_particle)
+    return;
+
+  program.set_uniform("u_kd", material.diffuse);
+  program.set_uniform("u_ks", material.specular);
+  program.set_uniform("u_shininess", material.shininess);
+  program.set_uniform("u_use_color", material.use_color ? 1 : 0);
+  if (material.use_color) {
+    program.set_uniform("u_color", material.color);
+  } else if (material.use_texture_array) {
+    program.set_uniform("u_use_texture_array", 1);
+    program.set_uniform("u_texture_array",
+                        static_cast<int>(packet.texture_unit));
+  } else {
+    program.set_uniform("u_use_texture_array", 0);
+    program.set_uniform("u_texture", static_cast<int>(packet.texture_unit));
+  }
+}
+
+const char *RenderQueue::pass_name(RenderPass pass) {
+  return pass == RenderPass::Opaque ? "opaque pass" : "transparent pass";
+}
+
+void RenderQueue::execute(GlStateCache &cache, Profiler *profiler) {
+  std::sort(m_keys.begin(), m_keys.end());
+
+  // Other code binds directly between frames
+  cache.invalidate();
+
+  std::optional<RenderPass> pass;
+  for (const auto &[key, index] : m_keys) {
+    const DrawPacket &packet = m_packets[index];
+    TraceScope trace("draw");
+
+    // Packets of a pass are contiguous once sorted
+    auto packet_pass = static_cast<RenderPass>(key >> 60);
+    if (profiler && packet_pass != pass) {
+      if (pass) {
+        profiler->end_gpu();
+        profiler->end_cpu();
+      }
+      pass = packet_pass;
+      profiler->begin_cpu(pass_name(*pass));
+      profiler->begin_gpu(pass_name(*pass));
+    }
+
+    cache.use_program(packet.program_id);
+    if (packet.program)
+      apply_uniforms(packet);
+    if (packet.texture_target != 0)
+      cache.bind_texture(packet.texture_unit, packet.texture_target,
+                         packet.texture);
+    cache.bind_vertex_array(packet.vertex_array);
+
+    GlBackend &gl = cache.backend();
+    if (packet.material.texture_layer >= 0.f)
+      gl.vertex_attrib_1f(3, packet.material.texture_layer);
+    if (packet.instance_count > 0 && packet.base_instance == 0) {
+      gl.draw_arrays_instanced(packet.mode, packet.first, packet.count,
+                               packet.instance_count);
+    } else if (packet.instance_count > 0) {
+      gl.draw_arrays_instanced_base_instance(packet.mode, packet.first,
+                                             packet.count,
+                                             packet.instance_count,
+                                             packet.base_instance);
+    } else if (packet.firsts) {
+      gl.multi_draw_arrays(packet.mode, packet.firsts, packet.counts,
+                           packet.draw_count);
+    } else {
+      gl.draw_arrays(packet.mode, packet.first, packet.count);
+    }
+  }
+  cache.bind_vertex_array(0);
+  if (profiler && pass) {
+    profiler->end_gpu();
+    profiler->end_cpu();
+  }
+
+  clear();
+}
+
+TEST_CASE("Render queue sorts packets to share state") {
+  RecordingGlBackend backend;
+  GlStateCache cache(backend);
+  RenderQueue queue;
+
+  // Interleaved programs and vertex arrays, submitted in the worst order
+  for (int i = 0; i < 12; ++i) {
+    DrawPacket packet;
+    packet.program_id = 1 + i % 2;
+    packet.vertex_array = 10 + i % 3;
+    packet.count = 3;
+    queue.submit(RenderPass::Opaque, static_cast<float>(i), packet);
+  }
+  queue.execute(cache);
+
+  CHECK(backend.count("draw_arrays") == 12);
+  CHECK(backend.count("use_program") == 2);
+  // Three vertex arrays per program, then the final unbind
+  CHECK(backend.count("bind_vertex_array") == 7);
+  CHECK(queue.size() == 0);
+}
+
+TEST_CASE("Transparent packets come last, back to front") {
+  RecordingGlBackend backend;
+  GlStateCache cache(backend);
+  RenderQueue queue;
+  queue.set_max_depth(100.f);
+
+  auto packet_with_count = [](GLsizei count, GLuint program) {
+    DrawPacket packet;
+    packet.program_id = program;
+    packet.count = count;
+    return packet;
+  };
+  queue.submit(RenderPass::Transparent, 10.f, packet_with_count(1, 1));
+  queue.submit(RenderPass::Opaque, 50.f, packet_with_count(2, 2));
+  queue.submit(RenderPass::Transparent, 80.f, packet_with_count(3, 2));
+  queue.submit(RenderPass::Opaque, 5.f, packet_with_count(4, 2));
+  queue.execute(cache);
+
+  auto draws = backend.filter("draw_arrays");
+  REQUIRE(draws.size() == 4);
+  // Opaque front to back, then transparent back to front
+  CHECK(draws[0].arguments[2] == 4);
+  CHECK(draws[1].arguments[2] == 2);
+  CHECK(draws[2].arguments[2] == 3);
+  CHECK(draws[3].arguments[2] == 1);
+}
+
+TEST_CASE("Packets with the same texture bind it once") {
+  RecordingGlBackend backend;
+  GlStateCache cache(backend);
+  RenderQueue queue;
+
+  for (GLuint texture : {5u, 6u, 5u, 6u, 5u}) {
+    DrawPacket packet;
+    packet.program_id = 1;
+    packet.texture_target = GL_TEXTURE_2D;
+    packet.texture = texture;
+    packet.count = 3;
+    queue.submit(RenderPass::Opaque, 1.f, packet);
+  }
+  queue.execute(cache);
+
+  CHECK(backend.count("bind_texture") == 2);
+  CHECK(backend.count("draw_arrays") == 5);
+}
+
+TEST_CASE("Render queue packets can live in a frame arena") {
+  RecordingGlBackend backend;
+  GlStateCache cache(backend);
+  DoubleFrameArena arenas(1024); // Outlives the queue storage
+  RenderQueue queue;
+
+  for (int frame = 0; frame < 3; ++frame) {
+    arenas.begin_frame();
+    queue.begin_frame(&arenas.current());
+    for (int i = 0; i < 50; ++i) {
+      DrawPacket packet;
+      packet.program_id = 1;
+      packet.count = 3;
+      queue.submit(RenderPass::Opaque, static_cast<float>(i), packet);
+    }
+    queue.execute(cache);
+    CHECK(arenas.current().get_used() > 0);
+  }
+  // Reserved at the size of the last frame, the arenas did not overflow
+  CHECK(arenas.current().get_overflow_count() == 0);
+  CHECK(backend.count("draw_arrays") == 150);
+}
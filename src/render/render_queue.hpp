@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+#include "gl_state_cache.hpp"
+#include "profiling/profiler.hpp"
+#include "program.hpp"
+
+enum class RenderPass : std::uint8_t {
+  Opaque = 0,
+  Transparent = 1, // Drawn after the opaque pass, back to front
+};
+
+// Everything needed to issue one draw, the pointed data must outlive the
+// queue execution
+struct DrawPacket {
+  struct Material {
+    glm::vec3 diffuse{1.f};
+    glm::vec3 specular{0.5f};
+    float shininess = 64.f;
+    glm::vec3 color{0.f};
+    bool use_color = false;
+    bool use_texture_array = false;
+    // Generic value of the layer attribute, when negative the layer comes
+    // from the vertex buffer
+    float texture_layer = -1.f;
+    bool is_particle = false;
+  };
+
+  GLuint program_id = 0;
+  Program *program = nullptr; // Uniforms are only uploaded when set
+  GLuint vertex_array = 0;
+
+  GLuint texture_unit = 0;
+  GLenum texture_target = 0; // No texture when 0
+  GLuint texture = 0;
+
+  const glm::mat4 *model_matrix = nullptr;
+  const glm::mat3 *normal_matrix = nullptr;
+  Material material;
+
+  GLenum mode = GL_TRIANGLES;
+  GLint first = 0;
+  GLsizei count = 0;
+  // glMultiDrawArrays when set, draw_count ranges
+  const GLint *firsts = nullptr;
+  const GLsizei *counts = nullptr;
+  GLsizei draw_count = 0;
+  // Instanced draw when set, the per-instance attributes (matrices, colour
+  // and layer, see InstanceRenderer) replace the matrices and material
+  // colour
+  GLsizei instance_count = 0;
+  // Needs GL 4.2, left at 0 the draw is a plain glDrawArraysInstanced
+  GLuint base_instance = 0;
+};
+
+// Draw packets collected during a frame, then sorted by a 64-bit key and
+// issued through a GlStateCache so shared state is bound once.
+//
+// Opaque key:      pass:4 | program:12 | texture:12 | material:8 | vao:12 |
+//                  depth:16
+// Transparent key: pass:4 | far-to-near depth:16 | program:12 | texture:12 |
+//                  vao:12 | material:8
+class RenderQueue {
+public:
+  // Allocate the packets and keys of this frame from memory (a frame arena,
+  // reset after the execution), reserved at the size of the last frame.
+  // Without it they keep their storage from frame to frame
+  void begin_frame(std::pmr::memory_resource *memory);
+
+  // View depth mapped to the 16 depth bits
+  void set_max_depth(float max_depth) { m_max_depth = max_depth; }
+
+  void submit(RenderPass pass, float view_depth, const DrawPacket &packet);
+
+  // Sort, draw and clear. Each pass is a CPU and a GPU scope of the profiler
+  // when one is given
+  void execute(GlStateCache &cache, Profiler *profiler = nullptr);
+
+  std::size_t size() const { return m_packets.size(); }
+  void clear();
+
+  static std::uint64_t make_key(RenderPass pass, GLuint program, GLuint texture,
+                                std::uint32_t material, GLuint vertex_array,
+                                std::uint32_t depth);
+  // 8-bit hash of the material parameters, equal materials are adjacent
+  static std::uint32_t material_id(const DrawPacket::Material &material);
+
+private:
+  std::pmr::vector<DrawPacket> m_packets;
+  // Key, index of the packet
+  std::pmr::vector<std::pair<std::uint64_t, std::uint32_t>> m_keys;
+  std::size_t m_last_size = 0; // Packets of the last frame
+  float m_max_depth = 10000.f;
+
+  void apply_uniforms(const DrawPacket &packet);
+  static const char *pass_name(RenderPass pass);
+};
@@ -0,0 +1,178 @@
+#include "static_batch.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <tuple>
+
+namespace {
+
+auto group_key(const GameObject &object) {
+  glm::vec3 kd = object.get_diffuse_factor();
+  glm::vec3 ks = object.get_specular_factor();
+  return std::make_tuple(object.get_texture_array(), kd.x, kd.y, kd.z, ks.x,
+                         ks.y, ks.z, object.get_shininess_factor());
+}
+
+} // namespace
+
+void StaticBatch::add(const GameObject &object) {
+  if (object.get_texture_array() == nullptr) {
+    std::cerr << "Static batch: " << object.get_texture_path()
+              << " is not in a texture array" << std::endl;
+    return;
+  }
+
+  m_objects.push_back(&object);
+}
+
+void StaticBatch::build() {
+  std::stable_sort(m_objects.begin(), m_objects.end(),
+                   [](const GameObject *a, const GameObject *b) {
+                     return group_key(*a) < group_key(*b);
+                   });
+
+  std::vector<float> vertices;
+  m_groups.clear();
+  m_object_models.clear();
+  m_object_ranges.clear();
+  m_lod_ranges.clear();
+  m_object_lods.clear();
+  m_object_bounds.clear();
+
+  for (std::size_t index = 0; index < m_objects.size(); ++index) {
+    const GameObject *object = m_objects[index];
+    glm::mat4 model_matrix = object->get_model_matrix();
+    glm::mat3 normal_matrix =
+        glm::transpose(glm::inverse(glm::mat3(model_matrix)));
+    auto layer = static_cast<float>(object->get_texture_layer());
+    const Model &model = object->get_model();
+    const std::vector<float> &source = model.get_vertex_data();
+
+    // Every level of detail is baked, they sit one after the other
+    auto first = static_cast<GLint>(vertices.size() / vertex_size);
+    m_object_models.push_back(&model);
+    m_object_ranges.push_back(m_lod_ranges.size());
+    m_object_lods.push_back(0);
+    for (int lod = 0; lod < model.get_lod_count(); ++lod) {
+      Model::Lod range = model.get_lod(lod);
+      range.first += first;
+      m_lod_ranges.push_back(range);
+    }
+
+    for (std::size_t i = 0; i + 8 <= source.size(); i += 8) {
+      glm::vec3 position = glm::vec3(
+          model_matrix *
+          glm::vec4(source[i], source[i + 1], source[i + 2], 1.f));
+      glm::vec3 normal = normal_matrix * glm::vec3(source[i + 3], source[i + 4],
+                                                   source[i + 5]);
+      if (glm::dot(normal, normal) > 0.f)
+        normal = glm::normalize(normal);
+
+      vertices.insert(vertices.end(),
+                      {position.x, position.y, position.z, normal.x, normal.y,
+                       normal.z, source[i + 6], source[i + 7], layer});
+    }
+    m_object_bounds.push_back(object->get_world_sphere());
+
+    // Objects are sorted by group, consecutive ones share a draw call
+    if (!m_groups.empty() &&
+        m_groups.back().texture_array == object->get_texture_array() &&
+        m_groups.back().diffuse == object->get_diffuse_factor() &&
+        m_groups.back().specular == object->get_specular_factor() &&
+        m_groups.back().shininess == object->get_shininess_factor()) {
+      ++m_groups.back().object_count;
+    } else {
+      m_groups.push_back({object->get_texture_array(),
+                          object->get_diffuse_factor(),
+                          object->get_specular_factor(),
+                          object->get_shininess_factor(), index, 1});
+    }
+  }
+
+  m_vbo_vertices.bind();
+  m_vbo_vertices.fill(vertices.data(),
+                      static_cast<GLsizei>(vertices.size() * sizeof(float)),
+                      GL_STATIC_DRAW);
+
+  constexpr int stride = vertex_size * sizeof(float);
+  m_vao.specify_attribute(0, 3, GL_FLOAT, GL_FALSE, stride,
+                          (void *)0); // Position attribute
+  m_vao.specify_attribute(1, 3, GL_FLOAT, GL_FALSE, stride,
+                          (void *)(3 * sizeof(float))); // Normal attribute
+  m_vao.specify_attribute(
+      2, 2, GL_FLOAT, GL_FALSE, stride,
+      (void *)(6 * sizeof(float))); // Texture coordinate attribute
+  m_vao.specify_attribute(3, 1, GL_FLOAT, GL_FALSE, stride,
+                          (void *)(8 * sizeof(float))); // Texture layer
+  m_vbo_vertices.unbind();
+
+  std::cout << "Static batch: " << m_objects.size() << " objects, "
+            << vertices.size() / vertex_size << " vertices, "
+            << m_groups.size() << " draw calls" << std::endl;
+}
+
+void StaticBatch::submit(RenderQueue &queue, Program &program,
+                         const View &view) {
+  m_visible_count = 0;
+  if (m_groups.empty())
+    return;
+
+  view.frustum.cull(m_object_bounds, m_visible);
+
+  m_draw_firsts.resize(m_groups.size());
+  m_draw_counts.resize(m_groups.size());
+  for (std::size_t g = 0; g < m_groups.size(); ++g) {
+    const MaterialGroup &group = m_groups[g];
+    std::vector<GLint> &firsts = m_draw_firsts[g];
+    std::vector<GLsizei> &counts = m_draw_counts[g];
+    firsts.clear();
+    counts.clear();
+    float nearest = INFINITY;
+    for (std::size_t i = group.first_object;
+         i < group.first_object + group.object_count; ++i) {
+      if (!m_visible[i])
+        continue;
+      ++m_visible_count;
+
+      BoundingSphere bounds{glm::vec3(m_object_bounds.x[i],
+                                      m_object_bounds.y[i],
+                                      m_object_bounds.z[i]),
+                            m_object_bounds.radius[i]};
+      nearest = std::min(nearest, view.depth_of(bounds.center) - bounds.radius);
+      m_object_lods[i] = m_object_models[i]->select_lod(
+          view.screen_size(bounds), m_object_lods[i]);
+      const Model::Lod &range =
+          m_lod_ranges[m_object_ranges[i] + m_object_lods[i]];
+
+      // Contiguous visible ranges merge into a single one
+      if (!firsts.empty() && firsts.back() + counts.back() == range.first) {
+        counts.back() += range.count;
+      } else {
+        firsts.push_back(range.first);
+        counts.push_back(range.count);
+      }
+    }
+    if (firsts.empty())
+      continue;
+
+    DrawPacket packet;
+    packet.program_id = program.id();
+    packet.program = &program;
+    packet.vertex_array = m_vao.get_id();
+    packet.texture_unit = TextureArray::texture_unit;
+    packet.texture_target = GL_TEXTURE_2D_ARRAY;
+    packet.texture = group.texture_array->get_id();
+    packet.model_matrix = &m_model_matrix;
+    packet.normal_matrix = &m_normal_matrix;
+
+    packet.material.diffuse = group.diffuse;
+    packet.material.specular = group.specular;
+    packet.material.shininess = group.shininess;
+    packet.material.use_texture_array = true; // Layer in the vertex buffer
+
+    packet.firsts = firsts.data();
+    packet.counts = counts.data();
+    packet.draw_count = static_cast<GLsizei>(firsts.size());
+    queue.submit(RenderPass::Opaque, nearest, packet);
+  }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "game_object.hpp"
+#include "view.hpp"
+#include "program.hpp"
+#include "render_queue.hpp"
+#include "texture_array.hpp"
+#include "vao.hpp"
+#include "vbo.hpp"
+
+// Merges immovable GameObjects into a single vertex buffer. Vertices are
+// pre-transformed to world space and sorted by texture array and material,
+// so the whole set costs one draw call per distinct pair. Each object keeps
+// its vertex ranges (one per level of detail) and world bounds, so objects
+// outside the frustum are skipped and far objects use a coarser range, all
+// through glMultiDrawArrays packets. Every object must sample a texture
+// array.
+class StaticBatch {
+public:
+  StaticBatch() = default;
+
+  // Empêcher la copie
+  StaticBatch(const StaticBatch &) = delete;
+  StaticBatch &operator=(const StaticBatch &) = delete;
+
+  // Queue an object, its current model matrix and material are baked in
+  void add(const GameObject &object);
+
+  // Upload the queued objects, the batch is immutable afterwards
+  void build();
+
+  // One packet per material group with a visible object, the ranges stay
+  // valid until the next submit
+  void submit(RenderQueue &queue, Program &program, const View &view);
+
+  int get_draw_count() const { return static_cast<int>(m_groups.size()); }
+  // Objects that passed the frustum test during the last submit
+  int get_visible_count() const { return m_visible_count; }
+
+private:
+  struct MaterialGroup {
+    const TextureArray *texture_array;
+    glm::vec3 diffuse;
+    glm::vec3 specular;
+    float shininess;
+    std::size_t first_object; // Objects are sorted by group
+    std::size_t object_count;
+  };
+
+  static constexpr int vertex_size = 9; // position, normal, uv, layer
+
+  std::vector<const GameObject *> m_objects;
+  std::vector<MaterialGroup> m_groups;
+  std::vector<const Model *> m_object_models;
+  std::vector<std::size_t> m_object_ranges; // First entry in m_lod_ranges
+  std::vector<Model::Lod> m_lod_ranges;     // Every level of every object
+  std::vector<int> m_object_lods;           // Level drawn, with hysteresis
+  SphereSet m_object_bounds;
+
+  // Per-frame ranges of each group, kept to avoid reallocating every frame
+  std::vector<std::uint8_t> m_visible;
+  std::vector<std::vector<GLint>> m_draw_firsts;
+  std::vector<std::vector<GLsizei>> m_draw_counts;
+  int m_visible_count = 0;
+
+  // Vertices are already in world space
+  glm::mat4 m_model_matrix{1.f};
+  glm::mat3 m_normal_matrix{1.f};
+
+  VAO m_vao;
+  VBO m_vbo_vertices;
+};
@@ -0,0 +1,206 @@
+#include "stream_buffer.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include "doctest/doctest.h"
+#include "recording_gl_backend.hpp"
+
+namespace {
+
+std::size_t align_up(std::size_t value, std::size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+// Immutable storage and persistent mapping are core since GL 4.4
+bool has_buffer_storage() {
+  GLint major = gl().get_integer(GL_MAJOR_VERSION);
+  GLint minor = gl().get_integer(GL_MINOR_VERSION);
+  return major > 4 || (major == 4 && minor >= 4);
+}
+
+constexpr GLbitfield persistent_flags =
+    GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+} // namespace
+
+StreamBuffer::StreamBuffer(GLenum target, std::size_t segment_size,
+                           std::size_t alignment)
+    : m_target(target), m_alignment(std::max<std::size_t>(alignment, 1)),
+      m_segment_size(align_up(std::max<std::size_t>(segment_size, 1),
+                              m_alignment)),
+      m_persistent(has_buffer_storage()) {
+  allocate();
+}
+
+StreamBuffer::~StreamBuffer() { release(); }
+
+void StreamBuffer::allocate() {
+  release();
+
+  auto size = static_cast<GLsizeiptr>(m_segment_size * segment_count);
+  m_id = gl().gen_buffer();
+  gl().bind_buffer(m_target, m_id);
+  if (m_persistent) {
+    gl().buffer_storage(m_target, size, nullptr, persistent_flags);
+    m_mapped = static_cast<std::uint8_t *>(
+        gl().map_buffer_range(m_target, 0, size, persistent_flags));
+    if (m_mapped == nullptr)
+      std::cerr << "Error mapping stream buffer" << std::endl;
+  } else {
+    gl().buffer_data(m_target, size, nullptr, GL_STREAM_DRAW);
+  }
+  gl().bind_buffer(m_target, 0);
+  m_offset = 0;
+  ++m_generation;
+}
+
+void StreamBuffer::release() {
+  for (GLsync &fence : m_fences) {
+    if (fence != nullptr)
+      gl().delete_sync(fence);
+    fence = nullptr;
+  }
+  if (m_id == 0)
+    return;
+
+  // The driver keeps the storage alive until the GPU is done with it
+  if (m_mapped != nullptr) {
+    gl().bind_buffer(m_target, m_id);
+    gl().unmap_buffer(m_target);
+    gl().bind_buffer(m_target, 0);
+    m_mapped = nullptr;
+  }
+  gl().delete_buffer(m_id);
+  m_id = 0;
+}
+
+std::size_t StreamBuffer::write(const void *data, std::size_t size) {
+  std::size_t start = align_up(m_offset, m_alignment);
+  if (start + size > m_segment_size) {
+    m_segment_size =
+        align_up(std::max(2 * m_segment_size, size), m_alignment);
+    allocate();
+    start = 0;
+  }
+  m_offset = start + size;
+
+  std::size_t offset = static_cast<std::size_t>(m_segment) * m_segment_size +
+                       start;
+  if (m_persistent) {
+    if (m_mapped != nullptr)
+      std::memcpy(m_mapped + offset, data, size);
+    return offset;
+  }
+
+  // The fences guarantee the GPU is done with this range
+  gl().bind_buffer(m_target, m_id);
+  void *destination = gl().map_buffer_range(
+      m_target, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size),
+      GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT |
+          GL_MAP_INVALIDATE_RANGE_BIT);
+  if (destination != nullptr) {
+    std::memcpy(destination, data, size);
+    gl().unmap_buffer(m_target);
+  } else {
+    std::cerr << "Error mapping stream buffer" << std::endl;
+  }
+  gl().bind_buffer(m_target, 0);
+  return offset;
+}
+
+void StreamBuffer::end_frame() {
+  // An untouched segment has nothing for the GPU to finish
+  if (m_offset > 0)
+    m_fences[m_segment] = gl().fence_sync();
+
+  m_segment = (m_segment + 1) % segment_count;
+  m_offset = 0;
+
+  GLsync &fence = m_fences[m_segment];
+  if (fence == nullptr)
+    return;
+
+  // Poll without waiting
+  GLenum status = gl().client_wait_sync(fence, 0);
+  if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+    gl().delete_sync(fence);
+    fence = nullptr;
+  } else {
+    ++m_orphan_count;
+    allocate();
+  }
+}
+
+TEST_CASE("Stream buffer cycles through fenced segments") {
+  RecordingGlBackend backend;
+  ScopedGlBackend scoped_backend(backend);
+
+  StreamBuffer buffer(GL_ARRAY_BUFFER, 100, 16);
+  CHECK(buffer.is_persistent());
+  CHECK(buffer.get_segment_size() == 112);
+
+  const float values[4] = {1.f, 2.f, 3.f, 4.f};
+  std::size_t offsets[4];
+  for (std::size_t &offset : offsets) {
+    offset = buffer.write(values, sizeof(values));
+    buffer.end_frame();
+  }
+  // One segment per frame, back to the first one
+  CHECK(offsets[0] == 0);
+  CHECK(offsets[1] == 112);
+  CHECK(offsets[2] == 224);
+  CHECK(offsets[3] == 0);
+
+  // Mapped once, written without any upload call
+  CHECK(backend.count("map_buffer_range") == 1);
+  CHECK(backend.count("buffer_sub_data") == 0);
+  CHECK(backend.count("fence_sync") == 4);
+  const auto &data = backend.get_buffer_data(buffer.get_id());
+  float second = 0.f;
+  std::memcpy(&second, data.data() + 112 + sizeof(float), sizeof(float));
+  CHECK(second == 2.f);
+
+  // Writes in the same frame are packed with the alignment
+  std::size_t first = buffer.write(values, 4);
+  std::size_t next = buffer.write(values, 4);
+  CHECK(next - first == 16);
+
+  // Polls never wait
+  for (const auto &call : backend.filter("client_wait_sync"))
+    CHECK(call.arguments[1] == 0);
+  CHECK(backend.errors.empty());
+}
+
+TEST_CASE("Stream buffer never waits on a busy GPU") {
+  RecordingGlBackend backend;
+  backend.fences_signaled = false;
+  ScopedGlBackend scoped_backend(backend);
+
+  StreamBuffer buffer(GL_ARRAY_BUFFER, 64);
+  const std::uint8_t bytes[32] = {};
+  for (int frame = 0; frame < 6; ++frame) {
+    buffer.write(bytes, sizeof(bytes));
+    buffer.end_frame();
+  }
+  // Each time the ring wraps, the busy segment is replaced
+  CHECK(buffer.get_orphan_count() > 0);
+  CHECK(backend.errors.empty());
+}
+
+TEST_CASE("Stream buffer maps each write without buffer storage") {
+  RecordingGlBackend backend;
+  backend.minor_version = 3;
+  ScopedGlBackend scoped_backend(backend);
+
+  StreamBuffer buffer(GL_UNIFORM_BUFFER, 64);
+  CHECK_FALSE(buffer.is_persistent());
+  const std::uint8_t bytes[256] = {};
+  buffer.write(bytes, sizeof(bytes)); // Grows the segments
+  CHECK(buffer.get_segment_size() >= sizeof(bytes));
+  buffer.end_frame();
+
+  auto maps = backend.filter("map_buffer_range");
+  REQUIRE(maps.size() == 1);
+  CHECK((maps[0].arguments[3] & GL_MAP_UNSYNCHRONIZED_BIT) != 0);
+  CHECK(backend.errors.empty());
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "gl_backend.hpp"
+
+// Buffer for data rewritten every frame (particles, instance data, uniform
+// blocks). It is split into segment_count segments used in turn, one per
+// frame, and each segment is fenced once the draws reading it are issued.
+// With GL 4.4 the storage is immutable and mapped once (persistent, coherent),
+// older contexts map each write unsynchronized. A segment still in use by the
+// GPU when its turn comes back is replaced by a fresh allocation instead of
+// waiting, so writing never blocks the CPU.
+class StreamBuffer {
+public:
+  static constexpr int segment_count = 3;
+
+  // Offsets returned by write are multiples of alignment (vertex stride,
+  // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT...)
+  StreamBuffer(GLenum target, std::size_t segment_size,
+               std::size_t alignment = 1);
+  ~StreamBuffer();
+
+  // Empêcher la copie
+  StreamBuffer(const StreamBuffer &) = delete;
+  StreamBuffer &operator=(const StreamBuffer &) = delete;
+
+  // Copy the data into the current segment and return its offset in the
+  // buffer. A full segment makes the storage grow, which changes
+  // get_generation() and invalidates the offsets returned earlier in the
+  // frame.
+  std::size_t write(const void *data, std::size_t size);
+
+  // Fence the current segment, once the draws reading it are issued, and
+  // move to the next one
+  void end_frame();
+
+  GLuint get_id() const { return m_id; }
+  // Incremented with each new storage (growth or orphaning). The driver may
+  // hand the deleted name back, so comparing get_id() is not enough to know
+  // whether the attributes still point at the current storage
+  std::uint64_t get_generation() const { return m_generation; }
+  GLenum get_target() const { return m_target; }
+  bool is_persistent() const { return m_persistent; }
+  std::size_t get_segment_size() const { return m_segment_size; }
+  // Allocations made because the GPU was still reading the next segment
+  int get_orphan_count() const { return m_orphan_count; }
+
+private:
+  GLenum m_target;
+  std::size_t m_alignment;
+  std::size_t m_segment_size;
+  bool m_persistent;
+
+  GLuint m_id = 0;
+  std::uint64_t m_generation = 0;
+  std::uint8_t *m_mapped = nullptr; // Whole buffer, persistent storage only
+  int m_segment = 0;
+  std::size_t m_offset = 0; // Bytes used in the current segment
+  std::array<GLsync, segment_count> m_fences{};
+  int m_orphan_count = 0;
+
+  // Create the storage, releasing the previous one
+  void allocate();
+  void release();
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+// One triangle OBJ in the temporary directory for the tests, removed with
+// the object
+class TestModelFile {
+public:
+  explicit TestModelFile(const std::string &name)
+      : m_path(std::filesystem::temp_directory_path() / name) {
+    std::ofstream(m_path) << "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n";
+  }
+  ~TestModelFile() { std::filesystem::remove(m_path); }
+
+  // Empêcher la copie
+  TestModelFile(const TestModelFile &) = delete;
+  TestModelFile &operator=(const TestModelFile &) = delete;
+
+  const std::filesystem::path &get_path() const { return m_path; }
+
+private:
+  std::filesystem::path m_path;
+};
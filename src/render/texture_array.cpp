@@ -0,0 +1,211 @@
+#include "texture_array.hpp"
+#include "gl_backend.hpp"
+#include "recording_gl_backend.hpp"
+#include "texture_manager.hpp"
+#include "doctest/doctest.h"
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <utility>
+
+namespace {
+
+constexpr const char *layers_key = "layers"; // One source path per line
+
+bool is_baked_array(const std::filesystem::path &path) {
+  return path.extension() == ".ktx" &&
+         path.filename().string().starts_with("array_");
+}
+
+} // namespace
+
+TextureArray::TextureArray(const CompressedTexture &texture)
+    : m_layer_count(texture.layer_count) {
+  auto names = texture.key_values.find(layers_key);
+  if (names != texture.key_values.end()) {
+    std::istringstream lines(names->second);
+    std::string path;
+    for (int layer = 0; std::getline(lines, path); ++layer)
+      m_layers.emplace(path, layer);
+  }
+
+  m_id = gl().gen_texture();
+  gl().bind_texture(GL_TEXTURE_2D_ARRAY, m_id);
+  GLsizei width = texture.width;
+  GLsizei height = texture.height;
+  for (std::size_t level = 0; level < texture.levels.size(); ++level) {
+    gl().compressed_tex_image_3d(
+        GL_TEXTURE_2D_ARRAY, static_cast<GLint>(level),
+        texture.internal_format, width, height, m_layer_count,
+        static_cast<GLsizei>(texture.levels[level].size()),
+        texture.levels[level].data());
+    width = std::max(1, width / 2);
+    height = std::max(1, height / 2);
+  }
+  gl().tex_parameter_i(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL,
+                       static_cast<GLint>(texture.levels.size()) - 1);
+
+  gl().tex_parameter_i(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+                       GL_LINEAR_MIPMAP_LINEAR);
+  gl().tex_parameter_i(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  gl().tex_parameter_i(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  gl().tex_parameter_i(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+  gl().bind_texture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+TextureArray::~TextureArray() { gl().delete_texture(m_id); }
+
+void TextureArray::bind() const {
+  gl().active_texture(GL_TEXTURE0 + texture_unit);
+  gl().bind_texture(GL_TEXTURE_2D_ARRAY, m_id);
+  gl().active_texture(GL_TEXTURE0);
+}
+
+int TextureArray::layer_of(const std::string &texture_path) const {
+  auto it = m_layers.find(texture_path);
+  return it == m_layers.end() ? -1 : it->second;
+}
+
+int TextureArray::bake(const std::vector<std::string> &texture_paths,
+                       const std::filesystem::path &directory) {
+  // Arrays of an earlier bake may group other sizes
+  std::filesystem::create_directories(directory);
+  for (const auto &entry : std::filesystem::directory_iterator(directory)) {
+    if (is_baked_array(entry.path()))
+      std::filesystem::remove(entry.path());
+  }
+
+  // Same size, same array: no layer is resampled
+  std::map<std::pair<int, int>, std::vector<std::string>> groups;
+  std::map<std::pair<int, int>, std::vector<TextureCompressor::Image>> images;
+  for (const std::string &path : texture_paths) {
+    bool packed = std::any_of(groups.begin(), groups.end(), [&](auto &group) {
+      return std::find(group.second.begin(), group.second.end(), path) !=
+             group.second.end();
+    });
+    if (packed)
+      continue;
+
+    img::Image source = p6::load_image_buffer(path);
+    TextureCompressor::Image image;
+    image.width = static_cast<int>(source.width());
+    image.height = static_cast<int>(source.height());
+    image.pixels.assign(source.data(),
+                        source.data() + 4 * image.width * image.height);
+    std::pair<int, int> size(image.width, image.height);
+    groups[size].push_back(path);
+    images[size].push_back(std::move(image));
+  }
+
+  int written = 0;
+  for (const auto &[size, paths] : groups) {
+    CompressedTexture texture = TextureCompressor::compress_array(images[size]);
+    std::string &names = texture.key_values[layers_key];
+    for (const std::string &path : paths)
+      names += path + "\n";
+
+    std::filesystem::path ktx_path =
+        directory / ("array_" + std::to_string(size.first) + "x" +
+                     std::to_string(size.second) + ".ktx");
+    if (TextureCompressor::write_ktx(ktx_path.string(), texture)) {
+      std::cout << "Packed " << paths.size() << " textures of " << size.first
+                << "x" << size.second << " -> " << ktx_path.string()
+                << std::endl;
+      ++written;
+    }
+  }
+  return written;
+}
+
+std::vector<std::unique_ptr<TextureArray>>
+TextureArray::load_baked(const std::filesystem::path &directory) {
+  std::vector<std::unique_ptr<TextureArray>> arrays;
+  std::error_code error;
+  if (!std::filesystem::is_directory(directory, error) ||
+      !TextureManager::has_extension("GL_EXT_texture_compression_s3tc"))
+    return arrays;
+
+  for (const auto &entry : std::filesystem::directory_iterator(directory)) {
+    if (!is_baked_array(entry.path()))
+      continue;
+    CompressedTexture texture;
+    if (!TextureCompressor::read_ktx(entry.path().string(), texture) ||
+        texture.layer_count == 0)
+      continue;
+
+    // An edited source makes the whole array stale
+    auto baked_time = entry.last_write_time();
+    std::istringstream lines(texture.key_values[layers_key]);
+    std::string path;
+    bool stale = false;
+    while (std::getline(lines, path)) {
+      stale = stale || std::filesystem::last_write_time(path, error) >
+                           baked_time;
+    }
+    if (stale) {
+      std::cerr << entry.path().string()
+                << " is older than its textures, run --bake-textures"
+                << std::endl;
+      continue;
+    }
+    arrays.push_back(std::make_unique<TextureArray>(texture));
+  }
+  return arrays;
+}
+
+TEST_CASE("Baked texture arrays keep their layers and names through KTX") {
+  const std::filesystem::path path =
+      std::filesystem::temp_directory_path() / "array_8x4.ktx";
+
+  std::vector<TextureCompressor::Image> layers(2);
+  for (std::size_t i = 0; i < layers.size(); ++i) {
+    layers[i].width = 8;
+    layers[i].height = 4;
+    layers[i].pixels.assign(8 * 4 * 4, static_cast<std::uint8_t>(100 * i));
+    for (std::size_t alpha = 3; alpha < layers[i].pixels.size(); alpha += 4)
+      layers[i].pixels[alpha] = 255;
+  }
+  CompressedTexture texture = TextureCompressor::compress_array(layers);
+  texture.key_values[layers_key] = "a.png\nb.png\n";
+  CHECK(texture.base_internal_format == GL_RGB); // Opaque, BC1
+  REQUIRE(TextureCompressor::write_ktx(path.string(), texture));
+
+  // Sizes the file cannot back are refused before anything is allocated
+  CompressedTexture corrupt = texture;
+  corrupt.width = 1 << 20;
+  REQUIRE(TextureCompressor::write_ktx(path.string(), corrupt));
+  CompressedTexture refused;
+  CHECK_FALSE(TextureCompressor::read_ktx(path.string(), refused));
+  corrupt.width = 16; // The levels hold 8x4 blocks
+  REQUIRE(TextureCompressor::write_ktx(path.string(), corrupt));
+  CHECK_FALSE(TextureCompressor::read_ktx(path.string(), refused));
+  REQUIRE(TextureCompressor::write_ktx(path.string(), texture));
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 4);
+  CHECK_FALSE(TextureCompressor::read_ktx(path.string(), refused));
+
+  CompressedTexture loaded;
+  REQUIRE(TextureCompressor::write_ktx(path.string(), texture));
+  REQUIRE(TextureCompressor::read_ktx(path.string(), loaded));
+  std::filesystem::remove(path);
+  CHECK(loaded.layer_count == 2);
+  CHECK(loaded.key_values == texture.key_values);
+  REQUIRE(loaded.levels.size() == 4); // 8x4, 4x2, 2x1, 1x1
+  CHECK(loaded.levels[0].size() == 2 * 2 * 8); // 2 blocks of 8 bytes a layer
+
+  RecordingGlBackend backend;
+  ScopedGlBackend scoped_backend(backend);
+  {
+    TextureArray array(loaded);
+    CHECK(array.get_layer_count() == 2);
+    CHECK(array.layer_of("a.png") == 0);
+    CHECK(array.layer_of("b.png") == 1);
+    CHECK(array.layer_of("c.png") == -1);
+    auto uploads = backend.filter("compressed_tex_image_3d");
+    REQUIRE(uploads.size() == 4);
+    CHECK(uploads[1].arguments[2] == 4); // Width of level 1
+    CHECK(uploads[1].arguments[4] == 2); // Layers
+  }
+  CHECK(backend.errors.empty());
+}
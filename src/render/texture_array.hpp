@@ -0,0 +1,51 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "p6/p6.h"
+#include "texture_compressor.hpp"
+
+// Several textures in the layers of one GL_TEXTURE_2D_ARRAY, so that a whole
+// set of objects can be drawn without rebinding textures. The arrays are
+// baked offline (--bake-textures): the textures are grouped by size, so each
+// layer keeps the resolution of its source and the mesh UVs stay valid, and
+// every group is written as a BC1/BC3 KTX array whose "layers" key lists the
+// source paths. Only the layer index has to be provided per vertex
+// (attribute 3).
+class TextureArray {
+public:
+  static constexpr GLuint texture_unit = 1;
+
+  // Upload a baked array, the layers are named by its "layers" key
+  explicit TextureArray(const CompressedTexture &texture);
+  ~TextureArray();
+
+  // Empêcher la copie
+  TextureArray(const TextureArray &) = delete;
+  TextureArray &operator=(const TextureArray &) = delete;
+
+  void bind() const;
+
+  // Layer holding the given texture, -1 if it was not packed
+  int layer_of(const std::string &texture_path) const;
+
+  GLuint get_id() const { return m_id; }
+  GLsizei get_layer_count() const { return m_layer_count; }
+
+  // Pack the textures into one KTX array per size in directory, returns the
+  // number of arrays written
+  static int bake(const std::vector<std::string> &texture_paths,
+                  const std::filesystem::path &directory);
+  // Arrays baked in directory, none when the GPU lacks S3TC or a source
+  // image was edited since
+  static std::vector<std::unique_ptr<TextureArray>>
+  load_baked(const std::filesystem::path &directory);
+
+private:
+  GLuint m_id = 0;
+  GLsizei m_layer_count = 0;
+  std::unordered_map<std::string, int> m_layers;
+};
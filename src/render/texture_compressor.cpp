@@ -0,0 +1,487 @@
+#include "texture_compressor.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <glm/glm.hpp>
+#include <iostream>
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+namespace {
+
+constexpr std::array<std::uint8_t, 12> ktx_identifier = {
+    0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+constexpr std::uint32_t ktx_endianness = 0x04030201;
+// Larger counts mean a corrupt file, not something to allocate
+constexpr std::uint32_t max_ktx_dimension = 16384;
+constexpr std::uint32_t max_ktx_array_elements = 2048;
+
+struct KtxHeader {
+  std::uint32_t endianness;
+  std::uint32_t gl_type;
+  std::uint32_t gl_type_size;
+  std::uint32_t gl_format;
+  std::uint32_t gl_internal_format;
+  std::uint32_t gl_base_internal_format;
+  std::uint32_t pixel_width;
+  std::uint32_t pixel_height;
+  std::uint32_t pixel_depth;
+  std::uint32_t number_of_array_elements;
+  std::uint32_t number_of_faces;
+  std::uint32_t number_of_mipmap_levels;
+  std::uint32_t bytes_of_key_value_data;
+};
+
+using Block = std::array<glm::vec4, 16>; // RGBA in [0, 255]
+
+// Fetch a 4x4 block, clamping at the borders for mips smaller than a block
+Block fetch_block(const TextureCompressor::Image &image, int block_x,
+                  int block_y) {
+  Block block;
+  for (int y = 0; y < 4; ++y) {
+    for (int x = 0; x < 4; ++x) {
+      int px = std::min(block_x * 4 + x, image.width - 1);
+      int py = std::min(block_y * 4 + y, image.height - 1);
+      const std::uint8_t *p = &image.pixels[4 * (py * image.width + px)];
+      block[4 * y + x] = glm::vec4(p[0], p[1], p[2], p[3]);
+    }
+  }
+  return block;
+}
+
+std::uint16_t to_565(const glm::vec3 &color) {
+  glm::vec3 c = glm::clamp(color, 0.f, 255.f);
+  auto r = static_cast<std::uint16_t>(c.r * 31.f / 255.f + 0.5f);
+  auto g = static_cast<std::uint16_t>(c.g * 63.f / 255.f + 0.5f);
+  auto b = static_cast<std::uint16_t>(c.b * 31.f / 255.f + 0.5f);
+  return static_cast<std::uint16_t>((r << 11) | (g << 5) | b);
+}
+
+glm::vec3 from_565(std::uint16_t color) {
+  int r = (color >> 11) & 31;
+  int g = (color >> 5) & 63;
+  int b = color & 31;
+  return glm::vec3((r << 3) | (r >> 2), (g << 2) | (g >> 4),
+                   (b << 3) | (b >> 2));
+}
+
+float squared_distance(const glm::vec3 &a, const glm::vec3 &b) {
+  glm::vec3 d = a - b;
+  return glm::dot(d, d);
+}
+
+void put_u16(std::uint8_t *out, std::uint16_t value) {
+  out[0] = static_cast<std::uint8_t>(value & 0xFF);
+  out[1] = static_cast<std::uint8_t>(value >> 8);
+}
+
+// Endpoints are the extremes of the block projected on its principal axis
+void encode_color_block(const Block &block, std::uint8_t *out) {
+  glm::vec3 mean(0.f);
+  for (const auto &p : block)
+    mean += glm::vec3(p);
+  mean /= 16.f;
+
+  float cov[6] = {0, 0, 0, 0, 0, 0};
+  for (const auto &p : block) {
+    glm::vec3 d = glm::vec3(p) - mean;
+    cov[0] += d.r * d.r;
+    cov[1] += d.r * d.g;
+    cov[2] += d.r * d.b;
+    cov[3] += d.g * d.g;
+    cov[4] += d.g * d.b;
+    cov[5] += d.b * d.b;
+  }
+
+  // A few power iterations are enough for a 3x3 covariance matrix
+  glm::vec3 axis(1.f, 1.f, 1.f);
+  for (int i = 0; i < 4; ++i) {
+    glm::vec3 next(cov[0] * axis.r + cov[1] * axis.g + cov[2] * axis.b,
+                   cov[1] * axis.r + cov[3] * axis.g + cov[4] * axis.b,
+                   cov[2] * axis.r + cov[4] * axis.g + cov[5] * axis.b);
+    float len = glm::length(next);
+    if (len < 1e-6f)
+      break;
+    axis = next / len;
+  }
+
+  float min_t = 0.f;
+  float max_t = 0.f;
+  for (const auto &p : block) {
+    float t = glm::dot(glm::vec3(p) - mean, axis);
+    min_t = std::min(min_t, t);
+    max_t = std::max(max_t, t);
+  }
+
+  std::uint16_t c0 = to_565(mean + axis * max_t);
+  std::uint16_t c1 = to_565(mean + axis * min_t);
+  if (c0 < c1)
+    std::swap(c0, c1);
+
+  std::uint32_t indices = 0;
+  if (c0 != c1) {
+    // Four-color mode (c0 > c1)
+    glm::vec3 e0 = from_565(c0);
+    glm::vec3 e1 = from_565(c1);
+    std::array<glm::vec3, 4> palette = {e0, e1, (2.f * e0 + e1) / 3.f,
+                                        (e0 + 2.f * e1) / 3.f};
+    for (int i = 0; i < 16; ++i) {
+      glm::vec3 color(block[i]);
+      std::uint32_t best = 0;
+      float best_distance = squared_distance(color, palette[0]);
+      for (std::uint32_t j = 1; j < 4; ++j) {
+        float d = squared_distance(color, palette[j]);
+        if (d < best_distance) {
+          best_distance = d;
+          best = j;
+        }
+      }
+      indices |= best << (2 * i);
+    }
+  }
+
+  put_u16(out, c0);
+  put_u16(out + 2, c1);
+  std::memcpy(out + 4, &indices, 4);
+}
+
+void encode_alpha_block(const Block &block, std::uint8_t *out) {
+  float a0 = 0.f;
+  float a1 = 255.f;
+  for (const auto &p : block) {
+    a0 = std::max(a0, p.a);
+    a1 = std::min(a1, p.a);
+  }
+
+  // Eight-value mode (a0 > a1): palette[0] = a0, palette[1] = a1, then the
+  // six interpolated values
+  std::array<float, 8> palette{};
+  palette[0] = a0;
+  palette[1] = a1;
+  for (int i = 1; i <= 6; ++i)
+    palette[i + 1] = ((7 - i) * a0 + i * a1) / 7.f;
+
+  std::uint64_t bits = 0;
+  if (a0 > a1) {
+    for (int i = 0; i < 16; ++i) {
+      std::uint64_t best = 0;
+      float best_distance = std::abs(block[i].a - palette[0]);
+      for (std::uint64_t j = 1; j < 8; ++j) {
+        float d = std::abs(block[i].a - palette[j]);
+        if (d < best_distance) {
+          best_distance = d;
+          best = j;
+        }
+      }
+      bits |= best << (3 * i);
+    }
+  }
+
+  out[0] = static_cast<std::uint8_t>(a0);
+  out[1] = static_cast<std::uint8_t>(a1);
+  for (int i = 0; i < 6; ++i)
+    out[2 + i] = static_cast<std::uint8_t>((bits >> (8 * i)) & 0xFF);
+}
+
+bool has_alpha(const TextureCompressor::Image &image) {
+  for (std::size_t i = 3; i < image.pixels.size(); i += 4) {
+    if (image.pixels[i] != 255)
+      return true;
+  }
+  return false;
+}
+
+} // namespace
+
+std::vector<TextureCompressor::Image>
+TextureCompressor::generate_mip_chain(const Image &base) {
+  std::vector<Image> chain{base};
+
+  while (chain.back().width > 1 || chain.back().height > 1) {
+    const Image &src = chain.back();
+    Image dst;
+    dst.width = std::max(1, src.width / 2);
+    dst.height = std::max(1, src.height / 2);
+    dst.pixels.resize(4 * dst.width * dst.height);
+
+    for (int y = 0; y < dst.height; ++y) {
+      for (int x = 0; x < dst.width; ++x) {
+        int x0 = std::min(2 * x, src.width - 1);
+        int x1 = std::min(2 * x + 1, src.width - 1);
+        int y0 = std::min(2 * y, src.height - 1);
+        int y1 = std::min(2 * y + 1, src.height - 1);
+        for (int c = 0; c < 4; ++c) {
+          int sum = src.pixels[4 * (y0 * src.width + x0) + c] +
+                    src.pixels[4 * (y0 * src.width + x1) + c] +
+                    src.pixels[4 * (y1 * src.width + x0) + c] +
+                    src.pixels[4 * (y1 * src.width + x1) + c];
+          dst.pixels[4 * (y * dst.width + x) + c] =
+              static_cast<std::uint8_t>((sum + 2) / 4);
+        }
+      }
+    }
+    chain.push_back(std::move(dst));
+  }
+
+  return chain;
+}
+
+std::vector<std::uint8_t> TextureCompressor::compress_bc1(const Image &image) {
+  int blocks_x = (image.width + 3) / 4;
+  int blocks_y = (image.height + 3) / 4;
+  std::vector<std::uint8_t> data(8 * blocks_x * blocks_y);
+
+  for (int by = 0; by < blocks_y; ++by) {
+    for (int bx = 0; bx < blocks_x; ++bx) {
+      encode_color_block(fetch_block(image, bx, by),
+                         &data[8 * (by * blocks_x + bx)]);
+    }
+  }
+  return data;
+}
+
+std::vector<std::uint8_t> TextureCompressor::compress_bc3(const Image &image) {
+  int blocks_x = (image.width + 3) / 4;
+  int blocks_y = (image.height + 3) / 4;
+  std::vector<std::uint8_t> data(16 * blocks_x * blocks_y);
+
+  for (int by = 0; by < blocks_y; ++by) {
+    for (int bx = 0; bx < blocks_x; ++bx) {
+      Block block = fetch_block(image, bx, by);
+      std::uint8_t *out = &data[16 * (by * blocks_x + bx)];
+      encode_alpha_block(block, out);
+      encode_color_block(block, out + 8);
+    }
+  }
+  return data;
+}
+
+CompressedTexture TextureCompressor::compress(const Image &base) {
+  bool alpha = has_alpha(base);
+
+  CompressedTexture texture;
+  texture.internal_format = alpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+                                  : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+  texture.base_internal_format = alpha ? GL_RGBA : GL_RGB;
+  texture.width = base.width;
+  texture.height = base.height;
+
+  for (const Image &level : generate_mip_chain(base)) {
+    texture.levels.push_back(alpha ? compress_bc3(level) : compress_bc1(level));
+  }
+  return texture;
+}
+
+CompressedTexture
+TextureCompressor::compress_array(const std::vector<Image> &layers) {
+  bool alpha = std::any_of(layers.begin(), layers.end(), has_alpha);
+
+  CompressedTexture texture;
+  texture.internal_format = alpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+                                  : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+  texture.base_internal_format = alpha ? GL_RGBA : GL_RGB;
+  texture.width = layers.front().width;
+  texture.height = layers.front().height;
+  texture.layer_count = static_cast<GLsizei>(layers.size());
+
+  for (const Image &layer : layers) {
+    std::vector<Image> chain = generate_mip_chain(layer);
+    texture.levels.resize(chain.size());
+    for (std::size_t level = 0; level < chain.size(); ++level) {
+      std::vector<std::uint8_t> blocks = alpha ? compress_bc3(chain[level])
+                                               : compress_bc1(chain[level]);
+      texture.levels[level].insert(texture.levels[level].end(),
+                                   blocks.begin(), blocks.end());
+    }
+  }
+  return texture;
+}
+
+bool TextureCompressor::write_ktx(const std::string &file_path,
+                                  const CompressedTexture &texture) {
+  std::ofstream file(file_path, std::ios::binary);
+  if (!file) {
+    std::cerr << "Cannot write KTX file: " << file_path << std::endl;
+    return false;
+  }
+
+  KtxHeader header{};
+  header.endianness = ktx_endianness;
+  header.gl_type_size = 1;
+  header.gl_internal_format = texture.internal_format;
+  header.gl_base_internal_format = texture.base_internal_format;
+  header.pixel_width = static_cast<std::uint32_t>(texture.width);
+  header.pixel_height = static_cast<std::uint32_t>(texture.height);
+  header.number_of_array_elements =
+      static_cast<std::uint32_t>(texture.layer_count);
+  header.number_of_faces = 1;
+  header.number_of_mipmap_levels =
+      static_cast<std::uint32_t>(texture.levels.size());
+
+  // "key\0value\0", each pair padded to 4 bytes
+  std::vector<char> key_values;
+  for (const auto &[key, value] : texture.key_values) {
+    auto size = static_cast<std::uint32_t>(key.size() + value.size() + 2);
+    const char *size_bytes = reinterpret_cast<const char *>(&size);
+    key_values.insert(key_values.end(), size_bytes, size_bytes + 4);
+    key_values.insert(key_values.end(), key.begin(), key.end());
+    key_values.push_back('\0');
+    key_values.insert(key_values.end(), value.begin(), value.end());
+    key_values.push_back('\0');
+    key_values.resize((key_values.size() + 3) / 4 * 4, '\0');
+  }
+  header.bytes_of_key_value_data =
+      static_cast<std::uint32_t>(key_values.size());
+
+  file.write(reinterpret_cast<const char *>(ktx_identifier.data()),
+             ktx_identifier.size());
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(key_values.data(),
+             static_cast<std::streamsize>(key_values.size()));
+
+  // Block payloads are multiples of 8 bytes, no mip padding needed
+  for (const auto &level : texture.levels) {
+    auto image_size = static_cast<std::uint32_t>(level.size());
+    file.write(reinterpret_cast<const char *>(&image_size), 4);
+    file.write(reinterpret_cast<const char *>(level.data()), image_size);
+  }
+
+  return static_cast<bool>(file);
+}
+
+bool TextureCompressor::read_ktx(const std::string &file_path,
+                                 CompressedTexture &texture) {
+  std::ifstream file(file_path, std::ios::binary);
+  if (!file)
+    return false;
+
+  std::array<std::uint8_t, 12> identifier{};
+  KtxHeader header{};
+  file.read(reinterpret_cast<char *>(identifier.data()), identifier.size());
+  file.read(reinterpret_cast<char *>(&header), sizeof(header));
+
+  const bool bc1 =
+      header.gl_internal_format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+  if (!file || identifier != ktx_identifier ||
+      header.endianness != ktx_endianness || header.gl_type != 0 ||
+      header.number_of_faces != 1 ||
+      (!bc1 && header.gl_internal_format != GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)) {
+    std::cerr << "Unsupported KTX file: " << file_path << std::endl;
+    return false;
+  }
+
+  // Every count is checked before it sizes a buffer or a loop
+  std::error_code error;
+  const std::uintmax_t file_size = std::filesystem::file_size(file_path, error);
+  const std::uint32_t largest =
+      std::max(header.pixel_width, header.pixel_height);
+  if (error || header.pixel_width == 0 || header.pixel_height == 0 ||
+      largest > max_ktx_dimension ||
+      header.number_of_array_elements > max_ktx_array_elements ||
+      header.number_of_mipmap_levels > std::bit_width(largest) ||
+      header.bytes_of_key_value_data > file_size) {
+    std::cerr << "Invalid KTX file: " << file_path << std::endl;
+    return false;
+  }
+
+  std::vector<char> key_values(header.bytes_of_key_value_data);
+  if (!file.read(key_values.data(),
+                 static_cast<std::streamsize>(key_values.size()))) {
+    std::cerr << "Truncated KTX file: " << file_path << std::endl;
+    return false;
+  }
+  texture.key_values.clear();
+  for (std::size_t offset = 0; offset + 4 <= key_values.size();) {
+    std::uint32_t size = 0;
+    std::memcpy(&size, key_values.data() + offset, 4);
+    offset += 4;
+    if (size > key_values.size() - offset)
+      break;
+    // The key ends at the first null byte, the value may have its own
+    std::string pair(key_values.data() + offset, size);
+    std::size_t end = pair.find('\0');
+    if (end != std::string::npos) {
+      std::string value = pair.substr(end + 1);
+      if (!value.empty() && value.back() == '\0')
+        value.pop_back();
+      texture.key_values[pair.substr(0, end)] = value;
+    }
+    offset += (size + 3) / 4 * 4;
+  }
+
+  texture.internal_format = header.gl_internal_format;
+  texture.base_internal_format = header.gl_base_internal_format;
+  texture.width = static_cast<GLsizei>(header.pixel_width);
+  texture.height = static_cast<GLsizei>(header.pixel_height);
+  texture.layer_count =
+      static_cast<GLsizei>(header.number_of_array_elements);
+  texture.levels.assign(std::max(1u, header.number_of_mipmap_levels), {});
+
+  // A level holds its 4x4 blocks for every layer, nothing else
+  std::uint64_t width = header.pixel_width;
+  std::uint64_t height = header.pixel_height;
+  const std::uint64_t layers = std::max(1u, header.number_of_array_elements);
+  for (auto &level : texture.levels) {
+    const std::uint64_t expected_size =
+        (width + 3) / 4 * ((height + 3) / 4) * (bc1 ? 8 : 16) * layers;
+    std::uint32_t image_size = 0;
+    if (!file.read(reinterpret_cast<char *>(&image_size), 4)) {
+      std::cerr << "Truncated KTX file: " << file_path << std::endl;
+      return false;
+    }
+    if (image_size != expected_size || image_size > file_size) {
+      std::cerr << "Invalid KTX file: " << file_path << std::endl;
+      return false;
+    }
+    level.resize(image_size);
+    if (!file.read(reinterpret_cast<char *>(level.data()), image_size)) {
+      std::cerr << "Truncated KTX file: " << file_path << std::endl;
+      return false;
+    }
+    file.seekg((4 - image_size % 4) % 4, std::ios::cur);
+    width = std::max<std::uint64_t>(1, width / 2);
+    height = std::max<std::uint64_t>(1, height / 2);
+  }
+  return true;
+}
+
+std::filesystem::path
+TextureCompressor::ktx_path_for(const std::string &file_path) {
+  return std::filesystem::path(file_path).replace_extension(".ktx");
+}
+
+int TextureCompressor::bake_directory(const std::string &directory) {
+  int written = 0;
+
+  for (const auto &entry : std::filesystem::directory_iterator(directory)) {
+    std::string extension = entry.path().extension().string();
+    if (extension != ".png" && extension != ".jpg")
+      continue;
+
+    std::string path = entry.path().string();
+    img::Image source = p6::load_image_buffer(path);
+
+    Image base;
+    base.width = static_cast<int>(source.width());
+    base.height = static_cast<int>(source.height());
+    base.pixels.assign(source.data(), source.data() + 4 * base.width *
+                                                          base.height);
+
+    CompressedTexture texture = compress(base);
+    std::string ktx_path = ktx_path_for(path).string();
+    if (write_ktx(ktx_path, texture)) {
+      std::cout << "Baked " << path << " -> " << ktx_path << " ("
+                << texture.levels.size() << " levels)" << std::endl;
+      ++written;
+    }
+  }
+
+  return written;
+}
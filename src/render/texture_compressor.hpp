@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+#include "p6/p6.h"
+
+// GPU block-compressed texture with its full mip chain, as stored in a KTX file
+struct CompressedTexture {
+  GLenum internal_format = 0;      // GL_COMPRESSED_RGB(A)_S3TC_DXT*_EXT
+  GLenum base_internal_format = 0; // GL_RGB or GL_RGBA
+  GLsizei width = 0;
+  GLsizei height = 0;
+  GLsizei layer_count = 0; // Array layers, 0 for a plain 2D texture
+  // One payload per mip level, every layer of an array one after the other
+  std::vector<std::vector<std::uint8_t>> levels;
+  std::map<std::string, std::string> key_values; // KTX metadata
+};
+
+// Offline conversion of PNG/JPG textures into KTX containers holding BC1
+// (opaque) or BC3 (with alpha) payloads, encoded on the CPU.
+class TextureCompressor {
+public:
+  // Tightly packed RGBA8 image
+  struct Image {
+    int width = 0;
+    int height = 0;
+    std::vector<std::uint8_t> pixels;
+  };
+
+  // Build the full mip chain (down to 1x1) with a 2x2 box filter
+  static std::vector<Image> generate_mip_chain(const Image &base);
+
+  // Encode an RGBA8 image into 4x4 blocks (8 bytes per BC1 block, 16 per BC3)
+  static std::vector<std::uint8_t> compress_bc1(const Image &image);
+  static std::vector<std::uint8_t> compress_bc3(const Image &image);
+
+  static CompressedTexture compress(const Image &base);
+  // Layers of the same size, BC3 for all of them if one has alpha
+  static CompressedTexture compress_array(const std::vector<Image> &layers);
+
+  // KTX 1.1 container IO, returns false on failure
+  static bool write_ktx(const std::string &file_path,
+                        const CompressedTexture &texture);
+  static bool read_ktx(const std::string &file_path,
+                       CompressedTexture &texture);
+
+  // Path of the compressed sibling of a texture ("x/foo.png" -> "x/foo.ktx")
+  static std::filesystem::path ktx_path_for(const std::string &file_path);
+
+  // Convert every PNG/JPG of a directory, returns the number of files written
+  static int bake_directory(const std::string &directory);
+};
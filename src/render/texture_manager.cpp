@@ -1,32 +1,79 @@
 #include "texture_manager.hpp"
+#include "gl_backend.hpp"
+#include "texture_compressor.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+#ifndef GL_TEXTURE_MAX_ANISOTROPY_EXT
+#define GL_TEXTURE_MAX_ANISOTROPY_EXT 0x84FE
+#endif
+#ifndef GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT
+#define GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT 0x84FF
+#endif
 
 GLuint TextureManager::load_texture(const std::string &file_path) {
+  static const bool s3tc_supported =
+      has_extension("GL_EXT_texture_compression_s3tc");
+
+  // Use the baked texture unless the source image was edited since
+  std::filesystem::path ktx_path = TextureCompressor::ktx_path_for(file_path);
+  std::error_code error;
+  if (s3tc_supported && std::filesystem::exists(ktx_path, error) &&
+      std::filesystem::last_write_time(ktx_path, error) >=
+          std::filesystem::last_write_time(file_path, error)) {
+    GLuint texture_object = load_compressed_texture(ktx_path.string());
+    if (texture_object != 0)
+      return texture_object;
+  }
+
+  return load_image_texture(file_path);
+}
+
+GLuint TextureManager::load_compressed_texture(const std::string &ktx_path) {
+  CompressedTexture texture;
+  if (!TextureCompressor::read_ktx(ktx_path, texture))
+    return 0;
+
+  GLuint texture_object = gl().gen_texture();
+  gl().bind_texture(GL_TEXTURE_2D, texture_object);
+
+  GLsizei width = texture.width;
+  GLsizei height = texture.height;
+  for (std::size_t level = 0; level < texture.levels.size(); ++level) {
+    gl().compressed_tex_image_2d(
+        GL_TEXTURE_2D, static_cast<GLint>(level), texture.internal_format,
+        width, height, static_cast<GLsizei>(texture.levels[level].size()),
+        texture.levels[level].data());
+    width = std::max(1, width / 2);
+    height = std::max(1, height / 2);
+  }
+  gl().tex_parameter_i(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+                        static_cast<GLint>(texture.levels.size()) - 1);
+
+  set_sampling_parameters();
+  unbind_texture();
+
+  return texture_object;
+}
+
+GLuint TextureManager::load_image_texture(const std::string &file_path) {
   // Load image from file
   img::Image texture_image = p6::load_image_buffer(file_path);
 
   // Generate the OpenGL texture object
-  GLuint texture_object = 0;
-  glGenTextures(1, &texture_object);
-  glBindTexture(GL_TEXTURE_2D, texture_object);
+  GLuint texture_object = gl().gen_texture();
+  gl().bind_texture(GL_TEXTURE_2D, texture_object);
 
   // Configure texture settings
   GLsizei width = static_cast<GLsizei>(texture_image.width());
   GLsizei height = static_cast<GLsizei>(texture_image.height());
 
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
-               GL_UNSIGNED_BYTE, texture_image.data());
-
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  gl().tex_image_2d(GL_TEXTURE_2D, 0, GL_RGBA, width, height, GL_RGBA,
+                    GL_UNSIGNED_BYTE, texture_image.data());
+  gl().generate_mipmap(GL_TEXTURE_2D);
 
-  // Répéter la texture en S (horizontal)
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-
-  // Répéter la texture en T (vertical)
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-  //   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  //   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  set_sampling_parameters();
 
   // Unbind the texture
   unbind_texture();
@@ -34,9 +81,45 @@ GLuint TextureManager::load_texture(const std::string &file_path) {
   return texture_object;
 }
 
+void TextureManager::set_sampling_parameters() {
+  static const bool anisotropy_supported =
+      has_extension("GL_EXT_texture_filter_anisotropic") ||
+      has_extension("GL_ARB_texture_filter_anisotropic");
+
+  gl().tex_parameter_i(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                        GL_LINEAR_MIPMAP_LINEAR);
+  gl().tex_parameter_i(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  if (anisotropy_supported) {
+    GLfloat max_anisotropy =
+        gl().get_float(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT);
+    gl().tex_parameter_f(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT,
+                         std::min(8.f, max_anisotropy));
+  }
+
+  // Répéter la texture en S (horizontal)
+  gl().tex_parameter_i(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+
+  // Répéter la texture en T (vertical)
+  gl().tex_parameter_i(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+}
+
+bool TextureManager::has_extension(const char *name) {
+  GLint extension_count = gl().get_integer(GL_NUM_EXTENSIONS);
+  for (GLint i = 0; i < extension_count; ++i) {
+    const char *extension =
+        gl().get_string_i(GL_EXTENSIONS, static_cast<GLuint>(i));
+    if (extension != nullptr && std::strcmp(extension, name) == 0)
+      return true;
+  }
+  return false;
+}
+
 void TextureManager::bind_texture(GLuint texture_id, GLuint texture_unit) {
-  glActiveTexture(GL_TEXTURE0 + texture_unit);
-  glBindTexture(GL_TEXTURE_2D, texture_id);
+  gl().active_texture(GL_TEXTURE0 + texture_unit);
+  gl().bind_texture(GL_TEXTURE_2D, texture_id);
 }
 
-void TextureManager::unbind_texture() { glBindTexture(GL_TEXTURE_2D, 0); }
+void TextureManager::unbind_texture() {
+  gl().bind_texture(GL_TEXTURE_2D, 0);
+}
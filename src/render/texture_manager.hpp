@@ -7,7 +7,10 @@ class TextureManager {
 public:
     TextureManager() = default;
 
-    // Load a texture from a file and return its OpenGL identifier
+    // Load a texture from a file and return its OpenGL identifier.
+    // A baked KTX sibling (see TextureCompressor) is preferred when it is up to
+    // date and the driver supports S3TC, otherwise the image is uploaded as
+    // RGBA8 and its mipmaps are generated on the GPU.
     static GLuint load_texture(const std::string& file_path);
 
     // Bind the texture to the specified texture unit
@@ -15,4 +18,14 @@ public:
 
     // Unbind the current texture
     static void unbind_texture();
+
+    // Whether the driver reports the extension
+    static bool has_extension(const char* name);
+
+private:
+    static GLuint load_compressed_texture(const std::string& ktx_path);
+    static GLuint load_image_texture(const std::string& file_path);
+
+    // Trilinear filtering, anisotropic when the driver supports it
+    static void set_sampling_parameters();
 };
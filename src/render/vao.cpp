@@ -2,28 +2,34 @@
 #include <iostream>
 
 VAO::VAO() {
-  glGenVertexArrays(1, &id);
-  if (glGetError() != GL_NO_ERROR) {
+  id = gl().gen_vertex_array();
+  if (gl().get_error() != GL_NO_ERROR) {
     std::cerr << "Error generating VAO" << std::endl;
   }
 }
 
-VAO::~VAO() { glDeleteVertexArrays(1, &id); }
+VAO::~VAO() { gl().delete_vertex_array(id); }
 
-void VAO::bind() const { glBindVertexArray(id); }
+void VAO::bind() const { gl().bind_vertex_array(id); }
 
-void VAO::unbind() const { glBindVertexArray(0); }
+void VAO::unbind() const { gl().bind_vertex_array(0); }
 
 void VAO::specify_attribute(GLuint index, GLint size, GLenum type,
                             GLboolean normalized, GLsizei stride,
                             const GLvoid *pointer) {
   bind();
-  glEnableVertexAttribArray(index);
-  glVertexAttribPointer(index, size, type, normalized, stride, pointer);
-  if (glGetError() != GL_NO_ERROR) {
+  gl().enable_vertex_attrib_array(index);
+  gl().vertex_attrib_pointer(index, size, type, normalized, stride, pointer);
+  if (gl().get_error() != GL_NO_ERROR) {
     std::cerr << "Error specifying vertex attribute" << std::endl;
   }
   unbind();
 }
 
+void VAO::set_divisor(GLuint index, GLuint divisor) {
+  bind();
+  gl().vertex_attrib_divisor(index, divisor);
+  unbind();
+}
+
 GLuint VAO::get_id() const { return id; }
\ No newline at end of file
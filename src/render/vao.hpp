@@ -1,6 +1,6 @@
 #pragma once
 
-#include "p6/p6.h"
+#include "gl_backend.hpp"
 #include <cstddef>
 
 class VAO {
@@ -17,6 +17,8 @@ public:
   void specify_attribute(GLuint index, GLint size, GLenum type,
                          GLboolean normalized, GLsizei stride,
                          const GLvoid *pointer);
+  // Advance the attribute once per divisor instances instead of per vertex
+  void set_divisor(GLuint index, GLuint divisor);
   GLuint get_id() const;
 
 private:
@@ -2,30 +2,30 @@
 #include <iostream>
 
 VBO::VBO() {
-  glGenBuffers(1, &id);
-  if (glGetError() != GL_NO_ERROR) {
+  id = gl().gen_buffer();
+  if (gl().get_error() != GL_NO_ERROR) {
     std::cerr << "Error generating VBO" << std::endl;
   }
 }
 
-VBO::~VBO() { glDeleteBuffers(1, &id); }
+VBO::~VBO() { gl().delete_buffer(id); }
 
-void VBO::bind() const { glBindBuffer(GL_ARRAY_BUFFER, id); }
+void VBO::bind() const { gl().bind_buffer(GL_ARRAY_BUFFER, id); }
 
-void VBO::unbind() const { glBindBuffer(GL_ARRAY_BUFFER, 0); }
+void VBO::unbind() const { gl().bind_buffer(GL_ARRAY_BUFFER, 0); }
 
 void VBO::fill(const void *data, GLsizei size, GLenum usage) {
   bind();
-  glBufferData(GL_ARRAY_BUFFER, size, data, usage);
-  if (glGetError() != GL_NO_ERROR) {
+  gl().buffer_data(GL_ARRAY_BUFFER, size, data, usage);
+  if (gl().get_error() != GL_NO_ERROR) {
     std::cerr << "Error filling VBO" << std::endl;
   }
 }
 
 void VBO::update(const void *data, GLsizei size, GLintptr offset) {
   bind();
-  glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
-  if (glGetError() != GL_NO_ERROR) {
+  gl().buffer_sub_data(GL_ARRAY_BUFFER, offset, size, data);
+  if (gl().get_error() != GL_NO_ERROR) {
     std::cerr << "Error updating VBO" << std::endl;
   }
 }
@@ -1,6 +1,6 @@
 #pragma once
 
-#include "p6/p6.h"
+#include "gl_backend.hpp"
 
 class VBO {
 public:
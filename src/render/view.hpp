@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cmath>
+#include <glm/glm.hpp>
+#include "maths/bounds.hpp"
+#include "maths/frustum.hpp"
+
+// Camera state of a frame, as needed for culling and LOD selection
+struct View {
+  glm::mat4 view_matrix;
+  glm::mat4 proj_matrix;
+  Frustum frustum;
+  glm::vec3 camera_position;
+
+  View(const glm::mat4 &view, const glm::mat4 &proj)
+      : view_matrix(view), proj_matrix(proj), frustum(proj * view),
+        camera_position(glm::inverse(view)[3]) {}
+
+  // Distance along the view direction, used to sort draws
+  float depth_of(const glm::vec3 &point) const {
+    return -(view_matrix * glm::vec4(point, 1.f)).z;
+  }
+
+  // Projected radius of a sphere, in half viewport heights
+  float screen_size(const BoundingSphere &sphere) const {
+    float distance = glm::length(sphere.center - camera_position);
+    if (distance <= sphere.radius)
+      return INFINITY; // The camera is inside
+    return sphere.radius * proj_matrix[1][1] / distance;
+  }
+};
@@ -0,0 +1,179 @@
+#include "session_log.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+#include <utility>
+#include "doctest/doctest.h"
+
+namespace {
+
+constexpr char magic[4] = {'B', 'C', 'S', 'L'};
+// Longer scene paths mean a corrupt file, not a string to allocate
+constexpr std::uint32_t max_path_size = 4096;
+
+template <typename T> void write_value(std::ostream &stream, const T &value) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  stream.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T> bool read_value(std::istream &stream, T &value) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  return static_cast<bool>(
+      stream.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+
+} // namespace
+
+void SessionLog::add_frame(const TrackballCamera::State &camera) {
+  m_frames.push_back(
+      {camera, static_cast<std::uint32_t>(m_events.size()), 0});
+}
+
+void SessionLog::add_event(const Event &event) {
+  if (m_frames.empty())
+    return; // Before the first frame
+  m_events.push_back(event);
+  ++m_frames.back().event_count;
+}
+
+std::span<const SessionLog::Event>
+SessionLog::get_events(std::size_t frame) const {
+  const Frame &record = m_frames[frame];
+  return {m_events.data() + record.first_event, record.event_count};
+}
+
+bool SessionLog::save(const std::string &path) const {
+  std::ofstream file(path, std::ios::binary);
+  if (!file) {
+    std::cerr << "Could not write the session " << path << std::endl;
+    return false;
+  }
+
+  file.write(magic, sizeof(magic));
+  write_value(file, version);
+  write_value(file, m_seed);
+  write_value(file, static_cast<std::uint32_t>(m_scene_path.size()));
+  file.write(m_scene_path.data(),
+             static_cast<std::streamsize>(m_scene_path.size()));
+
+  write_value(file, static_cast<std::uint32_t>(m_frames.size()));
+  for (const Frame &frame : m_frames) {
+    write_value(file, frame.camera);
+    write_value(file, frame.event_count);
+    for (const Event &event : get_events(&frame - m_frames.data())) {
+      write_value(file, event.type);
+      write_value(file, event.value);
+      write_value(file, event.position);
+    }
+  }
+  return static_cast<bool>(file);
+}
+
+bool SessionLog::load(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    std::cerr << "Cannot open session file: " << path << std::endl;
+    return false;
+  }
+
+  char file_magic[4] = {};
+  std::uint32_t file_version = 0;
+  file.read(file_magic, sizeof(file_magic));
+  if (!file || !std::equal(file_magic, file_magic + 4, magic) ||
+      !read_value(file, file_version) || file_version != version) {
+    std::cerr << "Invalid session file " << path << std::endl;
+    return false;
+  }
+
+  SessionLog log;
+  std::uint32_t path_size = 0;
+  std::uint32_t frame_count = 0;
+  bool valid = read_value(file, log.m_seed) && read_value(file, path_size);
+  bool corrupt = valid && path_size > max_path_size;
+  valid = valid && !corrupt;
+  log.m_scene_path.resize(valid ? path_size : 0);
+  valid = valid && file.read(log.m_scene_path.data(), path_size) &&
+          read_value(file, frame_count);
+  for (std::uint32_t i = 0; valid && i < frame_count; ++i) {
+    TrackballCamera::State camera;
+    std::uint32_t event_count = 0;
+    valid = read_value(file, camera) && read_value(file, event_count);
+    log.add_frame(camera);
+    for (std::uint32_t j = 0; valid && j < event_count; ++j) {
+      Event event;
+      valid = read_value(file, event.type) && read_value(file, event.value) &&
+              read_value(file, event.position);
+      corrupt = valid && event.type > EventType::Spawn;
+      valid = valid && !corrupt;
+      log.add_event(event);
+    }
+  }
+  if (!valid) {
+    std::cerr << (corrupt ? "Invalid" : "Truncated") << " session file "
+              << path << std::endl;
+    return false;
+  }
+
+  *this = std::move(log);
+  return true;
+}
+
+TEST_CASE("Session log keeps frames and events through a file") {
+  const std::filesystem::path path =
+      std::filesystem::temp_directory_path() / "session_log_test.bin";
+
+  SessionLog log;
+  log.set_seed(0x1234567890ULL);
+  log.set_scene_path("assets/scenes/station.json");
+  for (int frame = 0; frame < 100; ++frame) {
+    log.add_frame({glm::vec3(frame, 2.f, 3.f), 100.f, 0.1f * frame, 0.f});
+    if (frame % 10 == 0)
+      log.add_event({SessionLog::EventType::Spawn, frame / 10,
+                     glm::vec3(-50.f, -50.f, frame)});
+  }
+  log.add_event({SessionLog::EventType::Key, 84});
+  REQUIRE(log.save(path.string()));
+
+  SessionLog loaded;
+  REQUIRE(loaded.load(path.string()));
+  CHECK(loaded.get_seed() == log.get_seed());
+  CHECK(loaded.get_scene_path() == log.get_scene_path());
+  REQUIRE(loaded.get_frame_count() == 100);
+  CHECK(loaded.get_camera(42).center.x == 42.f);
+  CHECK(loaded.get_camera(42).angle_x == log.get_camera(42).angle_x);
+  REQUIRE(loaded.get_events(30).size() == 1);
+  CHECK(loaded.get_events(30)[0].value == 3);
+  CHECK(loaded.get_events(30)[0].position.z == 30.f);
+  CHECK(loaded.get_events(31).empty());
+  REQUIRE(loaded.get_events(99).size() == 1);
+  CHECK(loaded.get_events(99)[0].type == SessionLog::EventType::Key);
+
+  // Truncated files are refused and leave the log unchanged
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) / 2);
+  CHECK_FALSE(loaded.load(path.string()));
+  CHECK(loaded.get_frame_count() == 100);
+
+  // So are a scene path size or an event type out of range
+  SessionLog single;
+  single.add_frame({});
+  single.add_event({SessionLog::EventType::Key, 84});
+  const std::streamoff path_size_offset = 4 + 4 + 8; // Magic, version, seed
+  const std::streamoff type_offset =
+      path_size_offset + 4 + 4 + sizeof(TrackballCamera::State) + 4;
+  auto corrupt = [&](std::streamoff offset, const auto &value) {
+    REQUIRE(single.save(path.string()));
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(offset);
+    write_value(file, value);
+  };
+  corrupt(path_size_offset, std::uint32_t(0xFFFFFFF0));
+  CHECK_FALSE(loaded.load(path.string()));
+  corrupt(type_offset, std::uint8_t(7));
+  CHECK_FALSE(loaded.load(path.string()));
+  corrupt(type_offset, std::uint8_t(SessionLog::EventType::Spawn));
+  CHECK(loaded.load(path.string()));
+  CHECK(loaded.get_events(0)[0].type == SessionLog::EventType::Spawn);
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "glimac/trackball_camera.hpp"
+
+// Everything needed to play a show again, frame for frame: the fireworks
+// seed, the camera of every frame and what happened during it (keys, picks,
+// shells launched). The simulation steps once per frame, so a replay runs
+// the same ticks whatever the frame rate. Saved as a small binary file in
+// the native byte order, about 30 bytes per frame.
+class SessionLog {
+public:
+  static constexpr std::uint32_t version = 1;
+
+  enum class EventType : std::uint8_t {
+    Key = 0,   // value: GLFW key code
+    Pick = 1,  // position.xy: cursor in normalized device coordinates
+    Spawn = 2, // value: emitter, position: launch point
+  };
+
+  struct Event {
+    EventType type;
+    std::int32_t value = 0;
+    glm::vec3 position{0.f};
+  };
+
+  void set_seed(std::uint64_t seed) { m_seed = seed; }
+  std::uint64_t get_seed() const { return m_seed; }
+  void set_scene_path(const std::string &path) { m_scene_path = path; }
+  const std::string &get_scene_path() const { return m_scene_path; }
+
+  // Recording: a frame, then the events that happened during it. Events
+  // before the first frame are dropped
+  void add_frame(const TrackballCamera::State &camera);
+  void add_event(const Event &event);
+
+  std::size_t get_frame_count() const { return m_frames.size(); }
+  const TrackballCamera::State &get_camera(std::size_t frame) const {
+    return m_frames[frame].camera;
+  }
+  std::span<const Event> get_events(std::size_t frame) const;
+
+  bool save(const std::string &path) const;
+  bool load(const std::string &path);
+
+private:
+  struct Frame {
+    TrackballCamera::State camera;
+    std::uint32_t first_event; // In m_events
+    std::uint32_t event_count;
+  };
+
+  std::uint64_t m_seed = 0;
+  std::string m_scene_path;
+  std::vector<Frame> m_frames;
+  std::vector<Event> m_events;
+};
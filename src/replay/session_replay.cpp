@@ -0,0 +1,77 @@
+#include "session_replay.hpp"
+#include <algorithm>
+#include <chrono>
+#include "doctest/doctest.h"
+
+bool same_spawns(
+    std::span<const SessionLog::Event> events,
+    const std::vector<FireworkSimulation::Snapshot::Spawn> &spawns) {
+  std::size_t matched = 0;
+  for (const SessionLog::Event &event : events) {
+    if (event.type != SessionLog::EventType::Spawn)
+      continue;
+    if (matched == spawns.size() ||
+        static_cast<std::uint32_t>(event.value) != spawns[matched].emitter ||
+        event.position != spawns[matched].position)
+      return false;
+    ++matched;
+  }
+  return matched == spawns.size();
+}
+
+HeadlessReplay replay_headless(const SessionLog &log,
+                               const std::vector<FireworkEmitter> &emitters) {
+  // Without the worker, next_frame() times the tick itself
+  FireworkSimulation simulation(emitters, log.get_seed(), false);
+  HeadlessReplay replay;
+  replay.frames = log.get_frame_count();
+
+  double total_ms = 0.0;
+  for (std::size_t frame = 0; frame < log.get_frame_count(); ++frame) {
+    auto start = std::chrono::steady_clock::now();
+    const FireworkSimulation::Snapshot &snapshot = simulation.next_frame();
+    double ms = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+
+    total_ms += ms;
+    if (ms > replay.worst_ms) {
+      replay.worst_ms = ms;
+      replay.worst_frame = frame;
+    }
+    if (!replay.first_divergence &&
+        !same_spawns(log.get_events(frame), snapshot.spawns))
+      replay.first_divergence = frame;
+  }
+  if (replay.frames > 0)
+    replay.average_ms = total_ms / static_cast<double>(replay.frames);
+  return replay;
+}
+
+TEST_CASE("A recorded show replays without diverging") {
+  std::vector<FireworkEmitter> emitters(2);
+  emitters[0].spawn_chance = 0.3f;
+
+  // Recorded through the threaded simulation, as the application does
+  SessionLog log;
+  log.set_seed(99);
+  {
+    FireworkSimulation simulation(emitters, log.get_seed());
+    for (int frame = 0; frame < 300; ++frame) {
+      log.add_frame({});
+      for (const auto &spawn : simulation.next_frame().spawns)
+        log.add_event({SessionLog::EventType::Spawn,
+                       static_cast<std::int32_t>(spawn.emitter),
+                       spawn.position});
+    }
+  }
+
+  HeadlessReplay replay = replay_headless(log, emitters);
+  CHECK(replay.frames == 300);
+  CHECK_FALSE(replay.first_divergence.has_value());
+  CHECK(replay.worst_ms >= replay.average_ms);
+
+  // Another show (seed) is detected
+  log.set_seed(100);
+  CHECK(replay_headless(log, emitters).first_divergence.has_value());
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <vector>
+#include "scene_objects/firework_simulation.hpp"
+#include "session_log.hpp"
+
+// Spawn events of a frame against the shells launched by its tick, a
+// mismatch means the simulation diverged from the recording
+bool same_spawns(
+    std::span<const SessionLog::Event> events,
+    const std::vector<FireworkSimulation::Snapshot::Spawn> &spawns);
+
+// Simulation of every frame of a log without a window nor GL, each tick
+// timed on its own: the benchmark of the simulation on a recorded show
+struct HeadlessReplay {
+  std::size_t frames = 0;
+  std::optional<std::size_t> first_divergence; // Frame, if any
+  double average_ms = 0.0;
+  double worst_ms = 0.0;
+  std::size_t worst_frame = 0;
+};
+
+HeadlessReplay replay_headless(const SessionLog &log,
+                               const std::vector<FireworkEmitter> &emitters);
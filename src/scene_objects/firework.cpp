@@ -1,47 +1,37 @@
 #include "firework.hpp"
-#include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
 #include "../maths/color.hpp"
-#include <iostream>
-
-Firework::Firework()
-    : m_color(generate_vivid_color()),
-      firework(glm::linearRand(-100.f, 0.f), -50.f,
-               glm::linearRand(-150.f, 150.f), m_color),
-      m_vao(std::make_unique<VAO>()), m_vbo(std::make_unique<VBO>()) {
-
-  m_vao->bind();
-  m_vbo->bind();
-
-  glm::vec3 point(0.0f, 0.0f, 0.0f);
-  m_vbo->fill(&point, sizeof(glm::vec3), GL_STATIC_DRAW);
-
-  m_vao->specify_attribute(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3),
-                           (void *)0);
-
-  m_vbo->unbind();
-  m_vao->unbind();
+#include "../profiling/trace.hpp"
+#include <algorithm>
+
+Firework::Firework(const FireworkEmitter &emitter, RandomStream random)
+    : m_random(random), m_color(generate_vivid_color(m_random)),
+      firework(launch_shell(emitter, m_color, m_random)) {}
+
+Particle Firework::launch_shell(const FireworkEmitter &emitter,
+                                const glm::vec3 &color, RandomStream &random) {
+  // One draw per statement, the draws stay in the same order everywhere
+  float x = random.uniform(emitter.x_range.x, emitter.x_range.y);
+  float z = random.uniform(emitter.z_range.x, emitter.z_range.y);
+  return Particle(x, emitter.launch_height, z, color, random);
 }
 
 bool Firework::done() const { return firework.is_dead() && particles.empty(); }
 
-void Firework::run(const glm::vec3 &gravity, const Program &program,
-                   const glm::mat4 &view_matrix, const glm::mat4 &proj_matrix) {
-  program.use(); // Utilisation du programme pour l'exécution
-  m_vao->bind(); // Bind du VAO pour toutes les opérations
-
+bool Firework::update(const glm::vec3 &gravity) {
+  TraceScope trace("Firework::update");
+  bool exploded = false;
   if (!firework.is_dead()) {
     firework.apply_force(gravity);
     firework.update();
     if (firework.explode()) {
+      exploded = true;
+
       // Générer les particules après l'explosion
       for (int i = 0; i < 500; ++i) {
-        particles.push_back(Particle(firework.location, firework.m_color));
+        particles.push_back(
+            Particle(firework.location, firework.m_color, m_random));
       }
     }
-    glUniform1i(program.u_is_seed, 1);
-    draw_particle(firework, program, view_matrix, proj_matrix);
-    glUniform1i(program.u_is_seed, 0);
   }
 
   // Mise à jour des particules et suppression des particules mortes
@@ -52,38 +42,39 @@ void Firework::run(const glm::vec3 &gravity, const Program &program,
     if (it->is_dead()) {
       it = particles.erase(it); // Supprimer les particules mortes
     } else {
-      draw_particle(*it, program, view_matrix, proj_matrix);
       ++it;
     }
   }
 
-  m_vao->unbind(); // Unbind après avoir terminé
+  m_bounding_box = {firework.location, firework.location};
+  for (const Particle &particle : particles) {
+    m_bounding_box.min = glm::min(m_bounding_box.min, particle.location);
+    m_bounding_box.max = glm::max(m_bounding_box.max, particle.location);
+  }
+  // Marge pour la taille des sprites
+  m_bounding_box.min -= glm::vec3(1.f);
+  m_bounding_box.max += glm::vec3(1.f);
+  m_bounding_sphere = {m_bounding_box.center(),
+                       glm::length(m_bounding_box.max - m_bounding_box.min) *
+                           0.5f};
+  return exploded;
 }
 
-void Firework::draw_particle(const Particle &particle, const Program &program,
-                             const glm::mat4 &view_matrix,
-                             const glm::mat4 &proj_matrix) {
-  glm::mat4 model_matrix = glm::translate(glm::mat4(1.0f), particle.location);
-  glm::mat4 MV_matrix = view_matrix * model_matrix;
-  glm::mat4 MVP_matrix = proj_matrix * MV_matrix;
-
-  // Envoyer les matrices au shader
-  glUniformMatrix4fv(program.u_MVP_matrix, 1, GL_FALSE,
-                     glm::value_ptr(MVP_matrix));
-  glUniformMatrix4fv(program.u_MV_matrix, 1, GL_FALSE,
-                     glm::value_ptr(MV_matrix));
-
-  // Envoyer la couleur au shader
-  glm::vec3 color(particle.m_color.x, particle.m_color.y, particle.m_color.z);
-
-  glUniform3fv(program.u_color, 1, glm::value_ptr(color));
-
-  glUniform1i(program.u_use_color, 1);
-  glUniform1i(program.u_is_particle, 1);
-  glUniform1f(program.u_lifespan, particle.lifespan);
-
-  // Dessiner les particules (point unique)
-  glDrawArrays(GL_POINTS, 0, 1);
+void Firework::draw_burst(ParticleRenderer &renderer,
+                          const glm::vec3 &camera_position,
+                          const BoundingSphere &bounding_sphere,
+                          const Particle *shell,
+                          std::span<const Particle> sparks) {
+  if (shell) {
+    renderer.add(*shell);
+  }
 
-  glUniform1i(program.u_is_particle, 0);
+  float distance = std::max(
+      glm::length(bounding_sphere.center - camera_position) -
+          bounding_sphere.radius,
+      0.f);
+  ParticleRenderer::Lod lod = ParticleRenderer::lod_for(distance);
+  for (std::size_t i = 0; i < sparks.size(); i += lod.stride) {
+    renderer.add(sparks[i], lod.size_scale, lod.alpha_scale);
+  }
 }
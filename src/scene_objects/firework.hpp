@@ -1,15 +1,22 @@
 #pragma once
-#include "../render/program.hpp"
-#include "../render/vao.hpp"
-#include "../render/vbo.hpp"
+#include "../maths/bounds.hpp"
+#include "../render/particle_renderer.hpp"
 #include "particle.hpp"
-#include <glm/gtc/random.hpp>
-#include <memory>
+#include <span>
 #include <vector>
 
+// Where and how often shells are launched
+struct FireworkEmitter {
+  float spawn_chance = 0.2f; // Probability of a launch each frame
+  glm::vec2 x_range{-100.f, 0.f};
+  glm::vec2 z_range{-150.f, 150.f};
+  float launch_height = -50.f;
+};
+
 class Firework {
 public:
-  Firework();
+  // Every random draw of the firework, explosion included, comes from random
+  Firework(const FireworkEmitter &emitter, RandomStream random);
 
   // Empêcher la copie
   Firework(const Firework &) = delete;
@@ -22,17 +29,37 @@ public:
   ~Firework() = default;
 
   bool done() const;
-  void run(const glm::vec3 &gravity, const Program &program,
-           const glm::mat4 &view_matrix, const glm::mat4 &proj_matrix);
+  // Simulation step, true on the step the shell explodes
+  bool update(const glm::vec3 &gravity);
+
+  // Queue a shell (null once exploded) and its sparks, far bursts only send
+  // a subset (see ParticleRenderer::lod_for). Used by the snapshots of
+  // FireworkSimulation
+  static void draw_burst(ParticleRenderer &renderer,
+                         const glm::vec3 &camera_position,
+                         const BoundingSphere &bounding_sphere,
+                         const Particle *shell,
+                         std::span<const Particle> sparks);
+
+  bool is_flying() const { return !firework.is_dead(); }
+  const Particle &get_shell() const { return firework; }
+  const std::vector<Particle> &get_sparks() const { return particles; }
+  const glm::vec3 &get_color() const { return m_color; }
+
+  // Bounds of the shell or its burst, as of the last update
+  const BoundingBox &get_bounding_box() const { return m_bounding_box; }
+  const BoundingSphere &get_bounding_sphere() const {
+    return m_bounding_sphere;
+  }
 
 private:
+  RandomStream m_random;
   glm::vec3 m_color;
   std::vector<Particle> particles;
   Particle firework;
-  std::unique_ptr<VAO> m_vao;
-  std::unique_ptr<VBO> m_vbo;
+  BoundingBox m_bounding_box;
+  BoundingSphere m_bounding_sphere;
 
-  void draw_particle(const Particle &particle, const Program &program,
-                     const glm::mat4 &view_matrix,
-                     const glm::mat4 &proj_matrix);
+  static Particle launch_shell(const FireworkEmitter &emitter,
+                               const glm::vec3 &color, RandomStream &random);
 };
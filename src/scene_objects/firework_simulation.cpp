@@ -0,0 +1,183 @@
+#include "firework_simulation.hpp"
+#include <utility>
+#include "../profiling/trace.hpp"
+#include "doctest/doctest.h"
+
+void FireworkSimulation::Snapshot::draw(
+    const Burst &burst, ParticleRenderer &renderer,
+    const glm::vec3 &camera_position) const {
+  const Particle *shell = burst.has_shell ? &particles[burst.first] : nullptr;
+  std::span<const Particle> sparks(particles.data() + burst.first +
+                                       (burst.has_shell ? 1 : 0),
+                                   burst.count);
+  Firework::draw_burst(renderer, camera_position, burst.bounding_sphere,
+                       shell, sparks);
+}
+
+FireworkSimulation::FireworkSimulation(std::vector<FireworkEmitter> emitters,
+                                       std::uint64_t seed, bool threaded)
+    : m_emitters(std::move(emitters)) {
+  for (std::size_t i = 0; i < m_emitters.size(); ++i)
+    m_emitter_randoms.emplace_back(seed, i);
+  if (threaded)
+    m_worker = std::thread(&FireworkSimulation::run_worker, this);
+}
+
+FireworkSimulation::~FireworkSimulation() {
+  if (!m_worker.joinable())
+    return;
+  {
+    std::lock_guard lock(m_mutex);
+    m_stopping = true;
+  }
+  m_condition.notify_all();
+  m_worker.join();
+}
+
+void FireworkSimulation::run_worker() {
+  Tracer::set_thread_name("simulation");
+  std::unique_lock lock(m_mutex);
+  while (true) {
+    m_condition.wait(lock, [this]() { return m_tick_requested || m_stopping; });
+    if (m_stopping)
+      return;
+
+    // The GL thread only reads the front snapshot meanwhile
+    Snapshot &snapshot = m_snapshots[m_front ^ 1];
+    lock.unlock();
+    tick(snapshot);
+    lock.lock();
+    m_tick_requested = false;
+    m_condition.notify_all();
+  }
+}
+
+void FireworkSimulation::request_tick() {
+  if (!m_worker.joinable()) {
+    tick(m_snapshots[m_front ^ 1]);
+    return;
+  }
+  {
+    std::lock_guard lock(m_mutex);
+    m_tick_requested = true;
+  }
+  m_condition.notify_all();
+}
+
+void FireworkSimulation::wait_for_tick() {
+  std::unique_lock lock(m_mutex);
+  m_condition.wait(lock, [this]() { return !m_tick_requested; });
+}
+
+const FireworkSimulation::Snapshot &FireworkSimulation::next_frame() {
+  if (!m_started) {
+    m_started = true;
+    request_tick();
+  }
+  wait_for_tick();
+  m_front ^= 1;
+  request_tick();
+  return m_snapshots[m_front];
+}
+
+std::size_t FireworkSimulation::get_firework_count() const {
+  return m_snapshots[m_front].bursts.size();
+}
+
+void FireworkSimulation::tick(Snapshot &snapshot) {
+  TraceScope trace("simulation tick");
+  snapshot.flashes.clear();
+  snapshot.spawns.clear();
+  for (std::size_t i = 0; i < m_emitters.size(); ++i) {
+    RandomStream &random = m_emitter_randoms[i];
+    if (random.uniform(0.f, 1.f) < m_emitters[i].spawn_chance) {
+      m_fireworks.emplace_back(m_emitters[i], random.fork());
+      snapshot.spawns.push_back({static_cast<std::uint32_t>(i),
+                                 m_fireworks.back().get_shell().location});
+    }
+  }
+
+  for (auto it = m_fireworks.begin(); it != m_fireworks.end();) {
+    if (it->update(gravity)) {
+      snapshot.flashes.push_back({it->get_shell().location, it->get_color()});
+    }
+    if (it->done()) {
+      it = m_fireworks.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  // Copie de l'état à dessiner, the capacity is kept from tick to tick
+  snapshot.bursts.clear();
+  snapshot.particles.clear();
+  for (const Firework &firework : m_fireworks) {
+    Snapshot::Burst burst;
+    burst.bounding_box = firework.get_bounding_box();
+    burst.bounding_sphere = firework.get_bounding_sphere();
+    burst.first = snapshot.particles.size();
+    burst.has_shell = firework.is_flying();
+    if (burst.has_shell)
+      snapshot.particles.push_back(firework.get_shell());
+    const std::vector<Particle> &sparks = firework.get_sparks();
+    snapshot.particles.insert(snapshot.particles.end(), sparks.begin(),
+                              sparks.end());
+    burst.count = sparks.size();
+    snapshot.bursts.push_back(burst);
+  }
+}
+
+TEST_CASE("Firework simulation returns one tick per frame, threaded or not") {
+  for (bool threaded : {false, true}) {
+    CAPTURE(threaded);
+    FireworkEmitter emitter;
+    emitter.spawn_chance = 1.f; // One shell per tick
+    FireworkSimulation simulation({emitter}, 1, threaded);
+
+    std::size_t flashes = 0;
+    for (std::size_t frame = 0; frame < 120; ++frame) {
+      const FireworkSimulation::Snapshot &snapshot = simulation.next_frame();
+      // Shells explode after 40 ticks at the earliest
+      if (frame < 20) {
+        CHECK(snapshot.bursts.size() == frame + 1);
+        CHECK(snapshot.particles.size() == frame + 1);
+      }
+      flashes += snapshot.flashes.size();
+
+      std::size_t end = 0;
+      for (const auto &burst : snapshot.bursts) {
+        CHECK(burst.first == end);
+        end = burst.first + burst.count + (burst.has_shell ? 1 : 0);
+      }
+      CHECK(end == snapshot.particles.size());
+    }
+    CHECK(flashes > 0);
+    CHECK(simulation.get_firework_count() > 0);
+  }
+}
+
+TEST_CASE("A seed gives the same fireworks, threaded or not") {
+  std::vector<FireworkEmitter> emitters(3);
+  emitters[1].spawn_chance = 0.5f;
+  FireworkSimulation inline_simulation(emitters, 1234, false);
+  FireworkSimulation threaded_simulation(emitters, 1234, true);
+  FireworkSimulation other_seed(emitters, 1235, false);
+
+  std::size_t mismatches = 0;
+  bool differs = false;
+  for (int tick = 0; tick < 200; ++tick) {
+    const auto &expected = inline_simulation.next_frame();
+    const auto &actual = threaded_simulation.next_frame();
+    const auto &other = other_seed.next_frame();
+    REQUIRE(actual.particles.size() == expected.particles.size());
+    for (std::size_t i = 0; i < expected.particles.size(); ++i) {
+      const Particle &a = actual.particles[i];
+      const Particle &b = expected.particles[i];
+      mismatches += a.location != b.location || a.velocity != b.velocity ||
+                    a.m_color != b.m_color || a.lifespan != b.lifespan;
+    }
+    differs |= other.particles.size() != expected.particles.size();
+  }
+  CHECK(mismatches == 0);
+  CHECK(differs);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <glm/glm.hpp>
+#include "../maths/bounds.hpp"
+#include "../maths/random_stream.hpp"
+#include "../render/particle_renderer.hpp"
+#include "firework.hpp"
+#include "particle.hpp"
+
+// Spawns and steps the fireworks on a worker thread, one frame ahead of the
+// rendering: while the GL thread draws the snapshot of tick N the worker
+// computes tick N+1 into the other snapshot. next_frame() waits for that
+// tick, swaps the snapshots and starts the following one, so the frame
+// costs the longest of simulation and submission instead of their sum, for
+// one frame of latency. Without a worker every tick runs inside
+// next_frame(). Each emitter draws from its own RandomStream and gives each
+// firework it spawns a stream of its own: a seed and a tick count always
+// give the same particles, bit for bit, threaded or not.
+class FireworkSimulation {
+public:
+  // Render state of the fireworks after a tick
+  struct Snapshot {
+    struct Burst {
+      BoundingBox bounding_box;
+      BoundingSphere bounding_sphere;
+      std::size_t first = 0; // The shell while it flies, then the sparks
+      std::size_t count = 0;
+      bool has_shell = false;
+    };
+    struct Flash {
+      glm::vec3 position;
+      glm::vec3 color;
+    };
+    struct Spawn {
+      std::uint32_t emitter;
+      glm::vec3 position; // Launch point
+    };
+
+    std::vector<Burst> bursts;
+    std::vector<Particle> particles; // Of every burst, one after the other
+    std::vector<Flash> flashes;      // Explosions of the tick
+    std::vector<Spawn> spawns;       // Shells launched by the tick
+
+    void draw(const Burst &burst, ParticleRenderer &renderer,
+              const glm::vec3 &camera_position) const;
+  };
+
+  static constexpr glm::vec3 gravity{0.f, -0.1f, 0.f};
+
+  FireworkSimulation(std::vector<FireworkEmitter> emitters,
+                     std::uint64_t seed, bool threaded = true);
+  ~FireworkSimulation();
+
+  // Empêcher la copie
+  FireworkSimulation(const FireworkSimulation &) = delete;
+  FireworkSimulation &operator=(const FireworkSimulation &) = delete;
+
+  // Snapshot of the next tick, valid until the following call. Only the
+  // first call waits for a whole tick
+  const Snapshot &next_frame();
+
+  std::size_t get_firework_count() const;
+
+private:
+  std::vector<FireworkEmitter> m_emitters;
+  std::vector<RandomStream> m_emitter_randoms; // One per emitter
+  std::vector<Firework> m_fireworks; // Owned by the tick in progress
+  Snapshot m_snapshots[2];
+  int m_front = 0; // Read by the GL thread, the other one is written
+
+  std::thread m_worker;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  bool m_tick_requested = false; // Guarded by m_mutex
+  bool m_stopping = false;
+  bool m_started = false;
+
+  void tick(Snapshot &snapshot);
+  void run_worker();
+  void wait_for_tick();
+  void request_tick();
+};
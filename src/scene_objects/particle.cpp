@@ -1,17 +1,18 @@
 #include "particle.hpp"
-#include "glm/gtc/random.hpp"
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-Particle::Particle(float x, float y, float z, glm::vec3 color)
+Particle::Particle(float x, float y, float z, glm::vec3 color,
+                   RandomStream &random)
     : location(x, y, z), m_color(color), lifespan(255.0), seed(true) {
-  velocity = glm::vec3(0, glm::linearRand(4.f, 8.f), 0);
+  velocity = glm::vec3(0, random.uniform(4.f, 8.f), 0);
   acceleration = glm::vec3(0, 0, 0);
 }
 
-Particle::Particle(glm::vec3 loc, glm::vec3 color)
+Particle::Particle(glm::vec3 loc, glm::vec3 color, RandomStream &random)
     : location(loc), m_color(color), lifespan(255.0), seed(false) {
-  velocity = glm::ballRand(1.0f) * glm::linearRand(1.f, 3.f);
+  velocity = random.in_ball(1.0f);
+  velocity *= random.uniform(1.f, 3.f);
   acceleration = glm::vec3(0, 0, 0);
 }
 
@@ -21,7 +22,7 @@ void Particle::update() {
   velocity += acceleration;
   location += velocity;
   if (!seed) {
-    lifespan -= 2.5f;
+    lifespan -= lifespan_decay;
     velocity *= 0.90f; // Réduction de la vitesse au fil du temps
   }
   acceleration = glm::vec3(0, 0, 0); // Réinitialise l'accélération
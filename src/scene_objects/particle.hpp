@@ -1,9 +1,12 @@
 #pragma once
 #include "../render/program.hpp"
 #include "glm/glm.hpp"
+#include "../maths/random_stream.hpp"
 
 class Particle {
 public:
+  static constexpr float lifespan_decay = 2.5f; // Par frame, après l'explosion
+
   glm::vec3 location;
   glm::vec3 velocity;
   glm::vec3 acceleration;
@@ -12,8 +15,10 @@ public:
   bool
       seed; // Indique si la particule est une "graine" (feu d'artifice initial)
 
-  Particle(float x, float y, float z, glm::vec3 color);
-  Particle(glm::vec3 loc, glm::vec3 color);
+  // Shell launched upwards
+  Particle(float x, float y, float z, glm::vec3 color, RandomStream &random);
+  // Spark of an explosion, in a random direction
+  Particle(glm::vec3 loc, glm::vec3 color, RandomStream &random);
 
   void apply_force(const glm::vec3 &force);
   void update();
@@ -0,0 +1,121 @@
+#include "scene.hpp"
+#include <limits>
+#include <map>
+
+namespace {
+
+// With a texture array, the texture is sampled from its layer
+std::unique_ptr<GameObject>
+create_object(const SceneLoader::Object &object, ModelCache &models,
+              const TextureArray *texture_array = nullptr) {
+  std::shared_ptr<const Model> model = models.load(object.model_path);
+  std::unique_ptr<GameObject> game_object;
+  if (object.color)
+    game_object = std::make_unique<GameObject>(model, *object.color);
+  else if (texture_array)
+    game_object = std::make_unique<GameObject>(model, *texture_array,
+                                               object.texture_path);
+  else
+    game_object = std::make_unique<GameObject>(model, object.texture_path);
+  game_object->set_position(object.position);
+  game_object->set_rotation(object.rotation);
+  game_object->set_scale(object.scale);
+  game_object->set_lighting_factors(object.material.diffuse,
+                                    object.material.specular,
+                                    object.material.shininess);
+  return game_object;
+}
+
+} // namespace
+
+Scene::Scene(const SceneLoader::Scene &description, ModelCache &models)
+    : m_static_textures(
+          TextureArray::load_baked(description.packed_textures_directory)),
+      m_lights(description.lights), m_emitters(description.emitters) {
+  for (const auto &object : description.objects) {
+    // Only objects whose texture is in a baked array can be batched
+    const TextureArray *texture_array = nullptr;
+    if (object.is_static && !object.color)
+      texture_array = find_texture_array(object.texture_path);
+    if (texture_array) {
+      m_static_objects.push_back(create_object(object, models, texture_array));
+      m_static_object_names.push_back(object.name);
+    } else {
+      m_objects.push_back(create_object(object, models));
+      m_object_names.push_back(object.name);
+    }
+  }
+
+  std::map<const Model *, int> model_uses;
+  for (const auto &object : m_objects)
+    ++model_uses[&object->get_model()];
+  for (const auto &object : m_objects) {
+    m_dynamic_boxes.push_back(object->get_world_box());
+    m_object_instanced.push_back(
+        model_uses[&object->get_model()] >= min_instances);
+  }
+  m_dynamic_bvh.build(m_dynamic_boxes);
+
+  if (m_static_objects.empty())
+    return;
+
+  std::vector<BoundingBox> static_boxes;
+  for (const auto &object : m_static_objects)
+    static_boxes.push_back(object->get_world_box());
+  m_static_bvh.build(static_boxes);
+
+  for (const auto &object : m_static_objects)
+    m_static_batch.add(*object);
+  m_static_batch.build();
+}
+
+const TextureArray *
+Scene::find_texture_array(const std::string &texture_path) const {
+  for (const auto &texture_array : m_static_textures) {
+    if (texture_array->layer_of(texture_path) >= 0)
+      return texture_array.get();
+  }
+  return nullptr;
+}
+
+void Scene::submit(RenderQueue &queue, Program &program, const View &view) {
+  m_object_bounds.clear();
+  for (std::size_t i = 0; i < m_objects.size(); ++i) {
+    m_object_bounds.push_back(m_objects[i]->get_world_sphere());
+    m_dynamic_boxes[i] = m_objects[i]->get_world_box();
+  }
+  view.frustum.cull(m_object_bounds, m_object_visible);
+  m_dynamic_bvh.refit(m_dynamic_boxes);
+
+  m_instance_renderer.clear();
+  for (std::size_t i = 0; i < m_objects.size(); ++i) {
+    if (!m_object_visible[i])
+      continue;
+    m_objects[i]->update_lod(view);
+    if (m_object_instanced[i]) {
+      m_instance_renderer.add(*m_objects[i], view);
+    } else {
+      m_objects[i]->submit(queue, program, view);
+    }
+  }
+  m_instance_renderer.submit(queue, program);
+
+  m_static_batch.submit(queue, program, view);
+}
+
+const std::string *Scene::pick(const glm::vec3 &origin,
+                               const glm::vec3 &direction) const {
+  constexpr float max_distance = std::numeric_limits<float>::max();
+  const std::string *name = nullptr;
+  float distance = max_distance;
+
+  Bvh::RayHit hit;
+  if (m_dynamic_bvh.ray_cast(origin, direction, distance, hit)) {
+    name = &m_object_names[hit.index];
+    distance = hit.distance;
+  }
+  if (m_static_bvh.ray_cast(origin, direction, distance, hit)) {
+    name = &m_static_object_names[hit.index];
+  }
+  return name;
+}
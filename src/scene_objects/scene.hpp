@@ -0,0 +1,76 @@
+#pragma once
+
+#include <memory>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "3D_loader/scene_loader.hpp"
+#include "maths/bvh.hpp"
+#include "render/game_object.hpp"
+#include "render/instance_renderer.hpp"
+#include "render/model_cache.hpp"
+#include "render/program.hpp"
+#include "render/render_queue.hpp"
+#include "render/static_batch.hpp"
+#include "render/texture_array.hpp"
+#include "render/view.hpp"
+
+// Runtime counterpart of a scene file: owns the GameObjects and merges the
+// static ones whose texture is in a baked TextureArray into a StaticBatch
+// (without arrays, see --bake-textures, they are drawn like the others). The
+// other objects sharing a mesh are drawn instanced. Both object sets are
+// indexed by a BVH for picking and overlap queries.
+class Scene {
+public:
+  // Dynamic objects sharing a Model, from which they are drawn instanced
+  static constexpr int min_instances = 2;
+
+  // The meshes are loaded through models, objects with the same file share
+  // one Model
+  Scene(const SceneLoader::Scene &description, ModelCache &models);
+
+  // Empêcher la copie
+  Scene(const Scene &) = delete;
+  Scene &operator=(const Scene &) = delete;
+
+  // Objects outside the frustum are not queued, the others pick their level
+  // of detail
+  void submit(RenderQueue &queue, Program &program, const View &view);
+  // Once the queue has been executed
+  void end_frame() { m_instance_renderer.end_frame(); }
+
+  // Name of the nearest object whose box the ray enters, nullptr if none
+  const std::string *pick(const glm::vec3 &origin,
+                          const glm::vec3 &direction) const;
+
+  const std::vector<SceneLoader::Light> &get_lights() const {
+    return m_lights;
+  }
+  const std::vector<FireworkEmitter> &get_emitters() const {
+    return m_emitters;
+  }
+
+private:
+  std::vector<std::unique_ptr<GameObject>> m_objects; // Drawn one by one...
+  std::vector<std::uint8_t> m_object_instanced;       // ...or instanced
+  std::vector<std::unique_ptr<GameObject>> m_static_objects;
+  std::vector<std::string> m_object_names;
+  std::vector<std::string> m_static_object_names;
+
+  Bvh m_static_bvh;  // Built once with SAH
+  Bvh m_dynamic_bvh; // Refit every frame
+  std::vector<BoundingBox> m_dynamic_boxes;
+  std::vector<std::unique_ptr<TextureArray>> m_static_textures;
+  StaticBatch m_static_batch;
+  InstanceRenderer m_instance_renderer;
+
+  // World bounds of m_objects, gathered every frame since they can move
+  SphereSet m_object_bounds;
+  std::vector<std::uint8_t> m_object_visible;
+
+  std::vector<SceneLoader::Light> m_lights;
+  std::vector<FireworkEmitter> m_emitters;
+
+  // Baked array holding the texture, nullptr if none
+  const TextureArray *find_texture_array(const std::string &texture_path) const;
+};
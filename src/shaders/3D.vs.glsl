@@ -4,33 +4,59 @@
 layout(location = 0) in vec3 a_vertex_position;      // Vertex position
 layout(location = 1) in vec3 a_vertex_normal;        // Vertex normal
 layout(location = 2) in vec2 a_vertex_tex_coords;    // Vertex texture coordinates
+layout(location = 3) in float a_vertex_tex_layer;    // Layer in the texture array (when packed)
+layout(location = 4) in vec3 a_particle_color;       // Particles only (see ParticleRenderer)
+layout(location = 5) in vec4 a_particle_data;        // lifespan, size scale, alpha scale, seed
+// Instanced draws only (see InstanceRenderer), one value per instance
+layout(location = 6) in mat4 a_instance_model;       // Model matrix, locations 6 to 9
+layout(location = 10) in mat3 a_instance_normal;     // Normal matrix, locations 10 to 12
+layout(location = 13) in vec4 a_instance_data;       // rgb: color, a: texture array layer
 
-// Transformation matrices passed as uniforms
-uniform mat4 u_MVP_matrix;       // Model-View-Projection matrix
-uniform mat4 u_MV_matrix;        // Model-View matrix
-uniform mat3 u_normal_matrix;    // Normal matrix for transforming normals
+// Per-frame constants, shared by every program (see FrameUniforms)
+layout(std140) uniform FrameData {
+    mat4 u_view_matrix;
+    mat4 u_proj_matrix;
+    mat4 u_view_proj_matrix;
+    ivec4 u_light_count;         // x: number of lights in u_light_buffer
+    ivec4 u_cluster_grid;        // Light grid, see tex_3D.fs.glsl
+    vec4 u_cluster_depth;
+};
+
+// Per-object transformation
+uniform mat4 u_model_matrix;     // Model matrix
+uniform mat3 u_normal_matrix;    // Normal matrix of the model matrix
 uniform bool u_is_particle;      // Indicates whether the current object is a particle
+uniform bool u_instanced;        // Take the transformation from the instance attributes
 
 // Outputs to the fragment shader
 out vec3 v_position_vs;          // Transformed vertex position in view space
 out vec3 v_normal_vs;            // Transformed vertex normal in view space
 out vec2 v_tex_coords;           // Texture coordinates
+flat out float v_tex_layer;      // Texture array layer
+flat out vec3 v_instance_color;  // Color of the instance, replaces u_color
+flat out vec3 v_particle_color;
+flat out vec4 v_particle_data;
 
 void main() {
+    mat4 model_matrix = u_instanced ? a_instance_model : u_model_matrix;
+    mat3 normal_matrix = u_instanced ? a_instance_normal : u_normal_matrix;
+
     // Convert position to homogeneous coordinates
-    vec4 vertex_position_hom = vec4(a_vertex_position, 1.0);
+    vec4 vertex_position_ws = model_matrix * vec4(a_vertex_position, 1.0);
+    v_position_vs = vec3(u_view_matrix * vertex_position_ws); // Transform position to view space
 
-    if(u_is_particle) {
-        // If it's a particle, we skip normals and textures
-        v_position_vs = vec3(u_MV_matrix * vertex_position_hom); // No transformation needed for particles
-    } else {
-        // Transform position and normal for non-particle objects
-        v_position_vs = vec3(u_MV_matrix * vertex_position_hom); // Transform position to view space
-        v_normal_vs = normalize(u_normal_matrix * a_vertex_normal); // Transform and normalize normal
+    if(!u_is_particle) {
+        // The view matrix is a rigid transform, its 3x3 part is its own normal matrix
+        v_normal_vs = normalize(mat3(u_view_matrix) * (normal_matrix * a_vertex_normal));
         v_tex_coords = a_vertex_tex_coords; // Pass texture coordinates
+        v_tex_layer = u_instanced ? a_instance_data.a : a_vertex_tex_layer;
+        v_instance_color = a_instance_data.rgb;
+    } else {
+        v_particle_color = a_particle_color;
+        v_particle_data = a_particle_data;
     }
 
     // Final projected position
-    gl_Position = u_MVP_matrix * vertex_position_hom;
-    gl_PointSize = 5.0; // Set the size of the particle
+    gl_Position = u_view_proj_matrix * vertex_position_ws;
+    gl_PointSize = u_is_particle ? 5.0 * a_particle_data.y : 5.0; // Set the size of the particle
 }
@@ -1,71 +1,117 @@
 #version 330 core
 
-struct Light {
-    vec3 position; // Direction de la lumière directionnelle pour la lumière 0, sinon position de la lumière pour les autres
-    vec3 intensity; // Intensité de la lumière
+// Per-frame constants, shared by every program (see FrameUniforms)
+layout(std140) uniform FrameData {
+    mat4 u_view_matrix;
+    mat4 u_proj_matrix;
+    mat4 u_view_proj_matrix;
+    ivec4 u_light_count;            // x: number of lights in u_light_buffer, y: directional lights, z: clustered
+    ivec4 u_cluster_grid;           // xyz: screen tiles and depth slices
+    vec4 u_cluster_depth;           // x: near plane, y: slice scale, zw: viewport size
 };
 
+// Two texels per light: position in view space (w = 0 for a directional
+// light, xyz is then the opposite of its direction) and intensity
+uniform samplerBuffer u_light_buffer;
+
+// Light grid (see LightGrid): (offset, count) in u_light_index_buffer for
+// every cluster, the directional lights are the first u_light_count.y indices
+uniform usamplerBuffer u_cluster_buffer;
+uniform usamplerBuffer u_light_index_buffer;
+
 // Uniforms
 uniform sampler2D u_texture;        // Texture sampler
+uniform sampler2DArray u_texture_array; // Packed textures of the environment
+uniform bool u_use_texture_array;   // Sample u_texture_array at v_tex_layer instead of u_texture
 uniform vec3 u_color;               // Uniform color for particles or solid objects
 uniform bool u_use_color;           // Flag to toggle between color and texture
 uniform bool u_is_particle;         // Flag to toggle between 3D model and particle
-uniform bool u_is_seed;
-uniform float u_lifespan;
+uniform bool u_instanced;           // The color comes from the instance (v_instance_color)
 
 
 uniform vec3 u_kd;                  // Diffuse reflectivity
 uniform vec3 u_ks;                  // Specular reflectivity
 uniform float u_shininess;          // Shininess for specular highlight
 
-uniform Light u_lights[6];          // Array of lights
-
 // Inputs from the vertex shader
 in vec3 v_normal_vs;                // Transformed vertex normal in view space
 in vec2 v_tex_coords;               // Texture coordinates from the vertex shader
 in vec3 v_position_vs;              // Transformed vertex position in view space
+flat in float v_tex_layer;          // Texture array layer
+flat in vec3 v_instance_color;      // Instance color, see u_instanced
+flat in vec3 v_particle_color;      // Particle color
+flat in vec4 v_particle_data;       // Particle lifespan, size scale, alpha scale, seed
 
 // Output to the framebuffer
 out vec4 f_frag_color;
 
-// Function to compute Blinn-Phong lighting
-vec3 blinn_phong_lighting(vec3 normal, vec3 frag_pos) {
-    vec3 lighting = vec3(0.0);
+// Blinn-Phong contribution of one light
+vec3 shade_light(int i, vec3 normal, vec3 frag_pos) {
+    vec4 light_position = texelFetch(u_light_buffer, 2 * i);
+    vec3 light_intensity_raw = texelFetch(u_light_buffer, 2 * i + 1).rgb;
+    bool is_directional = light_position.w == 0.0;
 
-    for(int i = 0; i < 6; ++i) {
-        vec3 light_dir;
-        if(i == 0) {
-            // Lumière directionnelle (lumière 0)
-            light_dir = normalize(-u_lights[i].position); // La position de la lumière est une direction
-        } else {
-            // Lumières ponctuelles (les autres)
-            light_dir = normalize(u_lights[i].position - frag_pos); // Direction de la lumière ponctuelle
-        }
-        vec3 view_dir = normalize(-frag_pos); // Direction de la vue
-        vec3 half_vector = normalize(light_dir + view_dir);
+    vec3 light_dir;
+    if(is_directional) {
+        // Lumière directionnelle
+        light_dir = normalize(-light_position.xyz); // La position de la lumière est une direction
+    } else {
+        // Lumières ponctuelles
+        light_dir = normalize(light_position.xyz - frag_pos); // Direction de la lumière ponctuelle
+    }
+    vec3 view_dir = normalize(-frag_pos); // Direction de la vue
+    vec3 half_vector = normalize(light_dir + view_dir);
 
-        float diffuse_factor = max(dot(normal, light_dir), 0.0);
-        float specular_factor = pow(max(dot(normal, half_vector), 0.0), u_shininess);
+    float diffuse_factor = max(dot(normal, light_dir), 0.0);
+    float specular_factor = pow(max(dot(normal, half_vector), 0.0), u_shininess);
 
-        float distance = length(u_lights[i].position - frag_pos);
-        vec3 light_intensity;
+    float distance = length(light_position.xyz - frag_pos);
+    vec3 light_intensity;
 
-        if(i == 0) {
-            // Lumière directionnelle, pas d'atténuation
-            light_intensity = u_lights[i].intensity;
-        } else {
-            // Lumières ponctuelles avec atténuation
-            float constant = 1.0;
-            float linear = 0.1;
-            float quadratic = 0.01;
-            float attenuation = 1.0 / ((constant + linear * distance) + (quadratic * (distance * distance)));
-            light_intensity = u_lights[i].intensity * attenuation;
+    if(is_directional) {
+        // Lumière directionnelle, pas d'atténuation
+        light_intensity = light_intensity_raw;
+    } else {
+        // Lumières ponctuelles avec atténuation (LightGrid::light_radius en dépend)
+        float constant = 1.0;
+        float linear = 0.1;
+        float quadratic = 0.01;
+        float attenuation = 1.0 / ((constant + linear * distance) + (quadratic * (distance * distance)));
+        light_intensity = light_intensity_raw * attenuation;
+    }
+
+    vec3 diffuse_color = light_intensity * u_kd * diffuse_factor;
+    vec3 specular_color = light_intensity * u_ks * specular_factor;
+
+    return diffuse_color + specular_color;
+}
+
+// Function to compute Blinn-Phong lighting
+vec3 blinn_phong_lighting(vec3 normal, vec3 frag_pos) {
+    vec3 lighting = vec3(0.0);
+
+    if(u_light_count.z == 0) {
+        for(int i = 0; i < u_light_count.x; ++i) {
+            lighting += shade_light(i, normal, frag_pos);
         }
+        return lighting;
+    }
 
-        vec3 diffuse_color = light_intensity * u_kd * diffuse_factor;
-        vec3 specular_color = light_intensity * u_ks * specular_factor;
+    for(int i = 0; i < u_light_count.y; ++i) {
+        lighting += shade_light(int(texelFetch(u_light_index_buffer, i).r), normal, frag_pos);
+    }
 
-        lighting += diffuse_color + specular_color;
+    // Cluster of the fragment: screen tile and exponential depth slice
+    ivec2 tile = ivec2(gl_FragCoord.xy * vec2(u_cluster_grid.xy) / u_cluster_depth.zw);
+    tile = clamp(tile, ivec2(0), u_cluster_grid.xy - 1);
+    int slice = int(floor(log(-frag_pos.z / u_cluster_depth.x) * u_cluster_depth.y));
+    slice = clamp(slice, 0, u_cluster_grid.z - 1);
+    int cluster = (slice * u_cluster_grid.y + tile.y) * u_cluster_grid.x + tile.x;
+
+    uvec2 cluster_lights = texelFetch(u_cluster_buffer, cluster).rg;
+    for(uint i = 0u; i < cluster_lights.y; ++i) {
+        int light_index = int(texelFetch(u_light_index_buffer, int(cluster_lights.x + i)).r);
+        lighting += shade_light(light_index, normal, frag_pos);
     }
 
     return lighting;
@@ -73,6 +119,8 @@ vec3 blinn_phong_lighting(vec3 normal, vec3 frag_pos) {
 
 void main() {
     if(u_is_particle) {
+        bool is_seed = v_particle_data.w > 0.5;
+
         // Calculer la distance entre la particule et la caméra
         float distance_from_camera = length(v_position_vs);
 
@@ -83,7 +131,7 @@ void main() {
         float distance = length(gl_PointCoord - vec2(0.5));
 
         // Ajuster l'effet de halo en fonction de l'état du seed et de la distance
-        float halo_width = u_is_seed ? 0.4 : 0.2;  // Halo plus prononcé pour les particules seeds
+        float halo_width = is_seed ? 0.4 : 0.2;  // Halo plus prononcé pour les particules seeds
         float alpha = smoothstep(adjusted_radius * 1.5, adjusted_radius - halo_width, distance);
 
         // Créer un effet de lueur avec un dégradé plus doux
@@ -91,14 +139,15 @@ void main() {
             smoothstep(adjusted_radius - halo_width, adjusted_radius - 2.0 * halo_width, distance);
 
         // Ajuster la couleur en fonction du lifespan
-        float lifespan_factor = smoothstep(0.0, 255.0, u_lifespan); // De 0 à 1
-        vec3 particle_color = u_color * lifespan_factor * (1.0 - distance * 0.9) + vec3(1.0, 1.0, 1.0) * halo * 0.3;
+        float lifespan_factor = smoothstep(0.0, 255.0, v_particle_data.x); // De 0 à 1
+        vec3 particle_color = v_particle_color * lifespan_factor * (1.0 - distance * 0.9) + vec3(1.0, 1.0, 1.0) * halo * 0.3;
 
         // Couleur finale avec une opacité beaucoup plus faible au centre pour des bords plus doux
         f_frag_color = vec4(particle_color, alpha * lifespan_factor * (1.0 - distance * 0.8));  // Centre plus transparent
+        f_frag_color.a = min(f_frag_color.a * v_particle_data.z, 1.0); // Compensation du LOD
 
         // Ajouter une lueur subtile et aléatoire pour les particules de seed
-        if(u_is_seed) {
+        if(is_seed) {
             float glow = (1.0 - distance / adjusted_radius) * 0.2;  // Augmenter l'intensité de la lueur
             f_frag_color.rgb += vec3(1.0, 0.8, 0.6) * glow;
         }
@@ -112,7 +161,9 @@ void main() {
 
         // Choisir entre texture ou couleur uniforme
         if(u_use_color) {
-            frag_color = vec4(u_color, 1.0); // Utiliser la couleur uniforme si spécifié
+            frag_color = vec4(u_instanced ? v_instance_color : u_color, 1.0); // Utiliser la couleur uniforme si spécifié
+        } else if(u_use_texture_array) {
+            frag_color = texture(u_texture_array, vec3(v_tex_coords, v_tex_layer));
         } else {
             frag_color = texture(u_texture, v_tex_coords); // Utiliser la couleur et l'alpha de la texture
         }
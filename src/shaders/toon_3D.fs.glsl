@@ -1,10 +1,5 @@
 #version 330 core
 
-struct Light {
-    vec3 position;
-    vec3 intensity;
-};
-
 uniform sampler2D u_texture;
 uniform vec3 u_color;
 uniform bool u_use_color;
@@ -13,7 +8,8 @@ uniform vec3 u_kd;
 uniform vec3 u_ks;
 uniform float u_shininess;
 
-uniform Light u_lights[2];
+// Two texels per light in view space: position, intensity (see FrameUniforms)
+uniform samplerBuffer u_light_buffer;
 
 in vec3 v_normal_vs;
 in vec2 v_tex_coords;
@@ -22,13 +18,14 @@ in vec3 v_position_vs;
 out vec4 f_frag_color;
 
 vec3 toon_shading(int light_index, vec3 normal, vec3 frag_pos) {
-    vec3 light_dir = normalize(u_lights[light_index].position - frag_pos);
+    vec3 light_position = texelFetch(u_light_buffer, 2 * light_index).xyz;
+    vec3 light_dir = normalize(light_position - frag_pos);
     vec3 view_dir = normalize(-frag_pos);
 
     float diffuse_factor = dot(normal, light_dir);
     diffuse_factor = (diffuse_factor > 0.5) ? 1.0 : (diffuse_factor > 0.2) ? 0.5 : 0.0;  // Threshold the diffuse lighting
 
-    vec3 light_intensity = u_lights[light_index].intensity / 2;
+    vec3 light_intensity = texelFetch(u_light_buffer, 2 * light_index + 1).rgb / 2;
 
     vec3 diffuse_color = light_intensity * u_kd * diffuse_factor;
     vec3 specular_color = vec3(0.0);  // No specular highlight in cell shading